@@ -177,6 +177,31 @@
             <source>EditPage.word_count_format</source>
             <translation>%1 words </translation>
         </message>
+        <message>
+            <location filename="../../src/jwrite/ui/EditPage.cpp" line="466" />
+            <source>EditPage.book_stats_format</source>
+            <translation>%1 words, %2 chars, %3 paragraphs, %4 punctuations</translation>
+        </message>
+        <message>
+            <location filename="../../src/jwrite/ui/EditPage.cpp" line="471" />
+            <source>EditPage.book_stats_progress</source>
+            <translation>Counting %1/%2</translation>
+        </message>
+        <message>
+            <location filename="../../src/jwrite/ui/EditPage.cpp" line="195" />
+            <source>EditPage.book_keywords_format</source>
+            <translation>Keywords: %1</translation>
+        </message>
+        <message>
+            <location filename="../../src/jwrite/ui/EditPage.cpp" line="198" />
+            <source>EditPage.book_entities_format</source>
+            <translation>Names: %1</translation>
+        </message>
+        <message>
+            <location filename="../../src/jwrite/ui/EditPage.cpp" line="202" />
+            <source>EditPage.writing_activity_format</source>
+            <translation>Today %1, this session %2</translation>
+        </message>
         <message>
             <location filename="../../src/jwrite/ui/EditPage.cpp" line="198" />
             <source>EditPage.ten_thousand_unit_suffix</source>
@@ -290,6 +315,11 @@
             <source>JustWrite.request_export_book.filter.epub</source>
             <translation>EPUB File (*.epub)</translation>
         </message>
+        <message>
+            <location filename="../../src/jwrite/ui/JustWrite.cpp" line="259" />
+            <source>JustWrite.request_export_book.filter.archive</source>
+            <translation>JustWrite Book Archive (*.jwbook)</translation>
+        </message>
         <message>
             <location filename="../../src/jwrite/ui/JustWrite.cpp" line="265" />
             <source>JustWrite.request_export_book.caption</source>
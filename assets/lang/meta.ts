@@ -177,6 +177,31 @@
             <source>EditPage.word_count_format</source>
             <translation type="unfinished"></translation>
         </message>
+        <message>
+            <location filename="../../src/jwrite/ui/EditPage.cpp" line="466" />
+            <source>EditPage.book_stats_format</source>
+            <translation type="unfinished"></translation>
+        </message>
+        <message>
+            <location filename="../../src/jwrite/ui/EditPage.cpp" line="471" />
+            <source>EditPage.book_stats_progress</source>
+            <translation type="unfinished"></translation>
+        </message>
+        <message>
+            <location filename="../../src/jwrite/ui/EditPage.cpp" line="195" />
+            <source>EditPage.book_keywords_format</source>
+            <translation type="unfinished"></translation>
+        </message>
+        <message>
+            <location filename="../../src/jwrite/ui/EditPage.cpp" line="198" />
+            <source>EditPage.book_entities_format</source>
+            <translation type="unfinished"></translation>
+        </message>
+        <message>
+            <location filename="../../src/jwrite/ui/EditPage.cpp" line="202" />
+            <source>EditPage.writing_activity_format</source>
+            <translation type="unfinished"></translation>
+        </message>
         <message>
             <location filename="../../src/jwrite/ui/EditPage.cpp" line="198" />
             <source>EditPage.ten_thousand_unit_suffix</source>
@@ -289,6 +314,11 @@
             <source>JustWrite.request_export_book.filter.epub</source>
             <translation type="unfinished"></translation>
         </message>
+        <message>
+            <location filename="../../src/jwrite/ui/JustWrite.cpp" line="259" />
+            <source>JustWrite.request_export_book.filter.archive</source>
+            <translation type="unfinished"></translation>
+        </message>
         <message>
             <location filename="../../src/jwrite/ui/JustWrite.cpp" line="265" />
             <source>JustWrite.request_export_book.caption</source>
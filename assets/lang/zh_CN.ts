@@ -177,6 +177,31 @@
             <source>EditPage.word_count_format</source>
             <translation>字数 %1</translation>
         </message>
+        <message>
+            <location filename="../../src/jwrite/ui/EditPage.cpp" line="466" />
+            <source>EditPage.book_stats_format</source>
+            <translation>字数 %1，字符 %2，段落 %3，标点 %4</translation>
+        </message>
+        <message>
+            <location filename="../../src/jwrite/ui/EditPage.cpp" line="471" />
+            <source>EditPage.book_stats_progress</source>
+            <translation>统计中 %1/%2</translation>
+        </message>
+        <message>
+            <location filename="../../src/jwrite/ui/EditPage.cpp" line="195" />
+            <source>EditPage.book_keywords_format</source>
+            <translation>关键词：%1</translation>
+        </message>
+        <message>
+            <location filename="../../src/jwrite/ui/EditPage.cpp" line="198" />
+            <source>EditPage.book_entities_format</source>
+            <translation>人名地名：%1</translation>
+        </message>
+        <message>
+            <location filename="../../src/jwrite/ui/EditPage.cpp" line="202" />
+            <source>EditPage.writing_activity_format</source>
+            <translation>今日 %1，本次 %2</translation>
+        </message>
         <message>
             <location filename="../../src/jwrite/ui/EditPage.cpp" line="198" />
             <source>EditPage.ten_thousand_unit_suffix</source>
@@ -289,6 +314,11 @@
             <source>JustWrite.request_export_book.filter.epub</source>
             <translation>EPUB 电子书 (*.epub)</translation>
         </message>
+        <message>
+            <location filename="../../src/jwrite/ui/JustWrite.cpp" line="259" />
+            <source>JustWrite.request_export_book.filter.archive</source>
+            <translation>JustWrite 书籍归档 (*.jwbook)</translation>
+        </message>
         <message>
             <location filename="../../src/jwrite/ui/JustWrite.cpp" line="265" />
             <source>JustWrite.request_export_book.caption</source>
@@ -225,6 +225,8 @@ int main(int argc, char *argv[]) {
     const int exit_code = app.exec();
     spdlog::info("jwrite exited with code {}", exit_code);
 
+    jwrite_profiler_report();
+
     save_settings();
 
     spdlog::info("Bye, JustWrite!");
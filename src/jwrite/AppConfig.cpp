@@ -198,6 +198,9 @@ QString AppConfig::path(StandardPath path_type) const {
         case StandardPath::Log: {
             return QDir::cleanPath(QCoreApplication::applicationDirPath() + "/data/logs");
         } break;
+        case StandardPath::Cache: {
+            return QDir::cleanPath(QCoreApplication::applicationDirPath() + "/data/cache");
+        } break;
     }
 }
 
@@ -325,6 +328,11 @@ void AppConfig::load() {
         } else if (auto backup = value.as_table(); backup && key == "backup") {
             PARSE_BOOL_OPTION_MANNUAL(backup, BackupSmartMerge, smart_merge);
             PARSE_BOOL_OPTION(backup, KeyVersionRecognition);
+            PARSE_BOOL_OPTION(backup, Autosave);
+            PARSE_DOUBLE_OPTION(backup, AutosaveIdleDelay);
+            PARSE_DOUBLE_OPTION(backup, AutosaveMaxInterval);
+            PARSE_INT_OPTION(backup, AutosaveChangeThreshold);
+            PARSE_STR_OPTION(backup, ChapterCompression);
             PARSE_OPTIONAL_DOUBLE_OPTION_MANNUAL(
                 backup, TimingBackup, timing_mode, TimingBackupInterval, interval);
             PARSE_OPTIONAL_INT_OPTION_MANNUAL(
@@ -335,6 +343,8 @@ void AppConfig::load() {
                 threshold);
         } else if (auto dev_options = value.as_table(); dev_options && key == "dev-options") {
             PARSE_INT_OPTION(dev_options, ToolbarIconSize);
+            PARSE_INT_OPTION(dev_options, ChapterCacheSize);
+            PARSE_BOOL_OPTION(dev_options, ShowPerformanceHud);
         }
     }
 
@@ -462,6 +472,11 @@ void AppConfig::save() {
         backup.insert("key_version_recognition", into_bool(Option::KeyVersionRecognition));
         backup.insert("timing_mode", timing_mode);
         backup.insert("quantitative_mode", quantitative_mode);
+        backup.insert("autosave", into_bool(Option::Autosave));
+        backup.insert("autosave_idle_delay", into_double(ValOption::AutosaveIdleDelay));
+        backup.insert("autosave_max_interval", into_double(ValOption::AutosaveMaxInterval));
+        backup.insert("autosave_change_threshold", into_uint(ValOption::AutosaveChangeThreshold));
+        backup.insert("chapter_compression", into_str(ValOption::ChapterCompression));
 
         settings.insert("backup", backup);
     }
@@ -469,6 +484,8 @@ void AppConfig::save() {
     {
         toml::table dev_options{};
         dev_options.insert("toolbar_icon_size", into_uint(ValOption::ToolbarIconSize));
+        dev_options.insert("chapter_cache_size", into_uint(ValOption::ChapterCacheSize));
+        dev_options.insert("show_performance_hud", into_bool(Option::ShowPerformanceHud));
         settings.insert("dev-options", dev_options);
     }
 
@@ -534,8 +551,10 @@ bool AppConfig::default_option(Option opt) {
         {Option::QuantitativeBackup,          false},
         {Option::BackupSmartMerge,            false},
         {Option::KeyVersionRecognition,       false},
+        {Option::Autosave,                    true },
         {Option::StrictWordCount,             true },
         {Option::SmoothScroll,                true },
+        {Option::ShowPerformanceHud,          false},
     };
     Q_ASSERT(DEFAULT_OPTIONS.size() == magic_enum::enum_count<Option>());
     return DEFAULT_OPTIONS.value(opt);
@@ -556,10 +575,15 @@ QString AppConfig::default_option(ValOption opt) {
         {ValOption::ChapterLimit,                "100"      },
         {ValOption::TimingBackupInterval,        "5.0"      },
         {ValOption::QuantitativeBackupThreshold, "100"      },
+        {ValOption::AutosaveIdleDelay,           "5.0"      },
+        {ValOption::AutosaveMaxInterval,         "120.0"    },
+        {ValOption::AutosaveChangeThreshold,     "500"      },
+        {ValOption::ChapterCompression,          "none"     },
         {ValOption::BackgroundImage,             ""         },
         {ValOption::EditorBackgroundImage,       ""         },
         {ValOption::BackgroundImageOpacity,      "100"      },
         {ValOption::ToolbarIconSize,             "12"       },
+        {ValOption::ChapterCacheSize,            "64"       },
         {ValOption::LastEditingBookOnQuit,       ""         },
         {ValOption::UnfocusedTextOpacity,        "0.25"     },
         {ValOption::TextFocusMode,               "highlight"},
@@ -18,6 +18,7 @@ public:
         AppHome,
         UserData,
         Log,
+        Cache,
     };
 
     enum class FontStyle {
@@ -39,8 +40,10 @@ public:
         QuantitativeBackup,
         BackupSmartMerge,
         KeyVersionRecognition,
+        Autosave,
         StrictWordCount,
         SmoothScroll,
+        ShowPerformanceHud,
     };
 
     enum class ValOption {
@@ -62,12 +65,20 @@ public:
         //! in units of minute
         TimingBackupInterval,
         QuantitativeBackupThreshold,
+        //! in units of second
+        AutosaveIdleDelay,
+        //! in units of second
+        AutosaveMaxInterval,
+        AutosaveChangeThreshold,
+        ChapterCompression,
         BackgroundImage,
         EditorBackgroundImage,
         //! in units of percentage
         BackgroundImageOpacity,
         //! in units of pixel
         ToolbarIconSize,
+        //! in units of MiB
+        ChapterCacheSize,
         LastEditingBookOnQuit,
         UnfocusedTextOpacity,
         TextFocusMode,
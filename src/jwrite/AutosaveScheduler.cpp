@@ -0,0 +1,92 @@
+#include <jwrite/AutosaveScheduler.h>
+
+namespace jwrite {
+
+AutosaveScheduler::AutosaveScheduler(QObject *parent)
+    : QObject(parent)
+    , enabled_{true}
+    , dirty_{false}
+    , changed_chars_{0}
+    , first_dirty_at_{0}
+    , last_edit_at_{0}
+    , last_request_at_{-1}
+    , idle_delay_{0}
+    , max_interval_{0}
+    , change_threshold_{0} {
+    clock_.start();
+    timer_.setInterval(POLL_INTERVAL);
+    timer_.setTimerType(Qt::CoarseTimer);
+    connect(&timer_, &QTimer::timeout, this, &AutosaveScheduler::poll);
+}
+
+void AutosaveScheduler::set_enabled(bool enabled) {
+    enabled_ = enabled;
+    if (!enabled_) {
+        timer_.stop();
+    } else if (dirty_) {
+        timer_.start();
+    }
+}
+
+void AutosaveScheduler::set_idle_delay(int delay) {
+    idle_delay_ = qMax(0, delay);
+}
+
+void AutosaveScheduler::set_max_interval(int interval) {
+    max_interval_ = qMax(0, interval);
+}
+
+void AutosaveScheduler::set_change_threshold(int threshold) {
+    change_threshold_ = qMax(0, threshold);
+}
+
+void AutosaveScheduler::notify_edit(int changed_chars) {
+    const auto now  = clock_.elapsed();
+    changed_chars_ += changed_chars;
+    last_edit_at_   = now;
+    if (!dirty_) { mark_as_dirty(now); }
+
+    //! NOTE: request at once on reaching the threshold, but no more than once per poll
+    if (!enabled_ || change_threshold_ == 0 || changed_chars_ < change_threshold_) { return; }
+    if (last_request_at_ != -1 && now - last_request_at_ < POLL_INTERVAL) { return; }
+    last_request_at_ = now;
+    emit on_save_requested();
+}
+
+void AutosaveScheduler::notify_dirty() {
+    if (!dirty_) { mark_as_dirty(clock_.elapsed()); }
+}
+
+void AutosaveScheduler::notify_saved() {
+    dirty_           = false;
+    changed_chars_   = 0;
+    last_request_at_ = -1;
+    timer_.stop();
+}
+
+void AutosaveScheduler::mark_as_dirty(qint64 now) {
+    dirty_          = true;
+    first_dirty_at_ = now;
+    if (last_edit_at_ < first_dirty_at_) { last_edit_at_ = now; }
+    if (enabled_) { timer_.start(); }
+}
+
+void AutosaveScheduler::poll() {
+    if (!enabled_ || !dirty_) {
+        timer_.stop();
+        return;
+    }
+
+    const auto now      = clock_.elapsed();
+    const bool idle     = idle_delay_ > 0 && now - last_edit_at_ >= idle_delay_;
+    const bool overdue  = max_interval_ > 0 && now - first_dirty_at_ >= max_interval_;
+    const bool exceeded = change_threshold_ > 0 && changed_chars_ >= change_threshold_;
+    if (!idle && !overdue && !exceeded) { return; }
+
+    //! NOTE: the state is kept until the save is actually submitted, so a rejected request is
+    //! retried on the next poll
+    last_request_at_ = now;
+    emit on_save_requested();
+}
+
+} // namespace jwrite
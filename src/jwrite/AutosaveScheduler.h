@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+namespace jwrite {
+
+/*!
+ * \brief decide when the dirty content should be saved
+ *
+ * \note a save is requested once the changed characters reach the threshold, the edits pause for
+ * the idle delay, or the content has been dirty for the max interval; any of them is disabled when
+ * set to 0
+ *
+ * \note notifications only bump counters and timestamps, the conditions are polled by a coarse
+ * timer which runs only while the content is dirty, so typing never pays for the scheduling
+ */
+class AutosaveScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    constexpr static int POLL_INTERVAL = 500;
+
+signals:
+    void on_save_requested();
+
+public:
+    explicit AutosaveScheduler(QObject *parent = nullptr);
+
+    void set_enabled(bool enabled);
+
+    bool is_enabled() const {
+        return enabled_;
+    }
+
+    bool is_dirty() const {
+        return dirty_;
+    }
+
+    //! in units of millisecond
+    void set_idle_delay(int delay);
+    //! in units of millisecond
+    void set_max_interval(int interval);
+    //! in units of character
+    void set_change_threshold(int threshold);
+
+    void notify_edit(int changed_chars);
+    void notify_dirty();
+
+    /*!
+     * \brief reset the state once the dirty content is submitted to save
+     */
+    void notify_saved();
+
+protected:
+    void mark_as_dirty(qint64 now);
+    void poll();
+
+private:
+    QTimer        timer_;
+    QElapsedTimer clock_;
+    bool          enabled_;
+    bool          dirty_;
+    int           changed_chars_;
+    qint64        first_dirty_at_;
+    qint64        last_edit_at_;
+    qint64        last_request_at_;
+    int           idle_delay_;
+    int           max_interval_;
+    int           change_threshold_;
+};
+
+} // namespace jwrite
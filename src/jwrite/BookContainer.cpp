@@ -0,0 +1,437 @@
+#include <jwrite/BookContainer.h>
+#include <jwrite/StorageWriter.h>
+#include <jwrite/ChapterCodec.h>
+#include <QSaveFile>
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <spdlog/spdlog.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace jwrite {
+
+struct BookFileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t entry_count;
+    uint64_t index_offset;
+    //! NOTE: increases on every commit, the valid slot of the larger sequence is the current one
+    uint32_t sequence;
+    //! crc-32 of the index
+    uint32_t index_checksum;
+    //! crc-32 of the header with this field zeroed
+    uint32_t checksum;
+    uint32_t reserved;
+};
+
+struct BookRecordHeader {
+    int32_t  id;
+    uint32_t size;
+};
+
+static_assert(sizeof(BookFileHeader) == 40);
+static_assert(sizeof(BookRecordHeader) == 8);
+static_assert(sizeof(BookContainer::IndexEntry) == 24);
+
+constexpr char     BOOK_MAGIC[8] = {'J', 'W', 'B', 'O', 'O', 'K', '\0', '\0'};
+constexpr uint32_t BOOK_VERSION  = 2;
+
+constexpr qint64 HEADER_SIZE = sizeof(BookFileHeader);
+//! NOTE: two header slots, the records start right after them
+constexpr qint64 DATA_OFFSET = 2 * HEADER_SIZE;
+constexpr qint64 RECORD_SIZE = sizeof(BookRecordHeader);
+constexpr qint64 ENTRY_SIZE  = sizeof(BookContainer::IndexEntry);
+
+static uint32_t crc32_of(QByteArrayView data) {
+    const auto bytes = reinterpret_cast<const Bytef *>(data.data());
+    return crc32(crc32(0, nullptr, 0), bytes, data.size());
+}
+
+static BookFileHeader make_header(uint32_t sequence, qint64 index_offset, const QByteArray &index) {
+    BookFileHeader header{};
+    memcpy(header.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+    header.version        = BOOK_VERSION;
+    header.entry_count    = index.size() / ENTRY_SIZE;
+    header.index_offset   = index_offset;
+    header.sequence       = sequence;
+    header.index_checksum = crc32_of(index);
+    header.checksum       = crc32_of(QByteArrayView(
+        reinterpret_cast<const char *>(&header), offsetof(BookFileHeader, checksum)));
+    return header;
+}
+
+static bool is_header_valid(const BookFileHeader &header) {
+    const auto checksum = crc32_of(QByteArrayView(
+        reinterpret_cast<const char *>(&header), offsetof(BookFileHeader, checksum)));
+    return memcmp(header.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) == 0
+        && header.version == BOOK_VERSION && header.checksum == checksum
+        && header.index_offset >= DATA_OFFSET;
+}
+
+/*!
+ * \brief flush the written data through the os caches to the disk
+ */
+static bool sync_to_disk(QFile &file) {
+    if (!file.flush()) { return false; }
+#ifdef WIN32
+    return _commit(file.handle()) == 0;
+#else
+    return fsync(file.handle()) == 0;
+#endif
+}
+
+static QByteArray serialize_index(const QHash<int, BookContainer::IndexEntry> &index) {
+    //! NOTE: sorted by id so that the same content always leads to the same file
+    QList<BookContainer::IndexEntry> entries(index.cbegin(), index.cend());
+    std::sort(entries.begin(), entries.end(), [](const auto &lhs, const auto &rhs) {
+        return lhs.id < rhs.id;
+    });
+    return QByteArray(
+        reinterpret_cast<const char *>(entries.constData()), entries.size() * ENTRY_SIZE);
+}
+
+BookContainer::~BookContainer() {
+    close();
+}
+
+bool BookContainer::open(const QString &path) {
+    close();
+
+    file_.setFileName(path);
+    if (!file_.open(QIODevice::ReadWrite)) {
+        spdlog::error("failed to open book container {}", path.toStdString());
+        return false;
+    }
+
+    if (file_.size() == 0) {
+        //! NOTE: the second slot is left invalid until the first commit
+        const auto header = make_header(1, DATA_OFFSET, QByteArray{});
+        file_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file_.write(QByteArray(HEADER_SIZE, '\0'));
+        sync_to_disk(file_);
+    }
+
+    BookFileHeader headers[2]{};
+    file_.seek(0);
+    file_.read(reinterpret_cast<char *>(headers), sizeof(headers));
+
+    //! NOTE: take the latest commit whose header and index are intact, a torn or unsynced commit
+    //! falls back to the previous one, which is never overwritten by the later commits
+    int        slot = -1;
+    QByteArray index{};
+    for (int i = 0; i < 2; ++i) {
+        const auto &header = headers[i];
+        if (!is_header_valid(header)) { continue; }
+        if (slot != -1 && header.sequence <= headers[slot].sequence) { continue; }
+        const qint64 size = static_cast<qint64>(header.entry_count) * ENTRY_SIZE;
+        if (static_cast<qint64>(header.index_offset) + size > file_.size()) { continue; }
+        file_.seek(header.index_offset);
+        auto data = file_.read(size);
+        if (data.size() != size || crc32_of(data) != header.index_checksum) { continue; }
+        slot  = i;
+        index = std::move(data);
+    }
+
+    if (slot == -1) {
+        spdlog::error("corrupted book container {}", path.toStdString());
+        file_.close();
+        return false;
+    }
+
+    const auto &header = headers[slot];
+    if (is_header_valid(headers[1 - slot]) && headers[1 - slot].sequence > header.sequence) {
+        spdlog::warn("fallback to the previous commit of book container {}", path.toStdString());
+    }
+
+    const qint64 index_end = static_cast<qint64>(header.index_offset) + index.size();
+    for (qint64 i = 0; i < static_cast<qint64>(header.entry_count); ++i) {
+        IndexEntry entry{};
+        memcpy(&entry, index.constData() + i * ENTRY_SIZE, sizeof(entry));
+        if (entry.offset < DATA_OFFSET + RECORD_SIZE || entry.offset + entry.size > index_end) {
+            spdlog::warn(
+                "drop broken index entry {} from book container {}", entry.id, path.toStdString());
+            continue;
+        }
+        index_.insert(entry.id, entry);
+        live_size_ += RECORD_SIZE + entry.size;
+    }
+
+    //! NOTE: records appended after the committed index are never referenced, drop them
+    if (file_.size() > index_end) { file_.resize(index_end); }
+    file_size_ = index_end;
+    slot_      = slot;
+    sequence_  = header.sequence;
+    dirty_     = false;
+
+    remap();
+    return true;
+}
+
+void BookContainer::close() {
+    unmap();
+    if (file_.isOpen()) { file_.close(); }
+    index_.clear();
+    file_size_ = 0;
+    live_size_ = 0;
+    slot_      = 0;
+    sequence_  = 0;
+    dirty_     = false;
+}
+
+QList<int> BookContainer::chapters() const {
+    QList<int> result{};
+    for (const auto id : index_.keys()) {
+        if (id >= 0) { result.append(id); }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::optional<QByteArray> BookContainer::read_raw(int id) {
+    if (!index_.contains(id)) { return std::nullopt; }
+    const auto &entry = index_[id];
+    const auto  end   = static_cast<qint64>(entry.offset + entry.size);
+    if (end > map_size_) { remap(); }
+
+    QByteArray data{};
+    if (map_ && end <= map_size_) {
+        data = QByteArray(reinterpret_cast<const char *>(map_) + entry.offset, entry.size);
+    } else {
+        //! NOTE: fallback to plain read if the file can not be mapped
+        file_.seek(entry.offset);
+        data = file_.read(entry.size);
+    }
+
+    if (data.size() != entry.size || crc32_of(data) != entry.checksum) {
+        spdlog::error("corrupted record {} in book container {}", id, path().toStdString());
+        return std::nullopt;
+    }
+    return data;
+}
+
+std::optional<QString> BookContainer::read_chapter(int cid) {
+    if (cid < 0) { return std::nullopt; }
+    const auto data = read_raw(cid);
+    if (!data) { return std::nullopt; }
+    //! NOTE: chapters are stored as is, they may be compressed
+    return ChapterCodec::decode(*data, read_raw(DICTIONARY_ID).value_or(QByteArray{}));
+}
+
+int BookContainer::word_count(int cid) const {
+    if (!index_.contains(cid)) { return UNKNOWN_WORD_COUNT; }
+    return index_[cid].word_count;
+}
+
+bool BookContainer::write_raw(int id, const QByteArray &data, int word_count) {
+    if (!is_open()) { return false; }
+
+    const BookRecordHeader header{.id = id, .size = static_cast<uint32_t>(data.size())};
+    file_.seek(file_size_);
+    if (file_.write(reinterpret_cast<const char *>(&header), sizeof(header)) != RECORD_SIZE
+        || file_.write(data) != data.size()) {
+        spdlog::error("failed to append record {} to book container {}", id, path().toStdString());
+        //! NOTE: the partial record is beyond the committed index and dropped on next open
+        return false;
+    }
+
+    if (index_.contains(id)) { live_size_ -= RECORD_SIZE + index_[id].size; }
+    index_[id] = IndexEntry{
+        .id         = id,
+        .size       = header.size,
+        .offset     = static_cast<uint64_t>(file_size_ + RECORD_SIZE),
+        .checksum   = crc32_of(data),
+        .word_count = word_count,
+    };
+    live_size_ += RECORD_SIZE + data.size();
+    file_size_ += RECORD_SIZE + data.size();
+    dirty_      = true;
+    return true;
+}
+
+bool BookContainer::write_chapter(int cid, const QString &text, int word_count) {
+    if (cid < 0) { return false; }
+    return write_raw(cid, text.toUtf8(), word_count);
+}
+
+void BookContainer::remove(int id) {
+    if (!index_.contains(id)) { return; }
+    live_size_ -= RECORD_SIZE + index_.take(id).size;
+    dirty_      = true;
+}
+
+bool BookContainer::commit() {
+    if (!is_open()) { return false; }
+    if (!dirty_) { return true; }
+
+    const auto index  = serialize_index(index_);
+    const int  slot   = 1 - slot_;
+    const auto header = make_header(sequence_ + 1, file_size_, index);
+
+    //! NOTE: the records and the index must reach the disk before a header points to them, and
+    //! the header goes to the other slot, so the current commit survives a torn header write
+    file_.seek(file_size_);
+    if (file_.write(index) != index.size() || !sync_to_disk(file_)) { return false; }
+    file_.seek(slot * HEADER_SIZE);
+    if (file_.write(reinterpret_cast<const char *>(&header), sizeof(header)) != HEADER_SIZE
+        || !sync_to_disk(file_)) {
+        return false;
+    }
+
+    file_size_ += index.size();
+    slot_       = slot;
+    sequence_   = header.sequence;
+    dirty_      = false;
+    remap();
+    return true;
+}
+
+bool BookContainer::compact() {
+    if (!commit()) { return false; }
+
+    QList<IndexEntry> entries(index_.cbegin(), index_.cend());
+    std::sort(entries.begin(), entries.end(), [](const auto &lhs, const auto &rhs) {
+        return lhs.id < rhs.id;
+    });
+
+    QHash<int, IndexEntry> index{};
+    qint64                 index_offset = DATA_OFFSET;
+    for (auto entry : entries) {
+        entry.offset  = index_offset + RECORD_SIZE;
+        index_offset += RECORD_SIZE + entry.size;
+        index.insert(entry.id, entry);
+    }
+
+    const auto data   = serialize_index(index);
+    const auto header = make_header(1, index_offset, data);
+    const auto path   = this->path();
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) { return false; }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(QByteArray(HEADER_SIZE, '\0'));
+    for (const auto &entry : entries) {
+        //! NOTE: raw copy without verification, a corrupted record is kept as is for recovery
+        file_.seek(entry.offset);
+        const auto             record = file_.read(entry.size);
+        const BookRecordHeader rec{.id = entry.id, .size = entry.size};
+        if (record.size() != entry.size) { return false; }
+        file.write(reinterpret_cast<const char *>(&rec), sizeof(rec));
+        file.write(record);
+    }
+    file.write(data);
+
+    //! NOTE: the mapping must be released before the file is replaced
+    close();
+    const bool succeed = file.commit();
+    if (!succeed) { spdlog::error("failed to compact book container {}", path.toStdString()); }
+    return open(path) && succeed;
+}
+
+qint64 BookContainer::garbage_size() const {
+    if (!is_open()) { return 0; }
+    const qint64 index_size = dirty_ ? 0 : index_.size() * ENTRY_SIZE;
+    return file_size_ - DATA_OFFSET - live_size_ - index_size;
+}
+
+bool BookContainer::remap() {
+    unmap();
+    if (!is_open() || file_size_ == 0) { return false; }
+    map_ = file_.map(0, file_size_);
+    if (map_) { map_size_ = file_size_; }
+    return map_ != nullptr;
+}
+
+void BookContainer::unmap() {
+    if (map_) { file_.unmap(map_); }
+    map_      = nullptr;
+    map_size_ = 0;
+}
+
+bool BookContainer::import_from(const QString &book_dir, const QString &path) {
+    QDir  dir(book_dir);
+    QFile toc_file(dir.filePath("TOC"));
+    if (!toc_file.open(QIODevice::ReadOnly)) { return false; }
+    const auto toc = toc_file.readAll();
+    toc_file.close();
+
+    QJsonParseError error{};
+    const auto      doc = QJsonDocument::fromJson(toc, &error);
+    if (error.error != QJsonParseError::NoError || !(doc.isObject() || doc.isArray())) {
+        return false;
+    }
+    //! NOTE: a legacy toc is the bare list of volumes
+    const auto volumes = doc.isArray() ? doc.array() : doc.object()["volumes"].toArray();
+
+    //! NOTE: build aside and replace the target once complete
+    const auto    temp_path = path + ".importing";
+    BookContainer container;
+    QFile::remove(temp_path);
+    if (!container.open(temp_path)) { return false; }
+
+    bool succeed = container.write_toc(toc);
+    if (QFile dict_file(dir.filePath("DICT")); dict_file.open(QIODevice::ReadOnly)) {
+        succeed = succeed && container.write_raw(DICTIONARY_ID, dict_file.readAll());
+    }
+    for (const auto &volume : volumes) {
+        for (const auto &chapter_ref : volume.toObject()["chapters"].toArray()) {
+            const auto chapter = chapter_ref.toObject();
+            const int  cid     = chapter["cid"].toInt();
+            QFile      file(dir.filePath(QString::number(cid)));
+            //! NOTE: a chapter never written has no file, keep it absent as well
+            if (!file.exists()) { continue; }
+            if (!file.open(QIODevice::ReadOnly)) {
+                succeed = false;
+                break;
+            }
+            const auto word_count = chapter["word_count"].toObject();
+            const int  count      = word_count.contains("count") ? word_count["count"].toInt()
+                                                                 : UNKNOWN_WORD_COUNT;
+            succeed               = succeed && container.write_raw(cid, file.readAll(), count);
+        }
+    }
+    succeed = succeed && container.commit();
+    container.close();
+
+    if (succeed) {
+        QFile::remove(path);
+        succeed = QFile::rename(temp_path, path);
+    }
+    if (!succeed) {
+        spdlog::error("failed to import book from {}", book_dir.toStdString());
+        QFile::remove(temp_path);
+    }
+    return succeed;
+}
+
+bool BookContainer::export_to(const QString &path, const QString &book_dir) {
+    BookContainer container;
+    if (!QFile::exists(path) || !container.open(path)) { return false; }
+
+    QDir dir(book_dir);
+    if (!dir.exists() && !dir.mkpath(".")) { return false; }
+
+    for (const auto id : container.index_.keys()) {
+        const auto data = container.read_raw(id);
+        if (!data) { return false; }
+        QString name = QString::number(id);
+        if (id == TOC_ID) {
+            name = QStringLiteral("TOC");
+        } else if (id == DICTIONARY_ID) {
+            name = QStringLiteral("DICT");
+        }
+        if (!StorageWriter::write_atomically(dir.filePath(name), *data)) { return false; }
+    }
+    return true;
+}
+
+} // namespace jwrite
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <optional>
+#include <stdint.h>
+
+namespace jwrite {
+
+/*!
+ * \brief single-file container of a book, i.e. the TOC and all the chapters
+ *
+ * \note the file consists of two header slots, the appended records and an index which is always
+ * written after the last record; an update appends the new records after the current index, then
+ * writes a new index, syncs it to the disk and finally points the other header slot to it, so the
+ * committed state is never touched and a crash before the commit leaves the previous state intact
+ *
+ * \note the headers, the index and the records are checked by crc-32, the latest intact commit is
+ * opened, i.e. a torn header or a lost index falls back to the previous commit
+ *
+ * \note overwritten records and old indices are left as garbage until the container is compacted
+ *
+ * \note chapter content is stored as the raw utf-8 bytes of the chapter file, so that importing
+ * from and exporting to the directory layout is lossless
+ */
+class BookContainer {
+public:
+    constexpr static int    TOC_ID              = -1;
+    //! NOTE: preset dictionary of the compressed chapters, see ChapterCodec
+    constexpr static int    DICTIONARY_ID       = -2;
+    constexpr static qint64 COMPACT_MIN_GARBAGE = 1024 * 1024;
+    constexpr static int    UNKNOWN_WORD_COUNT  = -1;
+
+    struct IndexEntry {
+        int32_t  id;
+        uint32_t size;
+        uint64_t offset;
+        //! crc-32 of the record
+        uint32_t checksum;
+        int32_t  word_count;
+    };
+
+    BookContainer() = default;
+    ~BookContainer();
+
+    BookContainer(const BookContainer &)            = delete;
+    BookContainer &operator=(const BookContainer &) = delete;
+
+    /*!
+     * \brief open the container, an empty one is created if the file does not exist
+     *
+     * \note uncommitted records left by an unclean exit are dropped
+     */
+    bool open(const QString &path);
+
+    /*!
+     * \note uncommitted changes are discarded
+     */
+    void close();
+
+    bool is_open() const {
+        return file_.isOpen();
+    }
+
+    QString path() const {
+        return file_.fileName();
+    }
+
+    bool contains(int id) const {
+        return index_.contains(id);
+    }
+
+    QList<int> chapters() const;
+
+    std::optional<QByteArray> read_raw(int id);
+    std::optional<QString>    read_chapter(int cid);
+
+    /*!
+     * \return word count recorded along with the chapter, UNKNOWN_WORD_COUNT if not recorded
+     */
+    int word_count(int cid) const;
+
+    std::optional<QByteArray> read_toc() {
+        return read_raw(TOC_ID);
+    }
+
+    bool write_raw(int id, const QByteArray &data, int word_count = UNKNOWN_WORD_COUNT);
+    bool write_chapter(int cid, const QString &text, int word_count = UNKNOWN_WORD_COUNT);
+
+    bool write_toc(const QByteArray &toc) {
+        return write_raw(TOC_ID, toc);
+    }
+
+    void remove(int id);
+
+    /*!
+     * \brief make the written records visible by writing the index and updating the header
+     */
+    bool commit();
+
+    /*!
+     * \brief rewrite the container with the live records only
+     *
+     * \note uncommitted changes are committed first
+     */
+    bool compact();
+
+    qint64 file_size() const {
+        return file_size_;
+    }
+
+    qint64 garbage_size() const;
+
+    bool needs_compaction() const {
+        const auto garbage = garbage_size();
+        return garbage >= COMPACT_MIN_GARBAGE && garbage * 2 >= file_size_;
+    }
+
+    /*!
+     * \brief pack the book stored in the directory layout, i.e. the TOC file and one file per
+     * chapter, into a new container
+     */
+    static bool import_from(const QString &book_dir, const QString &path);
+
+    /*!
+     * \brief unpack the container to the directory layout
+     */
+    static bool export_to(const QString &path, const QString &book_dir);
+
+protected:
+    bool remap();
+    void unmap();
+
+private:
+    QFile                  file_;
+    uchar                 *map_       = nullptr;
+    qint64                 map_size_  = 0;
+    qint64                 file_size_ = 0;
+    //! NOTE: total size of the live records, including their headers
+    qint64                 live_size_ = 0;
+    //! NOTE: header slot of the current commit
+    int                    slot_      = 0;
+    uint32_t               sequence_  = 0;
+    bool                   dirty_     = false;
+    QHash<int, IndexEntry> index_;
+};
+
+} // namespace jwrite
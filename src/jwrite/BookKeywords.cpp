@@ -0,0 +1,229 @@
+#include <jwrite/BookKeywords.h>
+#include <jwrite/BookManager.h>
+#include <QtConcurrent/QtConcurrent>
+#include <QCoreApplication>
+#include <QFile>
+#include <algorithm>
+
+namespace jwrite {
+
+static bool is_term(QStringView word, int &runes, bool &han) {
+    runes = 0;
+    han   = true;
+    for (const auto ch : word) {
+        if (!ch.isLetter()) { return false; }
+        if (ch.script() != QChar::Script_Han) { han = false; }
+        ++runes;
+    }
+    return runes >= BookKeywordIndex::MIN_TERM_LENGTH;
+}
+
+BookKeywordIndex::BookKeywordIndex(QObject *parent)
+    : QObject(parent)
+    , done_{0}
+    , total_{0} {
+    //! NOTE: keep one core for the gui thread, and never compete with the foreground jobs
+    pool_.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+    pool_.setThreadPriority(QThread::LowPriority);
+
+    connect(
+        &watcher_,
+        &QFutureWatcher<ChapterTerms>::resultReadyAt,
+        this,
+        &BookKeywordIndex::handle_on_result_ready);
+    connect(
+        &watcher_,
+        &QFutureWatcher<ChapterTerms>::finished,
+        this,
+        &BookKeywordIndex::handle_on_finished);
+}
+
+BookKeywordIndex::~BookKeywordIndex() {
+    cancel();
+    pool_.waitForDone();
+}
+
+void BookKeywordIndex::reset() {
+    cancel();
+    chapters_.clear();
+    terms_.clear();
+}
+
+QFuture<ChapterTerms> BookKeywordIndex::update(const QList<int> &chapters, loader_t loader) {
+    Q_ASSERT(loader);
+
+    cancel();
+
+    if (!stop_words_) { stop_words_ = std::make_shared<const QSet<QString>>(load_stop_words()); }
+
+    const QSet<int> alive(chapters.begin(), chapters.end());
+    for (const auto cid : chapters_.keys()) {
+        if (!alive.contains(cid)) { drop_chapter(cid); }
+    }
+
+    QHash<int, QByteArray> digests{};
+    for (auto it = chapters_.cbegin(); it != chapters_.cend(); ++it) {
+        digests.insert(it.key(), it->digest);
+    }
+
+    done_  = 0;
+    total_ = chapters.size();
+
+    auto fut = QtConcurrent::mapped(
+        &pool_, chapters, [loader, digests, stop_words = stop_words_](int cid) {
+            const auto text   = loader(cid).value_or(QString{});
+            const auto digest = InMemoryBookManager::get_content_hash(text);
+            if (digests.value(cid) == digest) {
+                return ChapterTerms{.cid = cid, .digest = digest, .unchanged = true};
+            }
+            auto result   = analyze_chapter(cid, text, Tokenizer::get_instance(), *stop_words);
+            result.digest = digest;
+            return result;
+        });
+
+    watcher_.setFuture(fut);
+    emit on_progress(0, total_);
+
+    return fut;
+}
+
+void BookKeywordIndex::cancel() {
+    if (!watcher_.isRunning()) { return; }
+    //! NOTE: results of the in-flight tasks are dropped since the watcher is detached, the index
+    //! is left consistent with the chapters merged so far
+    watcher_.cancel();
+    watcher_.setFuture(QFuture<ChapterTerms>{});
+    emit on_finished(true);
+}
+
+QList<KeywordEntry> BookKeywordIndex::top_keywords(int limit) const {
+    QList<KeywordEntry> entries{};
+    for (auto it = terms_.cbegin(); it != terms_.cend(); ++it) {
+        entries.append({it.key(), it->frequency, it->chapters});
+    }
+    const auto top = std::min<qsizetype>(limit, entries.size());
+    std::partial_sort(
+        entries.begin(),
+        entries.begin() + top,
+        entries.end(),
+        [](const KeywordEntry &lhs, const KeywordEntry &rhs) {
+            if (lhs.frequency != rhs.frequency) { return lhs.frequency > rhs.frequency; }
+            if (lhs.chapters != rhs.chapters) { return lhs.chapters > rhs.chapters; }
+            return lhs.term < rhs.term;
+        });
+    entries.resize(top);
+    return entries;
+}
+
+QList<KeywordEntry> BookKeywordIndex::top_entities(int limit) const {
+    QList<KeywordEntry> entries{};
+    for (auto it = terms_.cbegin(); it != terms_.cend(); ++it) {
+        if (it->known || it->frequency < MIN_ENTITY_FREQUENCY) { continue; }
+        int  runes = 0;
+        bool han   = false;
+        if (!is_term(it.key(), runes, han) || !han || runes > MAX_ENTITY_LENGTH) { continue; }
+        entries.append({it.key(), it->frequency, it->chapters});
+    }
+    const auto top = std::min<qsizetype>(limit, entries.size());
+    std::partial_sort(
+        entries.begin(),
+        entries.begin() + top,
+        entries.end(),
+        [](const KeywordEntry &lhs, const KeywordEntry &rhs) {
+            //! NOTE: names spread over chapters are more likely to be real entities
+            if (lhs.chapters != rhs.chapters) { return lhs.chapters > rhs.chapters; }
+            if (lhs.frequency != rhs.frequency) { return lhs.frequency > rhs.frequency; }
+            return lhs.term < rhs.term;
+        });
+    entries.resize(top);
+    return entries;
+}
+
+ChapterTerms BookKeywordIndex::analyze_chapter(
+    int cid, QStringView text, const Tokenizer &tokenizer, const QSet<QString> &stop_words) {
+    ChapterTerms result{.cid = cid, .digest = {}, .unchanged = false};
+
+    QList<int> boundaries{};
+    const QChar sep('\n');
+    qsizetype   pos = 0;
+    while (pos < text.length()) {
+        qsizetype end = text.indexOf(sep, pos);
+        if (end == -1) { end = text.length(); }
+        const auto para = text.mid(pos, end - pos);
+        pos             = end + 1;
+
+        tokenizer.cut_boundaries(para, boundaries);
+        for (int i = 1; i < boundaries.size(); ++i) {
+            const auto word  = para.mid(boundaries[i - 1], boundaries[i] - boundaries[i - 1]);
+            int        runes = 0;
+            bool       han   = false;
+            if (!is_term(word, runes, han)) { continue; }
+
+            const auto term = word.toString();
+            if (stop_words.contains(term)) { continue; }
+
+            auto it = result.terms.find(term);
+            if (it != result.terms.end()) {
+                ++*it;
+                continue;
+            }
+            result.terms.insert(term, 1);
+            if (!tokenizer.contains(word)) { result.unknown_terms.insert(term); }
+        }
+    }
+
+    return result;
+}
+
+void BookKeywordIndex::handle_on_result_ready(int index) {
+    const auto result = watcher_.resultAt(index);
+    ++done_;
+
+    if (!result.unchanged) {
+        drop_chapter(result.cid);
+        auto &rec  = chapters_[result.cid];
+        rec.digest = result.digest;
+        rec.terms  = result.terms;
+        for (auto it = result.terms.cbegin(); it != result.terms.cend(); ++it) {
+            auto term = terms_.find(it.key());
+            if (term == terms_.end()) {
+                const bool known = !result.unknown_terms.contains(it.key());
+                term             = terms_.insert(it.key(), TermRecord{0, 0, known});
+            }
+            term->frequency += it.value();
+            ++term->chapters;
+        }
+    }
+
+    emit on_progress(done_, total_);
+}
+
+void BookKeywordIndex::handle_on_finished() {
+    if (watcher_.isCanceled()) { return; }
+    emit on_finished(false);
+}
+
+void BookKeywordIndex::drop_chapter(int cid) {
+    const auto rec = chapters_.find(cid);
+    if (rec == chapters_.end()) { return; }
+    for (auto it = rec->terms.cbegin(); it != rec->terms.cend(); ++it) {
+        const auto term = terms_.find(it.key());
+        Q_ASSERT(term != terms_.end());
+        term->frequency -= it.value();
+        if (--term->chapters == 0) { terms_.erase(term); }
+    }
+    chapters_.erase(rec);
+}
+
+QSet<QString> BookKeywordIndex::load_stop_words() {
+    QSet<QString> words{};
+    QFile         file(QCoreApplication::applicationDirPath() + "/dicts/stop_words.utf8");
+    if (!file.open(QIODevice::ReadOnly)) { return words; }
+    while (!file.atEnd()) {
+        const auto word = QString::fromUtf8(file.readLine()).trimmed();
+        if (!word.isEmpty()) { words.insert(word); }
+    }
+    return words;
+}
+
+} // namespace jwrite
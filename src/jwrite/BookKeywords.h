@@ -0,0 +1,123 @@
+#pragma once
+
+#include <jwrite/Tokenizer.h>
+#include <QObject>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QThreadPool>
+#include <QHash>
+#include <QSet>
+#include <QMap>
+#include <functional>
+#include <optional>
+#include <memory>
+
+namespace jwrite {
+
+struct ChapterTerms {
+    int        cid;
+    QByteArray digest;
+    //! NOTE: the chapter is skipped and the terms are left empty if the digest is unchanged
+    bool       unchanged;
+    //! term frequencies
+    QHash<QString, int> terms;
+    //! terms that are not in the dictionary
+    QSet<QString> unknown_terms;
+};
+
+struct KeywordEntry {
+    QString term;
+    int     frequency;
+    //! number of chapters the term occurs in
+    int     chapters;
+};
+
+/*!
+ * \brief incrementally maintained term frequency index of a book
+ *
+ * \note chapters are segmented on a dedicated thread pool, the results are merged into the index
+ * on the thread of the object; chapters whose content digest is unchanged since the last update
+ * are not segmented again
+ *
+ * \note candidate entities, i.e. names of characters and places, are the frequent han terms that
+ * are unknown to the dictionary, which are mostly picked up by the hmm model of the tokenizer
+ */
+class BookKeywordIndex : public QObject {
+    Q_OBJECT
+
+public:
+    //! NOTE: must be safe to call from any thread
+    using loader_t = std::function<std::optional<QString>(int cid)>;
+
+    constexpr static int MIN_TERM_LENGTH      = 2;
+    constexpr static int MAX_ENTITY_LENGTH    = 4;
+    constexpr static int MIN_ENTITY_FREQUENCY = 3;
+
+signals:
+    void on_progress(int done, int total);
+    void on_finished(bool canceled);
+
+public:
+    explicit BookKeywordIndex(QObject *parent = nullptr);
+    ~BookKeywordIndex() override;
+
+    /*!
+     * \brief drop the whole index, the running job is canceled if any
+     */
+    void reset();
+
+    /*!
+     * \brief bring the index up to date with the given chapters, chapters out of the list are
+     * dropped from the index, the running job is canceled if any
+     */
+    QFuture<ChapterTerms> update(const QList<int> &chapters, loader_t loader);
+
+    void cancel();
+
+    bool is_running() const {
+        return watcher_.isRunning();
+    }
+
+    bool is_empty() const {
+        return terms_.isEmpty();
+    }
+
+    QList<KeywordEntry> top_keywords(int limit) const;
+    QList<KeywordEntry> top_entities(int limit) const;
+
+    static ChapterTerms analyze_chapter(
+        int                  cid,
+        QStringView          text,
+        const Tokenizer     &tokenizer,
+        const QSet<QString> &stop_words);
+
+protected:
+    void handle_on_result_ready(int index);
+    void handle_on_finished();
+
+    void drop_chapter(int cid);
+
+    static QSet<QString> load_stop_words();
+
+private:
+    struct ChapterRecord {
+        QByteArray          digest;
+        QHash<QString, int> terms;
+    };
+
+    struct TermRecord {
+        int  frequency;
+        int  chapters;
+        bool known;
+    };
+
+    QThreadPool                          pool_;
+    QFutureWatcher<ChapterTerms>         watcher_;
+    QMap<int, ChapterRecord>             chapters_;
+    QHash<QString, TermRecord>           terms_;
+    std::shared_ptr<const QSet<QString>> stop_words_;
+    int                                  done_;
+    int                                  total_;
+};
+
+} // namespace jwrite
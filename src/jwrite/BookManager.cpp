@@ -1,6 +1,9 @@
 #include <jwrite/BookManager.h>
+#include <jwrite/WordCounter.h>
 #include <QUuid>
-#include <algorithm>
+#include <QCryptographicHash>
+#include <QPromise>
+#include <QtConcurrent/QtConcurrent>
 
 namespace jwrite {
 
@@ -8,10 +11,77 @@ QString AbstractBookManager::alloc_uuid() {
     return QUuid::createUuid().toString();
 }
 
+std::function<AbstractBookManager::OptionalString(int)> AbstractBookManager::get_chapter_loader() {
+    QMap<int, QString> contents;
+    for (const int cid : get_all_chapters()) {
+        contents.insert(cid, fetch_chapter_content(cid).value_or(QString{}));
+    }
+    return [contents](int cid) -> OptionalString {
+        if (!contents.contains(cid)) { return std::nullopt; }
+        return {contents.value(cid)};
+    };
+}
+
+QFuture<AbstractBookManager::OptionalString>
+    AbstractBookManager::fetch_chapter_content_async(int cid) {
+    QPromise<OptionalString> promise;
+    auto                     future = promise.future();
+    promise.start();
+    promise.addResult(fetch_chapter_content(cid));
+    promise.finish();
+    return future;
+}
+
+ChapterReadAhead::ChapterReadAhead(
+    AbstractBookManager *book_manager, QList<int> chapters, int window)
+    : book_manager_{book_manager}
+    , chapters_{std::move(chapters)}
+    , next_{0}
+    , window_{qMax(1, window)} {
+    Q_ASSERT(book_manager_);
+    fill();
+}
+
+ChapterReadAhead::ChapterReadAhead(loader_t loader, QList<int> chapters, int window)
+    : book_manager_{nullptr}
+    , loader_{std::move(loader)}
+    , chapters_{std::move(chapters)}
+    , next_{0}
+    , window_{qMax(1, window)} {
+    Q_ASSERT(loader_);
+    fill();
+}
+
+QString ChapterReadAhead::take(int cid) {
+    std::optional<QString> content{};
+    if (!pending_.isEmpty() && pending_.head().first == cid) {
+        content = pending_.dequeue().second.result();
+        fill();
+    }
+    if (!content) {
+        content = book_manager_ ? book_manager_->fetch_chapter_content(cid) : loader_(cid);
+    }
+    return content.value_or(QString{});
+}
+
+void ChapterReadAhead::fill() {
+    while (pending_.size() < window_ && next_ < chapters_.size()) {
+        const int cid = chapters_[next_++];
+        pending_.enqueue(
+            {cid,
+             book_manager_ ? book_manager_->fetch_chapter_content_async(cid)
+                           : QtConcurrent::run(loader_, cid)});
+    }
+}
+
 QList<int> InMemoryBookManager::get_all_chapters() const {
-    QList<int> results;
-    for (auto vid : vid_list_) { results << get_chapters_of_volume(vid); }
-    return results;
+    if (!all_chapters_valid_) {
+        all_chapters_.clear();
+        all_chapters_.reserve(volume_of_.size());
+        for (auto vid : vid_list_) { all_chapters_ << get_chapters_of_volume(vid); }
+        all_chapters_valid_ = true;
+    }
+    return all_chapters_;
 }
 
 int InMemoryBookManager::add_volume(int index, const QString &title) {
@@ -35,6 +105,8 @@ bool InMemoryBookManager::add_volume_as(int index, int id, const QString &title)
     title_pool_.insert(id, title);
     vid_list_.insert(index, id);
     cid_list_set_.insert(id, {});
+    next_toc_id_ = qMax(next_toc_id_, id + 1);
+    ++toc_revision_;
     return true;
 }
 
@@ -45,6 +117,10 @@ bool InMemoryBookManager::add_chapter_as(int vid, int index, int id, const QStri
     Q_ASSERT(index >= 0 && index <= cid_list.size());
     cid_list.insert(index, id);
     title_pool_.insert(id, title);
+    volume_of_.insert(id, vid);
+    next_toc_id_        = qMax(next_toc_id_, id + 1);
+    all_chapters_valid_ = false;
+    ++toc_revision_;
     return true;
 }
 
@@ -53,12 +129,18 @@ int InMemoryBookManager::remove_volume(int vid) {
 
     const auto &chaps       = get_chapters_of_volume(vid);
     const int   total_chaps = chaps.size();
-    for (const auto cid : chaps) { title_pool_.remove(cid); }
+    for (const auto cid : chaps) {
+        title_pool_.remove(cid);
+        word_counts_.remove(cid);
+        volume_of_.remove(cid);
+    }
     title_pool_.remove(vid);
 
     const int index = vid_list_.indexOf(vid);
     vid_list_.remove(index);
     cid_list_set_.remove(vid);
+    all_chapters_valid_ = false;
+    ++toc_revision_;
 
     return total_chaps + 1;
 }
@@ -67,22 +149,90 @@ bool InMemoryBookManager::remove_chapter(int cid) {
     if (!has_chapter(cid)) { return false; }
 
     title_pool_.remove(cid);
+    word_counts_.remove(cid);
+
+    //! NOTE: the lookup is linear in the chapters of the volume only, so is the erase itself which
+    //! shifts the rest of the list, a position index would not make the removal any cheaper
+    auto &cid_list = cid_list_set_[volume_of_.take(cid)];
+    cid_list.removeOne(cid);
+    all_chapters_valid_ = false;
+    ++toc_revision_;
+
+    return true;
+}
+
+std::optional<int> InMemoryBookManager::get_chapter_word_count(int cid) {
+    if (!word_counter_ || !has_chapter(cid)) { return std::nullopt; }
+
+    if (auto opt = find_chapter_word_count(cid)) { return opt; }
+
+    const auto name = word_counter_->name();
+
+    //! NOTE: index missed, fallback to count the content and fill in the index
+    const auto content = fetch_chapter_content(cid).value_or(QString{});
+    const int  count   = word_counter_->count_all(content);
+    if (!name.isEmpty()) {
+        word_counts_.insert(cid, {name, count, get_content_hash(content)});
+        ++toc_revision_;
+    }
+    return {count};
+}
+
+std::optional<int> InMemoryBookManager::find_chapter_word_count(int cid) const {
+    if (!word_counter_) { return std::nullopt; }
+    const auto name = word_counter_->name();
+    if (auto it = word_counts_.constFind(cid); it != word_counts_.cend() && !name.isEmpty()) {
+        if (it->counter == name) { return {it->count}; }
+    }
+    return std::nullopt;
+}
+
+void InMemoryBookManager::put_chapter_word_count(int cid, int count) {
+    if (!word_counter_ || !has_chapter(cid)) { return; }
+    const auto name = word_counter_->name();
+    if (name.isEmpty()) { return; }
+    //! NOTE: never override the entry refreshed by a sync, which is always the latest one
+    if (find_chapter_word_count(cid).has_value()) { return; }
+    //! NOTE: the hash is left empty, so that the next sync always refreshes the entry
+    word_counts_.insert(cid, {name, count, QByteArray{}});
+    ++toc_revision_;
+}
+
+QByteArray InMemoryBookManager::get_content_hash(const QString &text) {
+    return QCryptographicHash::hash(QByteArrayView(text.toUtf8()), QCryptographicHash::Md5)
+        .toHex();
+}
+
+void InMemoryBookManager::update_word_count_index(
+    int cid, const QString &text, std::optional<int> word_count) {
+    const auto name = word_counter_ ? word_counter_->name() : QString{};
+    if (name.isEmpty()) {
+        //! NOTE: cannot recount without a persistable counter, drop the stale entry instead
+        if (word_counts_.remove(cid) > 0) { ++toc_revision_; }
+        return;
+    }
+
+    if (word_count.has_value()) {
+        if (auto it = word_counts_.constFind(cid); it != word_counts_.cend()) {
+            if (it->counter == name && it->count == *word_count) { return; }
+        }
+        //! NOTE: the hash is left empty, so that a later sync without the count recounts it
+        word_counts_.insert(cid, {name, *word_count, QByteArray{}});
+        ++toc_revision_;
+        return;
+    }
 
-    for (auto &cid_list : cid_list_set_) {
-        const int index = cid_list.indexOf(cid);
-        if (index == -1) { continue; }
-        cid_list.remove(cid);
-        return true;
+    const auto hash = get_content_hash(text);
+    if (auto it = word_counts_.constFind(cid); it != word_counts_.cend()) {
+        if (it->counter == name && it->hash == hash) { return; }
     }
 
-    Q_UNREACHABLE();
-    return false;
+    word_counts_.insert(cid, {name, word_counter_->count_all(text), hash});
+    ++toc_revision_;
 }
 
 int InMemoryBookManager::get_available_toc_id() const {
-    const auto &keys = title_pool_.keys();
-    if (keys.empty()) { return 0; }
-    return *std::max_element(keys.cbegin(), keys.cend()) + 1;
+    return next_toc_id_;
 }
 
 } // namespace jwrite
@@ -1,11 +1,17 @@
 #pragma once
 
 #include <QMap>
+#include <QHash>
+#include <QQueue>
 #include <QUuid>
 #include <QDateTime>
+#include <QFuture>
+#include <functional>
 
 namespace jwrite {
 
+class AbstractWordCounter;
+
 struct BookInfo {
     QString   uuid;
     QString   title;
@@ -78,13 +84,153 @@ public:
 
     virtual OptionalString fetch_chapter_content(int cid) = 0;
 
-    virtual bool sync_chapter_content(int cid, const QString &text) = 0;
+    /*!
+     * \brief fetch the chapter content without blocking the caller
+     *
+     * \note the result may be nullopt for an existing chapter if it could not be read in the
+     * background, callers should fall back to the synchronous fetch then
+     *
+     * \note the default implementation fetches at once and returns a finished future
+     */
+    virtual QFuture<OptionalString> fetch_chapter_content_async(int cid);
+
+    bool sync_chapter_content(int cid, const QString &text) {
+        return sync_chapter_content(cid, text, std::nullopt);
+    }
+
+    /*!
+     * \param [in] word_count word count of the text if already known by the caller, e.g. the
+     * running total of the editor, which saves a recount of the whole chapter
+     *
+     * \note overrides should bring the two-argument overload into scope with a using declaration
+     */
+    virtual bool
+        sync_chapter_content(int cid, const QString &text, std::optional<int> word_count) = 0;
+
+    /*!
+     * \return mark of the edit journal of the book when the stored chapter was written, the
+     * journal records up to the mark are already contained in it; 0 if unknown
+     *
+     * \note only meaningful for a chapter that is not edited since it was loaded, e.g. when the
+     * journal is replayed
+     */
+    virtual qint64 get_chapter_journal_mark(int cid) {
+        return 0;
+    }
+
+    /*!
+     * \return whether the chapter is restored from an older version since loaded, e.g. from a
+     * snapshot after its stored file is found corrupted; the journal never applies to it then
+     */
+    virtual bool is_chapter_restored(int cid) {
+        return false;
+    }
+
+    /*!
+     * \brief hint that the chapters are likely to be fetched soon
+     *
+     * \note implementations may load them in the background, the default one does nothing
+     */
+    virtual void prefetch_chapters(const QList<int> &cids) {}
+
+    /*!
+     * \return loader of the chapter content which is safe to be called from any thread, the
+     * loaded content reflects the state of the book at the time the loader is created
+     *
+     * \note the default implementation fetches all the chapters in advance
+     */
+    virtual std::function<OptionalString(int)> get_chapter_loader();
+
+    /*!
+     * \brief set the word counter used to maintain the word count index of the chapters
+     *
+     * \param [in] counter the word counter, nullptr to detach, the ownership is not transferred
+     */
+    virtual void set_word_counter(AbstractWordCounter *counter) {}
+
+    /*!
+     * \return word count of the chapter computed by the current word counter, or nullopt if no
+     * word counter is attached
+     *
+     * \note implementations may serve the count from an index instead of the chapter content
+     */
+    virtual std::optional<int> get_chapter_word_count(int cid) {
+        return std::nullopt;
+    }
+
+    /*!
+     * \return word count of the chapter only if it is available without touching the content
+     */
+    virtual std::optional<int> find_chapter_word_count(int cid) const {
+        return std::nullopt;
+    }
+
+    /*!
+     * \brief provide the word count of the chapter computed elsewhere by the current counter
+     */
+    virtual void put_chapter_word_count(int cid, int count) {}
+};
+
+/*!
+ * \brief sequential reader of the chapter contents, the following chapters are fetched in the
+ * background meanwhile, so that the processing of a chapter overlaps with the loading of the next
+ */
+class ChapterReadAhead {
+public:
+    using loader_t = std::function<std::optional<QString>(int)>;
+
+    constexpr static int DEFAULT_WINDOW = 4;
+
+    /*!
+     * \param [in] chapters chapters in the order to be taken
+     * \param [in] window max chapters fetched ahead
+     */
+    ChapterReadAhead(
+        AbstractBookManager *book_manager, QList<int> chapters, int window = DEFAULT_WINDOW);
+
+    /*!
+     * \param [in] loader loader of the chapter content which is safe to be called from any thread,
+     * see AbstractBookManager::get_chapter_loader, the book manager is never touched then
+     */
+    ChapterReadAhead(loader_t loader, QList<int> chapters, int window = DEFAULT_WINDOW);
+
+    /*!
+     * \brief take the content of the chapter, expected to be the next one in order
+     *
+     * \note chapters taken out of order are fetched synchronously
+     */
+    QString take(int cid);
+
+protected:
+    void fill();
+
+private:
+    using Pending = QPair<int, QFuture<std::optional<QString>>>;
+
+    AbstractBookManager *book_manager_;
+    loader_t             loader_;
+    QList<int>           chapters_;
+    //! NOTE: index of the next chapter to fetch
+    int                  next_;
+    int                  window_;
+    QQueue<Pending>      pending_;
 };
 
 class InMemoryBookManager : public AbstractBookManager {
 public:
+    struct WordCountRecord {
+        //! name of the word counter which produced the count
+        QString    counter;
+        int        count;
+        //! hash of the chapter content when it was counted
+        QByteArray hash;
+    };
+
     InMemoryBookManager()
-        : next_toc_id_{0} {}
+        : next_toc_id_{0}
+        , all_chapters_valid_{true}
+        , toc_revision_{0}
+        , word_counter_{nullptr} {}
 
     virtual ~InMemoryBookManager() = default;
 
@@ -112,6 +258,10 @@ public:
     bool add_volume_as(int index, int id, const QString &title) override;
     bool add_chapter_as(int vid, int index, int id, const QString &title) override;
 
+    int get_volume_of_chapter(int cid) const override {
+        return volume_of_.value(cid, -1);
+    }
+
     int  remove_volume(int vid) override;
     bool remove_chapter(int cid) override;
 
@@ -120,7 +270,7 @@ public:
     }
 
     bool has_chapter(int cid) const override {
-        return title_pool_.contains(cid) && !cid_list_set_.contains(cid);
+        return volume_of_.contains(cid);
     }
 
     bool has_toc_item(int id) const override {
@@ -136,18 +286,83 @@ public:
     bool update_title(int id, const QString &title) override {
         if (!has_toc_item(id)) { return false; }
         title_pool_[id] = title;
+        ++toc_revision_;
         return true;
     }
 
+    /*!
+     * \return revision of the persisted part of the toc, i.e. the items, their titles and the
+     * word count records, bumped on every change so that an unchanged toc is never rewritten
+     */
+    uint64_t toc_revision() const {
+        return toc_revision_;
+    }
+
+    void set_word_counter(AbstractWordCounter *counter) override {
+        word_counter_ = counter;
+    }
+
+    std::optional<int> get_chapter_word_count(int cid) override;
+    std::optional<int> find_chapter_word_count(int cid) const override;
+    void               put_chapter_word_count(int cid, int count) override;
+
+    std::optional<WordCountRecord> get_word_count_record(int cid) const {
+        if (!word_counts_.contains(cid)) { return std::nullopt; }
+        return {word_counts_.value(cid)};
+    }
+
+    void restore_word_count_record(int cid, const WordCountRecord &record) {
+        word_counts_.insert(cid, record);
+        ++toc_revision_;
+    }
+
+    /*!
+     * \return the next id to allocate, should be persisted with the toc
+     */
+    int next_toc_id() const {
+        return next_toc_id_;
+    }
+
+    /*!
+     * \brief restore the persisted id counter, so that ids of the items removed in the earlier
+     * sessions are not reused
+     */
+    void restore_next_toc_id(int id) {
+        next_toc_id_ = qMax(next_toc_id_, id);
+    }
+
+    static QByteArray get_content_hash(const QString &text);
+
 protected:
     int get_available_toc_id() const;
 
+    /*!
+     * \brief refresh the word count index entry of the chapter with its latest content
+     *
+     * \param [in] word_count known word count of the text, if given the entry is refreshed with it
+     * directly, otherwise the content is hashed and recounted only if the entry misses
+     *
+     * \note should be called by the implementations whenever the chapter content is synced
+     */
+    void update_word_count_index(
+        int cid, const QString &text, std::optional<int> word_count = std::nullopt);
+
 private:
-    BookInfo              info_;
-    QList<int>            vid_list_;
-    QMap<int, QList<int>> cid_list_set_;
-    QMap<int, QString>    title_pool_;
-    mutable int           next_toc_id_;
+    BookInfo                   info_;
+    QList<int>                 vid_list_;
+    QHash<int, QList<int>>     cid_list_set_;
+    QHash<int, QString>        title_pool_;
+    //! NOTE: volume of each chapter, kept in sync with the chapter lists
+    QHash<int, int>            volume_of_;
+    //! NOTE: flattened chapter list, rebuilt lazily after the toc changes
+    mutable QList<int>         all_chapters_;
+    mutable bool               all_chapters_valid_;
+    uint64_t                   toc_revision_;
+    //! NOTE: ids are never reused as long as the counter is persisted with the toc, so a stale
+    //! file of a removed item never shadows a new one
+    mutable int                next_toc_id_;
+    AbstractWordCounter       *word_counter_;
+    QMap<int, WordCountRecord> word_counts_;
 };
 
 } // namespace jwrite
@@ -0,0 +1,107 @@
+#include <jwrite/BookStats.h>
+#include <QtConcurrent/QtConcurrent>
+
+namespace jwrite {
+
+BookStatsEngine::BookStatsEngine(QObject *parent)
+    : QObject(parent)
+    , partial_{}
+    , total_{0} {
+    //! NOTE: keep one core for the gui thread
+    pool_.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+
+    connect(
+        &watcher_,
+        &QFutureWatcher<ChapterStats>::resultReadyAt,
+        this,
+        &BookStatsEngine::handle_on_result_ready);
+    connect(
+        &watcher_,
+        &QFutureWatcher<ChapterStats>::finished,
+        this,
+        &BookStatsEngine::handle_on_finished);
+}
+
+BookStatsEngine::~BookStatsEngine() {
+    cancel();
+    pool_.waitForDone();
+}
+
+QFuture<ChapterStats> BookStatsEngine::compute(
+    const QList<int> &chapters, loader_t loader, std::shared_ptr<AbstractWordCounter> counter) {
+    Q_ASSERT(loader);
+    Q_ASSERT(counter);
+
+    cancel();
+
+    partial_ = {};
+    total_   = chapters.size();
+
+    auto fut = QtConcurrent::mapped(&pool_, chapters, [loader, counter](int cid) {
+        const auto text = loader(cid).value_or(QString{});
+        return compute_chapter_stats(cid, text, counter.get());
+    });
+
+    watcher_.setFuture(fut);
+    emit on_progress(0, total_);
+
+    return fut;
+}
+
+void BookStatsEngine::cancel() {
+    if (!watcher_.isRunning()) { return; }
+    //! NOTE: in-flight tasks still run to the end, but their results are dropped since the
+    //! watcher is detached from the future
+    watcher_.cancel();
+    watcher_.setFuture(QFuture<ChapterStats>{});
+    emit on_finished(partial_, true);
+}
+
+ChapterStats BookStatsEngine::compute_chapter_stats(
+    int cid, QStringView text, AbstractWordCounter *counter) {
+    Q_ASSERT(counter);
+
+    ChapterStats stats{.cid = cid, .words = 0, .chars = 0, .paragraphs = 0, .punctuations = 0};
+
+    //! NOTE: walk the chapter paragraph by paragraph, so that the word counter and the char scan
+    //! share the same hot piece of memory, and the whole chapter is visited only once
+    const QChar sep('\n');
+    int         state = 0;
+    qsizetype   pos   = 0;
+    while (pos <= text.length()) {
+        qsizetype end = text.indexOf(sep, pos);
+        if (end == -1) { end = text.length(); }
+        const auto para = text.mid(pos, end - pos);
+
+        int chars = 0;
+        for (const auto ch : para) {
+            if (ch.isSpace()) { continue; }
+            ++chars;
+            if (ch.isPunct()) { ++stats.punctuations; }
+        }
+        stats.chars += chars;
+        if (chars > 0) { ++stats.paragraphs; }
+
+        stats.words += counter->count_partial(para, state);
+        if (end < text.length()) { stats.words += counter->count_partial(text.mid(end, 1), state); }
+
+        pos = end + 1;
+    }
+    stats.words += counter->count_pending(state);
+
+    return stats;
+}
+
+void BookStatsEngine::handle_on_result_ready(int index) {
+    const auto stats = watcher_.resultAt(index);
+    partial_.merge(stats);
+    emit on_chapter_stats_ready(stats);
+    emit on_progress(partial_.chapters, total_);
+}
+
+void BookStatsEngine::handle_on_finished() {
+    if (watcher_.isCanceled()) { return; }
+    emit on_finished(partial_, false);
+}
+
+} // namespace jwrite
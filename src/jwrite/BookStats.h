@@ -0,0 +1,95 @@
+#pragma once
+
+#include <jwrite/WordCounter.h>
+#include <QObject>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QThreadPool>
+#include <functional>
+#include <optional>
+#include <memory>
+
+namespace jwrite {
+
+struct ChapterStats {
+    int cid;
+    int words;
+    //! non-blank characters
+    int chars;
+    //! non-blank lines
+    int paragraphs;
+    int punctuations;
+};
+
+struct BookStats {
+    int chapters;
+    int words;
+    int chars;
+    int paragraphs;
+    int punctuations;
+
+    void merge(const ChapterStats &stats) {
+        ++chapters;
+        words        += stats.words;
+        chars        += stats.chars;
+        paragraphs   += stats.paragraphs;
+        punctuations += stats.punctuations;
+    }
+};
+
+/*!
+ * \brief map-reduce statistics of the chapters of a book over a dedicated thread pool
+ *
+ * \note each chapter is loaded and counted within the same task, so the loading of a chapter
+ * overlaps with the counting of the others; the partial results are reduced on the thread of the
+ * engine and reported progressively through signals
+ */
+class BookStatsEngine : public QObject {
+    Q_OBJECT
+
+public:
+    //! NOTE: must be safe to call from any thread
+    using loader_t = std::function<std::optional<QString>(int cid)>;
+
+signals:
+    void on_chapter_stats_ready(const ChapterStats &stats);
+    void on_progress(int done, int total);
+    void on_finished(const BookStats &stats, bool canceled);
+
+public:
+    explicit BookStatsEngine(QObject *parent = nullptr);
+    ~BookStatsEngine() override;
+
+    /*!
+     * \brief start the statistics of the given chapters, the running job is canceled if any
+     *
+     * \param [in] counter word counter shared among the workers, must be reentrant
+     */
+    QFuture<ChapterStats> compute(
+        const QList<int> &chapters, loader_t loader, std::shared_ptr<AbstractWordCounter> counter);
+
+    void cancel();
+
+    bool is_running() const {
+        return watcher_.isRunning();
+    }
+
+    const BookStats &partial_stats() const {
+        return partial_;
+    }
+
+    static ChapterStats
+        compute_chapter_stats(int cid, QStringView text, AbstractWordCounter *counter);
+
+protected:
+    void handle_on_result_ready(int index);
+    void handle_on_finished();
+
+private:
+    QThreadPool                  pool_;
+    QFutureWatcher<ChapterStats> watcher_;
+    BookStats                    partial_;
+    int                          total_;
+};
+
+} // namespace jwrite
@@ -0,0 +1,159 @@
+#include <jwrite/ChapterCache.h>
+#include <jwrite/ProfileUtils.h>
+
+namespace jwrite {
+
+static qint64 size_of(const QString &text) {
+    return text.size() * static_cast<qint64>(sizeof(QChar));
+}
+
+ChapterCache::ChapterCache(qint64 budget)
+    : budget_{qMax<qint64>(0, budget)}
+    , size_{0}
+    , next_version_{1}
+    , stats_{} {}
+
+void ChapterCache::set_budget(qint64 budget) {
+    budget_ = qMax<qint64>(0, budget);
+    evict();
+}
+
+bool ChapterCache::is_dirty(const Key &key) const {
+    const auto it = nodes_.constFind(key);
+    return it != nodes_.cend() && it->dirty;
+}
+
+uint64_t ChapterCache::version(const Key &key) const {
+    const auto it = nodes_.constFind(key);
+    return it != nodes_.cend() && it->dirty ? it->version : 0;
+}
+
+std::optional<QString> ChapterCache::get(const Key &key) {
+    const auto it = nodes_.constFind(key);
+    if (it == nodes_.cend()) {
+        ++stats_.misses;
+        jwrite_profiler_count(ChapterCacheMiss);
+        return std::nullopt;
+    }
+    ++stats_.hits;
+    jwrite_profiler_count(ChapterCacheHit);
+    touch(key);
+    return it->text;
+}
+
+void ChapterCache::insert(const Key &key, const QString &text) {
+    //! NOTE: never replace the pending edits with the stale content from the storage
+    if (is_dirty(key)) {
+        touch(key);
+        return;
+    }
+    if (auto it = nodes_.find(key); it != nodes_.end()) {
+        size_    += size_of(text) - size_of(it->text);
+        it->text  = text;
+        touch(key);
+    } else {
+        lru_.push_front(key);
+        nodes_.insert(key, Node{.text = text, .version = 0, .dirty = false, .pos = lru_.begin()});
+        size_ += size_of(text);
+    }
+    evict();
+}
+
+bool ChapterCache::prefetch(const Key &key, const QString &text, uint64_t since) {
+    if (nodes_.contains(key) || updates_.value(key, 0) >= since) { return false; }
+    const auto pos = lru_.empty() ? lru_.begin() : std::next(lru_.begin());
+    nodes_.insert(
+        key, Node{.text = text, .version = 0, .dirty = false, .pos = lru_.insert(pos, key)});
+    size_ += size_of(text);
+    evict();
+    return nodes_.contains(key);
+}
+
+uint64_t ChapterCache::update(const Key &key, const QString &text) {
+    if (auto it = nodes_.find(key); it != nodes_.end() && it->text == text) {
+        touch(key);
+        return it->dirty ? it->version : 0;
+    }
+    const auto version = next_version_++;
+    updates_.insert(key, version);
+    if (auto it = nodes_.find(key); it != nodes_.end()) {
+        size_       += size_of(text) - size_of(it->text);
+        it->text     = text;
+        it->version  = version;
+        it->dirty    = true;
+        touch(key);
+    } else {
+        lru_.push_front(key);
+        nodes_.insert(
+            key, Node{.text = text, .version = version, .dirty = true, .pos = lru_.begin()});
+        size_ += size_of(text);
+    }
+    evict();
+    return version;
+}
+
+uint64_t ChapterCache::mark_dirty(const Key &key) {
+    auto it = nodes_.find(key);
+    if (it == nodes_.end()) { return 0; }
+    const auto version = next_version_++;
+    updates_.insert(key, version);
+    it->version = version;
+    it->dirty   = true;
+    touch(key);
+    return version;
+}
+
+bool ChapterCache::mark_clean(const Key &key, uint64_t version) {
+    auto it = nodes_.find(key);
+    if (it == nodes_.end() || !it->dirty || it->version != version) { return false; }
+    it->dirty = false;
+    evict();
+    return true;
+}
+
+void ChapterCache::remove_book(const QString &book_id) {
+    updates_.removeIf([&book_id](const auto &it) {
+        return it.key().first == book_id;
+    });
+    for (auto it = nodes_.begin(); it != nodes_.end();) {
+        if (it.key().first != book_id) {
+            ++it;
+            continue;
+        }
+        size_ -= size_of(it->text);
+        lru_.erase(it->pos);
+        it = nodes_.erase(it);
+    }
+}
+
+QMap<int, QString> ChapterCache::snapshot_of(const QString &book_id) const {
+    QMap<int, QString> result{};
+    for (const auto &[key, node] : nodes_.asKeyValueRange()) {
+        if (key.first == book_id) { result.insert(key.second, node.text); }
+    }
+    return result;
+}
+
+void ChapterCache::touch(const Key &key) {
+    auto &node = nodes_[key];
+    lru_.splice(lru_.begin(), lru_, node.pos);
+    node.pos = lru_.begin();
+}
+
+void ChapterCache::evict() {
+    //! NOTE: the most recently used chapter is always kept, it's likely the one being edited
+    auto it = lru_.end();
+    while (size_ > budget_ && it != lru_.begin() && std::prev(it) != lru_.begin()) {
+        --it;
+        auto node = nodes_.find(*it);
+        Q_ASSERT(node != nodes_.end());
+        if (node->dirty) { continue; }
+        size_ -= size_of(node->text);
+        nodes_.erase(node);
+        it = lru_.erase(it);
+        ++stats_.evictions;
+        jwrite_profiler_count(ChapterCacheEviction);
+    }
+}
+
+} // namespace jwrite
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <QString>
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <optional>
+#include <list>
+#include <stdint.h>
+
+namespace jwrite {
+
+/*!
+ * \brief in-memory cache of the chapter contents shared by all the opened books
+ *
+ * \note clean chapters are evicted in least-recently-used order once the total size exceeds the
+ * budget; dirty chapters are pinned until their content is persisted, so the budget may be
+ * exceeded temporarily when too many chapters are pending to save
+ *
+ * \note every update of a chapter is tagged with a version, a chapter is only cleaned with the
+ * version of the snapshot that has been persisted, so that an edit after the snapshot was taken
+ * keeps it pinned
+ *
+ * \note not thread-safe, background jobs read the chapters through the loaders of the book
+ * managers instead, see AbstractBookManager::get_chapter_loader
+ */
+class ChapterCache {
+public:
+    //! book id & chapter id
+    using Key = QPair<QString, int>;
+
+    //! in units of byte
+    constexpr static qint64 DEFAULT_BUDGET = 64 * 1024 * 1024;
+
+    struct Stats {
+        int64_t hits;
+        int64_t misses;
+        int64_t evictions;
+    };
+
+    explicit ChapterCache(qint64 budget = DEFAULT_BUDGET);
+
+    void set_budget(qint64 budget);
+
+    qint64 budget() const {
+        return budget_;
+    }
+
+    //! in units of byte
+    qint64 size() const {
+        return size_;
+    }
+
+    int count() const {
+        return nodes_.size();
+    }
+
+    bool contains(const Key &key) const {
+        return nodes_.contains(key);
+    }
+
+    bool is_dirty(const Key &key) const;
+
+    /*!
+     * \return version of the latest update, 0 if the chapter is clean or absent
+     */
+    uint64_t version(const Key &key) const;
+
+    /*!
+     * \brief lookup and mark the chapter as the most recently used one
+     */
+    std::optional<QString> get(const Key &key);
+
+    /*!
+     * \brief store the content loaded from the storage as a clean chapter
+     */
+    void insert(const Key &key, const QString &text);
+
+    /*!
+     * \brief store the content loaded in the background ahead of use
+     *
+     * \param [in] since stamp taken when the load was issued, the content is dropped if the
+     * chapter is cached or updated since then, because the load may have raced with a save
+     *
+     * \note the chapter is placed right behind the most recently used one, so that it never
+     * displaces the chapter being edited
+     *
+     * \return true if the content is stored
+     */
+    bool prefetch(const Key &key, const QString &text, uint64_t since);
+
+    /*!
+     * \return stamp of the next update, see prefetch
+     */
+    uint64_t stamp() const {
+        return next_version_;
+    }
+
+    /*!
+     * \brief store the edited content as a dirty chapter
+     *
+     * \note an update with the cached content is a no-op, so that a periodic sync of an untouched
+     * chapter neither rewrites it nor breaks the pending mark_clean of the saving version
+     *
+     * \return version of the update, the current one if the content is unchanged, which is 0 if
+     * the chapter is clean then
+     */
+    uint64_t update(const Key &key, const QString &text);
+
+    /*!
+     * \brief pin the cached chapter as dirty so that it is saved again, e.g. when its stored file
+     * is found corrupted
+     *
+     * \return version of the update, 0 if the chapter is not cached
+     */
+    uint64_t mark_dirty(const Key &key);
+
+    /*!
+     * \brief unpin the chapter once the snapshot of the given version is persisted
+     *
+     * \return true if the chapter turns clean
+     */
+    bool mark_clean(const Key &key, uint64_t version);
+
+    void remove_book(const QString &book_id);
+
+    /*!
+     * \return cached chapters of the book, copies are implicitly shared
+     */
+    QMap<int, QString> snapshot_of(const QString &book_id) const;
+
+    Stats stats() const {
+        return stats_;
+    }
+
+protected:
+    void touch(const Key &key);
+    void evict();
+
+private:
+    struct Node {
+        QString                  text;
+        uint64_t                 version;
+        bool                     dirty;
+        std::list<Key>::iterator pos;
+    };
+
+    //! NOTE: most recently used first
+    std::list<Key>       lru_;
+    QHash<Key, Node>     nodes_;
+    //! NOTE: version of the latest update of each chapter, kept after eviction
+    QHash<Key, uint64_t> updates_;
+    qint64               budget_;
+    qint64               size_;
+    uint64_t             next_version_;
+    Stats                stats_;
+};
+
+} // namespace jwrite
@@ -0,0 +1,417 @@
+#include <jwrite/ChapterCodec.h>
+#include <QFile>
+#include <QHash>
+#include <QSet>
+#include <spdlog/spdlog.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <utility>
+
+namespace jwrite {
+
+struct ChapterFileHeader {
+    char     magic[4];
+    uint8_t  version;
+    uint8_t  method;
+    uint16_t reserved;
+    uint32_t raw_size;
+    uint32_t dictionary_id;
+    //! crc-32 of the raw utf-8 text
+    uint32_t checksum;
+    uint32_t reserved2;
+    //! mark of the edit journal when the text was snapshotted, 0 if unknown
+    uint64_t journal_mark;
+};
+
+static_assert(sizeof(ChapterFileHeader) == 32);
+
+constexpr char    CHAPTER_MAGIC[4] = {'J', 'W', 'C', 'H'};
+constexpr uint8_t CHAPTER_VERSION  = 1;
+
+constexpr qsizetype INFLATE_CHUNK_SIZE = 64 * 1024;
+constexpr qsizetype READ_CHUNK_SIZE    = 64 * 1024;
+//! NOTE: the raw size in the header is not verified until the end, never trust it beyond this for
+//! preallocation, in units of character
+constexpr qsizetype MAX_RESERVE_SIZE   = 4 * 1024 * 1024;
+
+//! NOTE: characters of the fragments counted while training
+constexpr int       FRAGMENT_LENGTH = 4;
+//! NOTE: characters of the segments picked into the dictionary
+constexpr int       SEGMENT_LENGTH  = 16;
+//! NOTE: limit the cost of training, in units of character
+constexpr qsizetype TRAINING_LIMIT  = 256 * 1024;
+
+static uint32_t update_crc32(uint32_t crc, QByteArrayView data) {
+    return crc32(crc, reinterpret_cast<const Bytef *>(data.data()), data.size());
+}
+
+ChapterDecoder::ChapterDecoder(QByteArray dictionary)
+    : state_{Header}
+    , dictionary_{std::move(dictionary)}
+    , utf8_(QStringDecoder::Utf8)
+    , stream_{nullptr}
+    , expected_size_{0}
+    , expected_crc_{0}
+    , size_{0}
+    , crc_{update_crc32(0, QByteArrayView{})}
+    , pending_cr_{false} {}
+
+ChapterDecoder::~ChapterDecoder() {
+    if (stream_) {
+        inflateEnd(stream_);
+        delete stream_;
+    }
+}
+
+bool ChapterDecoder::feed(QByteArrayView data) {
+    switch (state_) {
+        case Header: {
+            header_.append(data);
+            const auto size = qMin<qsizetype>(header_.size(), sizeof(CHAPTER_MAGIC));
+            if (memcmp(header_.constData(), CHAPTER_MAGIC, size) != 0) {
+                state_ = Plain;
+                append_plain(header_);
+                header_.clear();
+                return true;
+            }
+            const auto version_offset = offsetof(ChapterFileHeader, version);
+            if (header_.size() <= static_cast<qsizetype>(version_offset)) { return true; }
+            if (const uint8_t version = header_[version_offset]; version != CHAPTER_VERSION) {
+                spdlog::error("unsupported chapter version {}", version);
+                state_ = Failed;
+                return false;
+            }
+            constexpr auto header_size = static_cast<qsizetype>(sizeof(ChapterFileHeader));
+            if (header_.size() < header_size) { return true; }
+            const auto rest = header_.mid(header_size);
+            header_.truncate(header_size);
+            if (!begin_body()) {
+                state_ = Failed;
+                return false;
+            }
+            header_.clear();
+            return state_ == Stored ? store_some(rest) : inflate_some(rest);
+        } break;
+        case Plain: {
+            append_plain(data);
+            return true;
+        } break;
+        case Stored: {
+            return store_some(data);
+        } break;
+        case Inflate: {
+            return inflate_some(data);
+        } break;
+        case Done: {
+            //! NOTE: trailing bytes after the stream end are ignored
+            return true;
+        } break;
+        case Failed: {
+            return false;
+        } break;
+    }
+    return false;
+}
+
+bool ChapterDecoder::finish() {
+    if (state_ == Header) {
+        //! NOTE: a plain text shorter than the header, or an empty file
+        append_plain(header_);
+        header_.clear();
+        state_ = Plain;
+    }
+    if (state_ == Plain) {
+        if (std::exchange(pending_cr_, false)) { append_text("\r"); }
+        state_ = Done;
+    }
+    if (state_ == Stored) { state_ = verify() ? Done : Failed; }
+    if (state_ == Inflate) {
+        spdlog::error("truncated compressed chapter");
+        state_ = Failed;
+    }
+    return state_ == Done;
+}
+
+void ChapterDecoder::append_text(QByteArrayView data) {
+    if (!data.isEmpty()) { text_.append(QString(utf8_(data))); }
+}
+
+void ChapterDecoder::append_plain(QByteArrayView data) {
+    if (!pending_cr_ && !data.contains('\r')) {
+        append_text(data);
+        return;
+    }
+    //! NOTE: legacy chapters were written in text mode, i.e. with "\r\n" line breaks on windows; a
+    //! trailing '\r' is held back, its '\n' may come with the next piece
+    QByteArray bytes{};
+    if (std::exchange(pending_cr_, false)) { bytes.append('\r'); }
+    bytes.append(data);
+    if (bytes.endsWith('\r')) {
+        bytes.chop(1);
+        pending_cr_ = true;
+    }
+    append_text(bytes.replace("\r\n", "\n"));
+}
+
+QString ChapterDecoder::take() {
+    return std::exchange(text_, QString{});
+}
+
+bool ChapterDecoder::begin_body() {
+    ChapterFileHeader header{};
+    memcpy(&header, header_.constData(), sizeof(header));
+    expected_size_ = header.raw_size;
+    expected_crc_  = header.checksum;
+
+    const auto reserved = text_.size() + qMin<qsizetype>(header.raw_size, MAX_RESERVE_SIZE);
+    if (header.method == ChapterCodec::Stored) {
+        text_.reserve(reserved);
+        state_ = Stored;
+        return true;
+    }
+    if (header.method != ChapterCodec::Deflate && header.method != ChapterCodec::Dictionary) {
+        spdlog::error("unsupported chapter encoding method {}", header.method);
+        return false;
+    }
+    if (header.method == ChapterCodec::Dictionary
+        && (dictionary_.isEmpty()
+            || ChapterCodec::dictionary_id(dictionary_) != header.dictionary_id)) {
+        spdlog::error("missing dictionary {:08x} of compressed chapter", header.dictionary_id);
+        return false;
+    }
+
+    stream_ = new z_stream{};
+    if (inflateInit(stream_) != Z_OK) {
+        delete std::exchange(stream_, nullptr);
+        return false;
+    }
+    text_.reserve(reserved);
+    state_ = Inflate;
+    return true;
+}
+
+bool ChapterDecoder::store_some(QByteArrayView data) {
+    //! NOTE: trailing bytes beyond the recorded size are ignored
+    data   = data.first(qMin<qsizetype>(data.size(), expected_size_ - size_));
+    crc_   = update_crc32(crc_, data);
+    size_ += data.size();
+    append_text(data);
+    if (size_ == expected_size_) { state_ = verify() ? Done : Failed; }
+    return state_ != Failed;
+}
+
+bool ChapterDecoder::inflate_some(QByteArrayView data) {
+    char buffer[INFLATE_CHUNK_SIZE];
+    stream_->next_in  = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    stream_->avail_in = data.size();
+    do {
+        stream_->next_out  = reinterpret_cast<Bytef *>(buffer);
+        stream_->avail_out = sizeof(buffer);
+        int ret            = inflate(stream_, Z_NO_FLUSH);
+        if (ret == Z_NEED_DICT) {
+            const auto dict = reinterpret_cast<const Bytef *>(dictionary_.constData());
+            ret             = inflateSetDictionary(stream_, dict, dictionary_.size());
+            if (ret == Z_OK) { continue; }
+        }
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            spdlog::error("corrupted compressed chapter: {}", ret);
+            state_ = Failed;
+            return false;
+        }
+        const auto inflated  = QByteArrayView(buffer, sizeof(buffer) - stream_->avail_out);
+        crc_                 = update_crc32(crc_, inflated);
+        size_               += inflated.size();
+        append_text(inflated);
+        if (ret == Z_STREAM_END) {
+            state_ = verify() ? Done : Failed;
+            return state_ == Done;
+        }
+        if (ret == Z_BUF_ERROR) { break; }
+    } while (stream_->avail_in > 0 || stream_->avail_out == 0);
+    return true;
+}
+
+bool ChapterDecoder::verify() {
+    if (size_ != expected_size_ || crc_ != expected_crc_) {
+        spdlog::error(
+            "chapter checksum mismatch: size {}/{}, crc {:08x}/{:08x}",
+            size_,
+            expected_size_,
+            crc_,
+            expected_crc_);
+        return false;
+    }
+    return true;
+}
+
+static std::optional<QByteArray> compress(
+    const ChapterFileHeader &header, const QByteArray &raw, const QByteArray &dictionary) {
+    z_stream stream{};
+    if (deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK) { return std::nullopt; }
+    if (header.method == ChapterCodec::Dictionary) {
+        const auto dict = reinterpret_cast<const Bytef *>(dictionary.constData());
+        if (deflateSetDictionary(&stream, dict, dictionary.size()) != Z_OK) {
+            deflateEnd(&stream);
+            return std::nullopt;
+        }
+    }
+
+    QByteArray data(sizeof(header) + deflateBound(&stream, raw.size()), Qt::Uninitialized);
+    memcpy(data.data(), &header, sizeof(header));
+    stream.next_in   = reinterpret_cast<Bytef *>(const_cast<char *>(raw.constData()));
+    stream.avail_in  = raw.size();
+    stream.next_out  = reinterpret_cast<Bytef *>(data.data() + sizeof(header));
+    stream.avail_out = data.size() - sizeof(header);
+    const int ret    = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+
+    if (ret != Z_STREAM_END) { return std::nullopt; }
+    data.resize(sizeof(header) + stream.total_out);
+    return data;
+}
+
+QByteArray ChapterCodec::encode(
+    const QString &text, Method method, const QByteArray &dictionary, qint64 journal_mark) {
+    auto raw = text.toUtf8();
+    if (method == None) { return raw; }
+    if (method == Dictionary && dictionary.isEmpty()) { method = Deflate; }
+
+    ChapterFileHeader header{};
+    memcpy(header.magic, CHAPTER_MAGIC, sizeof(CHAPTER_MAGIC));
+    header.version       = CHAPTER_VERSION;
+    header.method        = method;
+    header.raw_size      = raw.size();
+    header.dictionary_id = method == Dictionary ? dictionary_id(dictionary) : 0;
+    header.checksum      = update_crc32(update_crc32(0, QByteArrayView{}), raw);
+    header.journal_mark  = static_cast<uint64_t>(qMax<qint64>(journal_mark, 0));
+
+    if (method != Stored) {
+        if (auto data = compress(header, raw, dictionary)) { return *data; }
+        //! NOTE: still written with the header, so that the text is verified on read
+        spdlog::error("failed to compress chapter, store it as is");
+        header.method        = Stored;
+        header.dictionary_id = 0;
+    }
+
+    raw.prepend(reinterpret_cast<const char *>(&header), sizeof(header));
+    return raw;
+}
+
+std::optional<QString> ChapterCodec::decode(const QByteArray &data, const QByteArray &dictionary) {
+    ChapterDecoder decoder(dictionary);
+    if (!decoder.feed(data) || !decoder.finish()) { return std::nullopt; }
+    return decoder.take();
+}
+
+std::optional<QString> ChapterCodec::read(QIODevice *device, const QByteArray &dictionary) {
+    Q_ASSERT(device && device->isReadable());
+    ChapterDecoder decoder(dictionary);
+    while (!device->atEnd()) {
+        const auto data = device->read(READ_CHUNK_SIZE);
+        if (data.isEmpty() || !decoder.feed(data)) { break; }
+    }
+    if (!decoder.finish()) { return std::nullopt; }
+    return decoder.take();
+}
+
+bool ChapterCodec::verify(const QString &path, const QByteArray &dictionary) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) { return false; }
+    return read(&file, dictionary).has_value();
+}
+
+qint64 ChapterCodec::journal_mark_of(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) { return 0; }
+    const auto data = file.read(sizeof(ChapterFileHeader));
+    if (data.size() < static_cast<qsizetype>(sizeof(ChapterFileHeader))) { return 0; }
+    ChapterFileHeader header{};
+    memcpy(&header, data.constData(), sizeof(header));
+    if (memcmp(header.magic, CHAPTER_MAGIC, sizeof(CHAPTER_MAGIC)) != 0
+        || header.version != CHAPTER_VERSION) {
+        return 0;
+    }
+    return static_cast<qint64>(header.journal_mark);
+}
+
+uint32_t ChapterCodec::dictionary_id(const QByteArray &dictionary) {
+    const auto data = reinterpret_cast<const Bytef *>(dictionary.constData());
+    return adler32(adler32(0, nullptr, 0), data, dictionary.size());
+}
+
+static uint64_t fragment_key(const QChar *chars) {
+    uint64_t key = 0;
+    for (int i = 0; i < FRAGMENT_LENGTH; ++i) { key = (key << 16) | chars[i].unicode(); }
+    return key;
+}
+
+QByteArray ChapterCodec::train_dictionary(const QStringList &samples) {
+    QList<QStringView> texts{};
+    qsizetype          total = 0;
+    for (const auto &sample : samples) {
+        if (total >= TRAINING_LIMIT) { break; }
+        texts.append(QStringView(sample).left(TRAINING_LIMIT - total));
+        total += texts.back().size();
+    }
+    if (total < MIN_TRAINING_SIZE) { return QByteArray{}; }
+
+    QHash<uint64_t, int> frequency{};
+    for (const auto &text : texts) {
+        for (qsizetype i = 0; i + FRAGMENT_LENGTH <= text.size(); ++i) {
+            ++frequency[fragment_key(text.data() + i)];
+        }
+    }
+
+    struct Segment {
+        QStringView text;
+        int64_t     score;
+    };
+
+    //! NOTE: a segment is worth as much as the repeated fragments it covers
+    QList<Segment> segments{};
+    for (const auto &text : texts) {
+        for (qsizetype pos = 0; pos + SEGMENT_LENGTH <= text.size(); pos += SEGMENT_LENGTH) {
+            const auto segment = text.mid(pos, SEGMENT_LENGTH);
+            int64_t    score   = 0;
+            for (int i = 0; i + FRAGMENT_LENGTH <= SEGMENT_LENGTH; ++i) {
+                score += frequency.value(fragment_key(segment.data() + i)) - 1;
+            }
+            if (score > 0) { segments.append({segment, score}); }
+        }
+    }
+    std::stable_sort(segments.begin(), segments.end(), [](const auto &lhs, const auto &rhs) {
+        return lhs.score > rhs.score;
+    });
+
+    QList<QByteArray> picked{};
+    QSet<QStringView> seen{};
+    qsizetype         size = 0;
+    for (const auto &segment : segments) {
+        if (seen.contains(segment.text)) { continue; }
+        const auto data = segment.text.toUtf8();
+        if (size + data.size() > MAX_DICTIONARY_SIZE) { break; }
+        seen.insert(segment.text);
+        picked.append(data);
+        size += data.size();
+    }
+    if (picked.isEmpty()) { return QByteArray{}; }
+
+    //! NOTE: deflate prefers closer matches, the most valuable segments go to the end
+    QByteArray dictionary{};
+    dictionary.reserve(size);
+    for (auto it = picked.crbegin(); it != picked.crend(); ++it) { dictionary.append(*it); }
+    return dictionary;
+}
+
+std::optional<ChapterCodec::Method> ChapterCodec::method_from_name(const QString &name) {
+    const auto key = name.toLower();
+    //! NOTE: the legacy format is only kept for reading, plain text is stored with a checksum
+    if (key == "none") { return Stored; }
+    if (key == "deflate") { return Deflate; }
+    if (key == "dictionary") { return Dictionary; }
+    return std::nullopt;
+}
+
+} // namespace jwrite
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QStringDecoder>
+#include <QIODevice>
+#include <optional>
+#include <stdint.h>
+
+struct z_stream_s;
+
+namespace jwrite {
+
+/*!
+ * \brief incremental decoder of a chapter file
+ *
+ * \note the file is either plain utf-8 text, i.e. the legacy format, or a versioned header
+ * followed by the stored text or a zlib stream; the format is detected from the leading bytes, so
+ * both can be fed piece by piece and the decoded text is available as soon as it's inflated
+ *
+ * \note the size and the crc-32 of the text recorded in the header are verified at the end, a
+ * truncated or corrupted file always fails
+ *
+ * \note line breaks of the legacy format are normalized to '\n'
+ */
+class ChapterDecoder {
+public:
+    explicit ChapterDecoder(QByteArray dictionary = {});
+    ~ChapterDecoder();
+
+    ChapterDecoder(const ChapterDecoder &)            = delete;
+    ChapterDecoder &operator=(const ChapterDecoder &) = delete;
+
+    /*!
+     * \return false if the data is corrupted or the required dictionary is missing
+     */
+    bool feed(QByteArrayView data);
+
+    /*!
+     * \brief mark the end of the input
+     *
+     * \return false if the input is truncated or corrupted
+     */
+    bool finish();
+
+    /*!
+     * \return text decoded since the last take
+     */
+    QString take();
+
+    bool failed() const {
+        return state_ == Failed;
+    }
+
+private:
+    enum State {
+        Header,
+        Plain,
+        Stored,
+        Inflate,
+        Done,
+        Failed,
+    };
+
+    void append_text(QByteArrayView data);
+    void append_plain(QByteArrayView data);
+    bool begin_body();
+    bool store_some(QByteArrayView data);
+    bool inflate_some(QByteArrayView data);
+    bool verify();
+
+    State          state_;
+    QByteArray     dictionary_;
+    QByteArray     header_;
+    QStringDecoder utf8_;
+    QString        text_;
+    z_stream_s    *stream_;
+    uint32_t       expected_size_;
+    uint32_t       expected_crc_;
+    uint32_t       size_;
+    uint32_t       crc_;
+    //! NOTE: a '\r' at the end of the last plain piece, see append_plain
+    bool           pending_cr_;
+};
+
+/*!
+ * \brief transparent compression of the chapter files
+ *
+ * \note an encoded chapter is a 32-byte header {magic, version, method, raw size, dictionary
+ * id, crc-32 of the raw text, journal mark} followed by the text, stored as is or as a zlib
+ * stream; the dictionary id is the adler-32 of the preset dictionary; files without the header
+ * are read as plain utf-8 text, so books stored before are still readable but never verified
+ *
+ * \note the journal mark is the mark of the edit journal of the book when the text was taken,
+ * the journal records up to the mark are already contained in the text
+ */
+class ChapterCodec {
+public:
+    enum Method {
+        //! plain utf-8 text, no header and no checksum
+        None,
+        //! plain utf-8 text after the header
+        Stored,
+        Deflate,
+        //! deflate primed with a preset dictionary trained on the text of the book
+        Dictionary,
+    };
+
+    //! NOTE: deflate only looks back 32 KiB, a larger dictionary never helps
+    constexpr static int MAX_DICTIONARY_SIZE = 32 * 1024;
+    //! NOTE: too little text makes a dictionary of no use, in units of character
+    constexpr static int MIN_TRAINING_SIZE   = 4 * 1024;
+
+    static QByteArray encode(
+        const QString    &text,
+        Method            method,
+        const QByteArray &dictionary   = QByteArray{},
+        qint64            journal_mark = 0);
+
+    static std::optional<QString>
+        decode(const QByteArray &data, const QByteArray &dictionary = QByteArray{});
+
+    /*!
+     * \brief decode the chapter from the device in chunks, so that the compressed file is never
+     * held in memory as a whole
+     */
+    static std::optional<QString>
+        read(QIODevice *device, const QByteArray &dictionary = QByteArray{});
+
+    /*!
+     * \return false if the chapter file is missing, truncated or corrupted
+     */
+    static bool verify(const QString &path, const QByteArray &dictionary = QByteArray{});
+
+    /*!
+     * \return journal mark recorded in the header of the chapter file, 0 if the file is missing or
+     * has no such record
+     */
+    static qint64 journal_mark_of(const QString &path);
+
+    static uint32_t dictionary_id(const QByteArray &dictionary);
+
+    /*!
+     * \brief build a preset dictionary from the segments sharing the most frequent fragments
+     *
+     * \return empty if the samples are too small to train on
+     */
+    static QByteArray train_dictionary(const QStringList &samples);
+
+    static std::optional<Method> method_from_name(const QString &name);
+};
+
+} // namespace jwrite
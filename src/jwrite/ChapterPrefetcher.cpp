@@ -0,0 +1,44 @@
+#include <jwrite/ChapterPrefetcher.h>
+#include <jwrite/ProfileUtils.h>
+#include <QThread>
+
+namespace jwrite {
+
+ChapterPrefetcher::ChapterPrefetcher(QObject *parent)
+    : QObject(parent) {
+    pool_.setMaxThreadCount(1);
+}
+
+ChapterPrefetcher::~ChapterPrefetcher() {
+    pool_.clear();
+    pool_.waitForDone();
+}
+
+bool ChapterPrefetcher::request(const ChapterCache::Key &key, uint64_t stamp, loader_t loader) {
+    Q_ASSERT(loader);
+    Q_ASSERT(thread() == QThread::currentThread());
+    if (pending_.contains(key)) { return false; }
+    pending_.insert(key);
+    pool_.start([this, key, stamp, loader] {
+        const auto text = loader();
+        //! NOTE: queued to the thread of the prefetcher, dropped if it's destroyed meanwhile
+        QMetaObject::invokeMethod(
+            this,
+            [this, key, stamp, text] {
+                if (!pending_.remove(key)) { return; }
+                if (!text) { return; }
+                jwrite_profiler_count(ChapterPrefetch);
+                emit on_chapter_loaded(key, *text, stamp);
+            },
+            Qt::QueuedConnection);
+    });
+    return true;
+}
+
+void ChapterPrefetcher::cancel() {
+    Q_ASSERT(thread() == QThread::currentThread());
+    pool_.clear();
+    pending_.clear();
+}
+
+} // namespace jwrite
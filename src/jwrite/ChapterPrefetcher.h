@@ -0,0 +1,61 @@
+#pragma once
+
+#include <jwrite/ChapterCache.h>
+#include <QObject>
+#include <QThreadPool>
+#include <QSet>
+#include <functional>
+#include <optional>
+
+namespace jwrite {
+
+/*!
+ * \brief background loader of the chapters that are likely to be opened soon
+ *
+ * \note loads run one at a time on a dedicated thread in the order of the requests, so that the
+ * prefetching never competes with the gui thread for more than one core; the loaded content is
+ * delivered on the thread of the prefetcher
+ *
+ * \note requests must be made on the thread of the prefetcher as well
+ */
+class ChapterPrefetcher : public QObject {
+    Q_OBJECT
+
+public:
+    //! NOTE: must be safe to call from any thread
+    using loader_t = std::function<std::optional<QString>()>;
+
+signals:
+    /*!
+     * \param [in] stamp stamp of the chapter cache when the load was requested
+     */
+    void on_chapter_loaded(const ChapterCache::Key &key, const QString &text, uint64_t stamp);
+
+public:
+    explicit ChapterPrefetcher(QObject *parent = nullptr);
+    ~ChapterPrefetcher() override;
+
+    /*!
+     * \return false if the chapter is already queued
+     */
+    bool request(const ChapterCache::Key &key, uint64_t stamp, loader_t loader);
+
+    /*!
+     * \brief drop the queued requests, the result of the running one is discarded as well
+     */
+    void cancel();
+
+    bool is_pending(const ChapterCache::Key &key) const {
+        return pending_.contains(key);
+    }
+
+    int total_pending() const {
+        return pending_.size();
+    }
+
+private:
+    QThreadPool             pool_;
+    QSet<ChapterCache::Key> pending_;
+};
+
+} // namespace jwrite
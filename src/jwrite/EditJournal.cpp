@@ -0,0 +1,327 @@
+#include <jwrite/EditJournal.h>
+#include <QSaveFile>
+#include <QMap>
+#include <QSet>
+#include <QHash>
+#include <spdlog/spdlog.h>
+#include <cstring>
+#include <cstddef>
+
+namespace jwrite {
+
+struct JournalFileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    //! logical offset of the first record
+    uint64_t base;
+};
+
+struct JournalRecordHeader {
+    //! size of the payload in bytes
+    uint32_t size;
+    //! checksum of the record with this field zeroed
+    uint16_t checksum;
+    uint8_t  type;
+    uint8_t  reserved;
+    int32_t  cid;
+    int32_t  block_index;
+    int32_t  pos;
+    int32_t  length;
+};
+
+static_assert(sizeof(JournalFileHeader) == 24);
+static_assert(sizeof(JournalRecordHeader) == 24);
+
+constexpr char     JOURNAL_MAGIC[8] = {'J', 'W', 'J', 'R', 'N', 'L', '\0', '\0'};
+constexpr uint32_t JOURNAL_VERSION  = 1;
+
+static JournalFileHeader make_header(qint64 base) {
+    JournalFileHeader header{};
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    header.version = JOURNAL_VERSION;
+    header.base    = base;
+    return header;
+}
+
+/*!
+ * \return offset of the end of the last valid record, 0 if the file header is invalid
+ */
+static qsizetype
+    scan_records(const QByteArray &data, QList<JournalEntry> *entries, qint64 *base = nullptr) {
+    const auto        header = make_header(0);
+    JournalFileHeader file_header{};
+    if (data.size() < static_cast<qsizetype>(sizeof(file_header))) { return 0; }
+    memcpy(&file_header, data.constData(), sizeof(file_header));
+    if (memcmp(file_header.magic, header.magic, sizeof(header.magic)) != 0
+        || file_header.version != header.version) {
+        return 0;
+    }
+    const auto first = static_cast<qint64>(file_header.base);
+    if (base) { *base = first; }
+
+    qsizetype offset = sizeof(file_header);
+    while (data.size() - offset >= static_cast<qsizetype>(sizeof(JournalRecordHeader))) {
+        JournalRecordHeader rec{};
+        memcpy(&rec, data.constData() + offset, sizeof(rec));
+        const auto total = static_cast<qsizetype>(sizeof(rec)) + rec.size;
+        if (rec.size > static_cast<uint32_t>(data.size() - offset - sizeof(rec))) { break; }
+        if (rec.type > TextEditAction::Delete || rec.length < 0) { break; }
+        if (rec.type == TextEditAction::Insert && rec.size != rec.length * sizeof(char16_t)) {
+            break;
+        }
+        if (rec.type == TextEditAction::Delete && rec.size != 0) { break; }
+
+        QByteArray record   = data.mid(offset, total);
+        const auto checksum = rec.checksum;
+        memset(record.data() + offsetof(JournalRecordHeader, checksum), 0, sizeof(checksum));
+        if (qChecksum(record) != checksum) { break; }
+
+        if (entries) {
+            JournalEntry entry{
+                .type        = static_cast<TextEditAction::Type>(rec.type),
+                .cid         = rec.cid,
+                .block_index = rec.block_index,
+                .pos         = rec.pos,
+                .length      = rec.length,
+                .text        = {},
+                .mark        = first + offset + total - static_cast<qint64>(sizeof(file_header)),
+            };
+            if (entry.type == TextEditAction::Insert) {
+                entry.text = QString(
+                    reinterpret_cast<const QChar *>(data.constData() + offset + sizeof(rec)),
+                    rec.length);
+            }
+            entries->append(std::move(entry));
+        }
+
+        offset += total;
+    }
+
+    return offset;
+}
+
+EditJournal::~EditJournal() {
+    close();
+}
+
+bool EditJournal::open(const QString &path) {
+    close();
+
+    file_.setFileName(path);
+    if (!file_.open(QIODevice::ReadWrite)) {
+        spdlog::error("failed to open edit journal {}", path.toStdString());
+        return false;
+    }
+
+    //! NOTE: cut the torn tail, or the records appended later would never be read
+    const auto data  = file_.readAll();
+    const auto valid = scan_records(data, nullptr, &base_);
+    if (valid == 0) {
+        const auto header = make_header(0);
+        base_             = 0;
+        file_.resize(0);
+        file_.seek(0);
+        file_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file_.flush();
+    } else if (valid < data.size()) {
+        spdlog::warn("drop torn records of edit journal {}", path.toStdString());
+        file_.resize(valid);
+    }
+
+    size_ = file_.size() - static_cast<qint64>(sizeof(JournalFileHeader));
+    file_.seek(file_.size());
+
+    return true;
+}
+
+void EditJournal::close() {
+    if (!file_.isOpen()) { return; }
+    file_.close();
+    base_ = 0;
+    size_ = 0;
+}
+
+bool EditJournal::append(int cid, const TextEditAction &action) {
+    if (!is_open() || action.text.isEmpty()) { return false; }
+
+    const bool insert  = action.type == TextEditAction::Insert;
+    const auto payload = insert ? action.text.size() * sizeof(char16_t) : 0;
+
+    JournalRecordHeader rec{
+        .size        = static_cast<uint32_t>(payload),
+        .checksum    = 0,
+        .type        = static_cast<uint8_t>(action.type),
+        .reserved    = 0,
+        .cid         = cid,
+        .block_index = action.loc.block_index,
+        .pos         = action.loc.pos,
+        .length      = static_cast<int32_t>(action.text.size()),
+    };
+
+    QByteArray record(sizeof(rec) + payload, Qt::Uninitialized);
+    memcpy(record.data(), &rec, sizeof(rec));
+    if (insert) { memcpy(record.data() + sizeof(rec), action.text.constData(), payload); }
+    rec.checksum = qChecksum(record);
+    memcpy(record.data() + offsetof(JournalRecordHeader, checksum), &rec.checksum, 2);
+
+    //! NOTE: flushed to the os immediately, which is what survives a crash of the process
+    if (file_.write(record) != record.size() || !file_.flush()) {
+        spdlog::error("failed to append edit journal {}", file_.fileName().toStdString());
+        return false;
+    }
+    size_ += record.size();
+
+    return true;
+}
+
+bool EditJournal::checkpoint(qint64 mark) {
+    if (!is_open()) { return false; }
+    if (mark <= base_) { return true; }
+    //! NOTE: the file is replaced by the checkpoint, reopen it afterwards
+    const auto path = file_.fileName();
+    file_.close();
+    const bool succeed = checkpoint(path, mark);
+    open(path);
+    return succeed;
+}
+
+QList<JournalEntry> EditJournal::read(const QString &path) {
+    QList<JournalEntry> entries{};
+    QFile               file(path);
+    if (!file.open(QIODevice::ReadOnly)) { return entries; }
+    scan_records(file.readAll(), &entries);
+    return entries;
+}
+
+bool EditJournal::apply(QString &text, const JournalEntry &entry) {
+    if (entry.block_index < 0 || entry.pos < 0) { return false; }
+
+    qsizetype start = 0;
+    for (int i = 0; i < entry.block_index; ++i) {
+        const auto pos = text.indexOf('\n', start);
+        if (pos == -1) { return false; }
+        start = pos + 1;
+    }
+    qsizetype end = text.indexOf('\n', start);
+    if (end == -1) { end = text.length(); }
+    if (entry.pos > end - start) { return false; }
+
+    const auto offset = start + entry.pos;
+    switch (entry.type) {
+        case TextEditAction::Insert: {
+            text.insert(offset, entry.text);
+        } break;
+        case TextEditAction::Delete: {
+            if (offset + entry.length > text.length()) { return false; }
+            text.remove(offset, entry.length);
+        } break;
+    }
+
+    return true;
+}
+
+int EditJournal::replay(const QString &path, AbstractBookManager *book_manager) {
+    Q_ASSERT(book_manager);
+
+    const auto entries = read(path);
+    if (entries.isEmpty()) { return 0; }
+
+    QMap<int, QString> chapters{};
+    QSet<int>          broken_chapters{};
+    QHash<int, qint64> persisted_marks{};
+    int                applied = 0;
+    int                skipped = 0;
+    for (const auto &entry : entries) {
+        if (broken_chapters.contains(entry.cid)) { continue; }
+        auto mark = persisted_marks.find(entry.cid);
+        if (mark == persisted_marks.end()) {
+            auto persisted = book_manager->get_chapter_journal_mark(entry.cid);
+            //! NOTE: a mark beyond the end means the journal was recreated after the chapter was
+            //! written, all of its records are newer than the chapter then
+            if (persisted > entries.back().mark) { persisted = 0; }
+            mark = persisted_marks.insert(entry.cid, persisted);
+        }
+        if (entry.mark <= *mark) {
+            ++skipped;
+            continue;
+        }
+        auto it = chapters.find(entry.cid);
+        if (it == chapters.end()) {
+            auto content = book_manager->fetch_chapter_content(entry.cid);
+            if (!content) {
+                broken_chapters.insert(entry.cid);
+                continue;
+            }
+            //! NOTE: fetching a corrupted chapter may restore it from an older version
+            if (book_manager->is_chapter_restored(entry.cid)) {
+                spdlog::warn(
+                    "edit journal {} skips restored chapter {}", path.toStdString(), entry.cid);
+                broken_chapters.insert(entry.cid);
+                continue;
+            }
+            it = chapters.insert(entry.cid, std::move(*content));
+        }
+        //! NOTE: the rest entries of the chapter depend on this one, keep the applied prefix only
+        if (!apply(*it, entry)) {
+            spdlog::warn(
+                "edit journal {} mismatches chapter {}, drop the rest edits",
+                path.toStdString(),
+                entry.cid);
+            broken_chapters.insert(entry.cid);
+            continue;
+        }
+        ++applied;
+    }
+
+    for (auto it = chapters.cbegin(); it != chapters.cend(); ++it) {
+        book_manager->sync_chapter_content(it.key(), it.value());
+    }
+
+    spdlog::info(
+        "replay edit journal {}: {}/{} edits applied, {} already persisted",
+        path.toStdString(),
+        applied,
+        entries.size(),
+        skipped);
+
+    return applied;
+}
+
+bool EditJournal::checkpoint(const QString &path, qint64 mark) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) { return !file.exists(); }
+    const auto data = file.readAll();
+    file.close();
+
+    qint64     base = 0;
+    const auto end  = scan_records(data, nullptr, &base);
+    if (end == 0) { return false; }
+
+    const qsizetype header = sizeof(JournalFileHeader);
+    const auto      drop   = qBound<qint64>(0, mark - base, end - header);
+    if (drop == 0) { return true; }
+
+    //! NOTE: replace the file atomically, the records after the mark must survive a crash
+    const auto new_header = make_header(base + drop);
+    QSaveFile  out(path);
+    if (!out.open(QIODevice::WriteOnly)) { return false; }
+    out.write(reinterpret_cast<const char *>(&new_header), sizeof(new_header));
+    out.write(data.mid(header + drop, end - header - drop));
+    if (!out.commit()) {
+        spdlog::error("failed to checkpoint edit journal {}", path.toStdString());
+        return false;
+    }
+    return true;
+}
+
+qint64 EditJournal::mark_of(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) { return 0; }
+    qint64     base = 0;
+    const auto end  = scan_records(file.readAll(), nullptr, &base);
+    if (end == 0) { return 0; }
+    return base + end - static_cast<qsizetype>(sizeof(JournalFileHeader));
+}
+
+} // namespace jwrite
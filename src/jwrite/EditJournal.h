@@ -0,0 +1,125 @@
+#pragma once
+
+#include <jwrite/TextEditHistory.h>
+#include <jwrite/BookManager.h>
+#include <QFile>
+#include <QString>
+#include <QList>
+#include <stdint.h>
+
+namespace jwrite {
+
+struct JournalEntry {
+    TextEditAction::Type type;
+    int                  cid;
+    int                  block_index;
+    int                  pos;
+    int                  length;
+    //! NOTE: deleted text is never recorded, it's left empty for a deletion
+    QString              text;
+    //! NOTE: logical end of the record in the journal, see EditJournal::mark
+    qint64               mark;
+};
+
+/*!
+ * \brief per-book write-ahead log of the committed edits
+ *
+ * \note every edit of the editor is appended as a small checksummed record, so that the edits
+ * since the last persisted chapter files survive an unclean exit at the cost of a few bytes per
+ * keystroke; the records are dropped once the chapter files they lead to are written, i.e. a
+ * checkpoint
+ *
+ * \note positions are recorded as (block index, position in block) of the chapter text whose
+ * blocks are separated by '\n', which is exactly how the editor locates an edit
+ */
+class EditJournal {
+public:
+    //! NOTE: size of the journal beyond which a checkpoint is requested
+    constexpr static qint64 CHECKPOINT_SIZE = 256 * 1024;
+
+    EditJournal() = default;
+    ~EditJournal();
+
+    EditJournal(const EditJournal &)            = delete;
+    EditJournal &operator=(const EditJournal &) = delete;
+
+    /*!
+     * \note the records left in the file are kept, they are dropped only on the next checkpoint
+     */
+    bool open(const QString &path);
+    void close();
+
+    bool is_open() const {
+        return file_.isOpen();
+    }
+
+    bool append(int cid, const TextEditAction &action);
+
+    /*!
+     * \brief drop the records before the mark, records appended after the mark are kept
+     *
+     * \param [in] mark mark of the journal when the persisted snapshot of the chapters was taken
+     *
+     * \note must only be called once the snapshot is persisted
+     */
+    bool checkpoint(qint64 mark);
+
+    /*!
+     * \return logical end of the journal, never goes backwards across checkpoints
+     */
+    qint64 mark() const {
+        return base_ + size_;
+    }
+
+    qint64 size() const {
+        return size_;
+    }
+
+    bool needs_checkpoint() const {
+        return size_ >= CHECKPOINT_SIZE;
+    }
+
+    /*!
+     * \return valid entries of the journal in order, reading stops at the first torn or corrupted
+     * record
+     */
+    static QList<JournalEntry> read(const QString &path);
+
+    /*!
+     * \return false if the entry does not fit the text, the text is left unchanged then
+     */
+    static bool apply(QString &text, const JournalEntry &entry);
+
+    /*!
+     * \brief apply the journal to the chapters of the book, the changed chapters are synced to the
+     * book manager
+     *
+     * \note entries up to the journal mark of the stored chapter are skipped, they are already
+     * contained in it, e.g. the checkpoint after the chapter was written never happened; so a
+     * replay is idempotent and safe to be done again after a crash
+     *
+     * \note chapters restored from an older version are left untouched, the entries are based on
+     * the lost one
+     *
+     * \return number of entries applied
+     */
+    static int replay(const QString &path, AbstractBookManager *book_manager);
+
+    /*!
+     * \brief checkpoint a journal that is not opened
+     */
+    static bool checkpoint(const QString &path, qint64 mark);
+
+    /*!
+     * \return mark of a journal that is not opened, 0 if the journal does not exist
+     */
+    static qint64 mark_of(const QString &path);
+
+private:
+    QFile  file_;
+    //! NOTE: total size of the records dropped by the checkpoints
+    qint64 base_ = 0;
+    qint64 size_ = 0;
+};
+
+} // namespace jwrite
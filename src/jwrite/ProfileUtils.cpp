@@ -1,36 +1,118 @@
 #include <jwrite/ProfileUtils.h>
+#include <QtCore/qalgorithms.h>
 #include <QDebug>
 #include <QFile>
+#include <QThread>
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QJsonObject>
+#include <spdlog/spdlog.h>
+#include <cmath>
 
 namespace jwrite {
 
+ProfileHistogram::ProfileHistogram() {
+    clear();
+}
+
+void ProfileHistogram::record(int64_t us) {
+    ++buckets_[bucket_of(us)];
+    ++count_;
+    max_ = qMax(max_, us);
+}
+
+void ProfileHistogram::merge(const ProfileHistogram &other) {
+    for (int i = 0; i < TOTAL_BUCKETS; ++i) { buckets_[i] += other.buckets_[i]; }
+    count_ += other.count_;
+    max_    = qMax(max_, other.max_);
+}
+
+void ProfileHistogram::clear() {
+    buckets_.fill(0);
+    count_ = 0;
+    max_   = 0;
+}
+
+int64_t ProfileHistogram::percentile(double ratio) const {
+    if (count_ == 0) { return 0; }
+    const auto    bound = static_cast<int64_t>(std::ceil(qBound(0.0, ratio, 1.0) * count_));
+    const int64_t rank  = qBound<int64_t>(1, bound, count_);
+    int64_t       seen  = 0;
+    for (int i = 0; i < TOTAL_BUCKETS; ++i) {
+        seen += buckets_[i];
+        //! NOTE: never report a bound beyond the largest sample ever seen
+        if (seen >= rank) { return qMin(bucket_upper_bound(i), max_); }
+    }
+    return max_;
+}
+
+int ProfileHistogram::bucket_of(int64_t us) {
+    const auto value = static_cast<quint32>(qBound<int64_t>(0, us, UINT32_MAX));
+    if (value < SUB_BUCKETS) { return value; }
+    const int msb   = 31 - qCountLeadingZeroBits(value);
+    const int shift = msb - SUB_BUCKET_BITS;
+    const int sub   = (value >> shift) & (SUB_BUCKETS - 1);
+    return (shift + 1) * SUB_BUCKETS + sub;
+}
+
+int64_t ProfileHistogram::bucket_upper_bound(int index) {
+    Q_ASSERT(index >= 0 && index < TOTAL_BUCKETS);
+    if (index < SUB_BUCKETS) { return index; }
+    const int     shift = index / SUB_BUCKETS - 1;
+    const int64_t lower = static_cast<int64_t>(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+    return lower + (int64_t{1} << shift) - 1;
+}
+
 void Profiler::setup(int interval_sec) {
     interval_sec_ = qMax(interval_sec, 1);
-    timer_        = new QTimer(this);
-    timer_->setInterval(interval_sec_ * 1000);
-    timer_->setSingleShot(false);
-    timer_->start();
-    connect(timer_, &QTimer::timeout, this, &Profiler::summary_collected_data);
+
+    ON_DEBUG({
+        timer_ = new QTimer(this);
+        timer_->setInterval(interval_sec_ * 1000);
+        timer_->setSingleShot(false);
+        timer_->start();
+        connect(timer_, &QTimer::timeout, this, &Profiler::summary_collected_data);
+    });
+
+    window_timer_ = new QTimer(this);
+    window_timer_->setInterval(WINDOW_INTERVAL);
+    window_timer_->setSingleShot(false);
+    window_timer_->start();
+    connect(window_timer_, &QTimer::timeout, this, &Profiler::roll_window);
 }
 
 void Profiler::start(ProfileTarget target) {
     auto &rec = start_record_[indexof(target)];
-    if (rec.time_since_epoch().count() == 0) { rec = std::chrono::system_clock::now(); }
+    if (rec.time_since_epoch().count() == 0) { rec = std::chrono::steady_clock::now(); }
 }
 
 void Profiler::record(ProfileTarget target) {
     const auto index = indexof(target);
     auto      &rec   = start_record_[index];
-    if (rec.time_since_epoch().count() != 0) {
-        auto now = std::chrono::system_clock::now();
-        profile_data_[index].push_back(std::chrono::duration_cast<duration_t>(now - rec));
-        rec = timestamp_t{};
+    if (rec.time_since_epoch().count() == 0) { return; }
+    const auto now     = std::chrono::steady_clock::now();
+    const auto elapsed = std::chrono::duration_cast<duration_t>(now - rec);
+    rec                = timestamp_t{};
+    if (QThread::currentThread() == thread()) {
+        add_sample(index, elapsed);
+    } else {
+        QMetaObject::invokeMethod(
+            this,
+            [this, index, elapsed] {
+                add_sample(index, elapsed);
+            },
+            Qt::QueuedConnection);
     }
 }
 
+const ProfileHistogram &Profiler::recent_histogram(ProfileTarget target) const {
+    return recent_hist_[indexof(target)];
+}
+
+const ProfileHistogram &Profiler::session_histogram(ProfileTarget target) const {
+    return session_hist_[indexof(target)];
+}
+
 void Profiler::dump_profile_data(const QString &path) const {
     if (path.isEmpty()) { return; }
 
@@ -45,15 +127,63 @@ void Profiler::dump_profile_data(const QString &path) const {
         data[magic_enum::enum_name(target).data()] = timeline;
     }
 
+    QJsonObject percentiles;
+    for (const auto target : magic_enum::enum_values<ProfileTarget>()) {
+        const auto &hist = session_histogram(target);
+        if (hist.empty()) { continue; }
+        QJsonObject stats;
+        stats["count"] = hist.count();
+        stats["p50"]   = hist.percentile(0.50);
+        stats["p95"]   = hist.percentile(0.95);
+        stats["p99"]   = hist.percentile(0.99);
+        stats["max"]   = hist.max();
+
+        percentiles[magic_enum::enum_name(target).data()] = stats;
+    }
+
+    QJsonObject counters;
+    for (const auto counter : magic_enum::enum_values<ProfileCounter>()) {
+        counters[magic_enum::enum_name(counter).data()] = this->counter(counter);
+    }
+
     QJsonObject root;
-    root["interval"] = interval_sec_;
-    root["data"]     = data;
+    root["interval"]    = interval_sec_;
+    root["data"]        = data;
+    root["percentiles"] = percentiles;
+    root["counters"]    = counters;
 
     file.write(QJsonDocument(root).toJson());
 
     file.close();
 }
 
+void Profiler::report_session_stats() const {
+    for (const auto target : magic_enum::enum_values<ProfileTarget>()) {
+        const auto &hist = session_histogram(target);
+        if (hist.empty()) { continue; }
+        spdlog::info(
+            "profile {}: count={} p50={}us p95={}us p99={}us max={}us",
+            magic_enum::enum_name(target),
+            hist.count(),
+            hist.percentile(0.50),
+            hist.percentile(0.95),
+            hist.percentile(0.99),
+            hist.max());
+    }
+    for (const auto counter : magic_enum::enum_values<ProfileCounter>()) {
+        spdlog::info("counter {}: {}", magic_enum::enum_name(counter), this->counter(counter));
+    }
+}
+
+void Profiler::roll_window() {
+    for (int i = 0; i < window_hist_.size(); ++i) {
+        session_hist_[i].merge(window_hist_[i]);
+        recent_hist_[i] = window_hist_[i];
+        window_hist_[i].clear();
+    }
+    emit on_window_roll();
+}
+
 void Profiler::summary_collected_data() {
     if (total_valid() == 0) { return; }
     qDebug().noquote() << QStringLiteral("PROFILE DATA");
@@ -102,8 +232,13 @@ void Profiler::clear(ProfileTarget target) {
     profile_data_[indexof(target)].clear();
 }
 
+void Profiler::add_sample(int index, duration_t elapsed) {
+    window_hist_[index].record(elapsed.count());
+    ON_DEBUG(profile_data_[index].push_back(elapsed));
+}
+
+thread_local Profiler::start_record_t Profiler::start_record_{};
+
 } // namespace jwrite
 
-#ifndef NDEBUG
 jwrite::Profiler JwriteProfiler;
-#endif
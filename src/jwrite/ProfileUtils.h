@@ -4,6 +4,8 @@
 #include <QTimer>
 #include <chrono>
 #include <array>
+#include <atomic>
+#include <stdint.h>
 #include <magic_enum.hpp>
 
 #ifndef NDEBUG
@@ -12,10 +14,12 @@
 #define ON_DEBUG(...)
 #endif
 
-#define setup_jwrite_profiler(interval) ON_DEBUG(JwriteProfiler.setup(interval))
-#define jwrite_profiler_start(target)   ON_DEBUG(JwriteProfiler.start(ProfileTarget::target))
-#define jwrite_profiler_record(target)  ON_DEBUG(JwriteProfiler.record(ProfileTarget::target))
+#define setup_jwrite_profiler(interval) JwriteProfiler.setup(interval)
+#define jwrite_profiler_start(target)   JwriteProfiler.start(ProfileTarget::target)
+#define jwrite_profiler_record(target)  JwriteProfiler.record(ProfileTarget::target)
+#define jwrite_profiler_count(counter)  JwriteProfiler.count(ProfileCounter::counter)
 #define jwrite_profiler_dump(path)      ON_DEBUG(JwriteProfiler.dump_profile_data(path))
+#define jwrite_profiler_report()        JwriteProfiler.report_session_stats()
 
 namespace jwrite {
 
@@ -35,43 +39,138 @@ enum class ProfileTarget {
     SelectPage,
 };
 
+enum class ProfileCounter {
+    ChapterCacheHit,
+    ChapterCacheMiss,
+    ChapterCacheEviction,
+    ChapterPrefetch,
+};
+
+/*!
+ * \brief fixed-size log-linear histogram of durations in microseconds
+ *
+ * \note each power of two is split into 8 linear sub-buckets, so the relative error of a
+ * percentile is bounded by 12.5%, and recording a sample is a few integer ops without allocation
+ */
+class ProfileHistogram {
+public:
+    constexpr static int SUB_BUCKET_BITS = 3;
+    constexpr static int SUB_BUCKETS     = 1 << SUB_BUCKET_BITS;
+    constexpr static int TOTAL_BUCKETS   = (32 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    ProfileHistogram();
+
+    void record(int64_t us);
+    void merge(const ProfileHistogram &other);
+    void clear();
+
+    int64_t count() const {
+        return count_;
+    }
+
+    int64_t max() const {
+        return max_;
+    }
+
+    bool empty() const {
+        return count_ == 0;
+    }
+
+    /*!
+     * \param [in] ratio percentile in range [0, 1]
+     *
+     * \return upper bound of the bucket where the percentile lies in, in microseconds
+     */
+    int64_t percentile(double ratio) const;
+
+    static int     bucket_of(int64_t us);
+    static int64_t bucket_upper_bound(int index);
+
+private:
+    std::array<uint32_t, TOTAL_BUCKETS> buckets_;
+    int64_t                             count_;
+    int64_t                             max_;
+};
+
+/*!
+ * \note the start records are thread-local and the counters are atomic, so the hot paths never
+ * take a lock; samples timed on other threads are handed over to the thread of the profiler
+ */
 class Profiler : public QObject {
     Q_OBJECT
 
 public:
-    using timestamp_t     = decltype(std::chrono::system_clock::now());
+    using timestamp_t     = decltype(std::chrono::steady_clock::now());
     using duration_t      = std::chrono::microseconds;
     using duration_list_t = QList<duration_t>;
     using start_record_t  = std::array<timestamp_t, magic_enum::enum_count<ProfileTarget>()>;
     using profile_data_t  = std::array<duration_list_t, magic_enum::enum_count<ProfileTarget>()>;
     using timeline_t      = QList<double>;
     using profile_graph_t = std::array<timeline_t, magic_enum::enum_count<ProfileTarget>()>;
+    using histograms_t    = std::array<ProfileHistogram, magic_enum::enum_count<ProfileTarget>()>;
+    using counters_t =
+        std::array<std::atomic<int64_t>, magic_enum::enum_count<ProfileCounter>()>;
+
+    //! in units of millisecond
+    constexpr static int WINDOW_INTERVAL = 1000;
 
+signals:
+    void on_window_roll();
+
+public:
     void setup(int interval_sec);
     void start(ProfileTarget target);
     void record(ProfileTarget target);
 
+    void count(ProfileCounter counter, int64_t delta = 1) {
+        counters_[*magic_enum::enum_index(counter)].fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    /*!
+     * \return total count since the profiler was created
+     */
+    int64_t counter(ProfileCounter counter) const {
+        return counters_[*magic_enum::enum_index(counter)].load(std::memory_order_relaxed);
+    }
+
+    /*!
+     * \return histogram of the samples collected in the last closed window
+     */
+    const ProfileHistogram &recent_histogram(ProfileTarget target) const;
+
+    /*!
+     * \return histogram of all the samples collected since the profiler was set up
+     */
+    const ProfileHistogram &session_histogram(ProfileTarget target) const;
+
     void dump_profile_data(const QString &path) const;
+    void report_session_stats() const;
 
 protected slots:
     void summary_collected_data();
+    void roll_window();
 
 protected:
     int   total_valid() const;
     int   indexof(ProfileTarget target) const;
     float averageof(ProfileTarget target) const;
     void  clear(ProfileTarget target);
+    void  add_sample(int index, duration_t elapsed);
 
 private:
-    start_record_t  start_record_;
+    static thread_local start_record_t start_record_;
+
     profile_data_t  profile_data_;
     profile_graph_t timeline_;
+    histograms_t    window_hist_;
+    histograms_t    recent_hist_;
+    histograms_t    session_hist_;
+    counters_t      counters_{};
     int             interval_sec_;
-    QTimer         *timer_ = nullptr;
+    QTimer         *timer_        = nullptr;
+    QTimer         *window_timer_ = nullptr;
 };
 
 } // namespace jwrite
 
-#ifndef NDEBUG
 extern jwrite::Profiler JwriteProfiler;
-#endif
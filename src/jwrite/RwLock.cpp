@@ -8,7 +8,8 @@ RwLock::RwLock()
 bool RwLock::try_lock_read() {
     int val = state_.load(std::memory_order_relaxed);
     if (val < 0) { return false; }
-    return state_.compare_exchange_weak(val, val + 1);
+    //! NOTE: the strong exchange never fails spuriously, a failed try always means contention
+    return state_.compare_exchange_strong(val, val + 1);
 }
 
 void RwLock::lock_read() {
@@ -22,7 +23,7 @@ void RwLock::unlock_read() {
 bool RwLock::try_lock_write() {
     int val = state_.load(std::memory_order_relaxed);
     if (val != 0) { return false; }
-    return state_.compare_exchange_weak(val, -1);
+    return state_.compare_exchange_strong(val, -1);
 }
 
 void RwLock::lock_write() {
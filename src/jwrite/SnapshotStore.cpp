@@ -0,0 +1,457 @@
+#include <jwrite/SnapshotStore.h>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QSet>
+#include <QDir>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <cstddef>
+
+namespace jwrite {
+
+struct SnapshotFileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+struct ChunkRecordHeader {
+    uint8_t  hash[20];
+    uint32_t size;
+};
+
+struct VersionRecordHeader {
+    uint64_t id;
+    int64_t  timestamp;
+    uint64_t size;
+    int32_t  cid;
+    uint32_t chunk_count;
+    //! checksum of the record with this field zeroed
+    uint16_t checksum;
+    uint16_t reserved;
+    uint32_t reserved2;
+};
+
+static_assert(sizeof(SnapshotFileHeader) == 16);
+static_assert(sizeof(ChunkRecordHeader) == 24);
+static_assert(sizeof(VersionRecordHeader) == 40);
+
+constexpr char     CHUNKS_MAGIC[8]   = {'J', 'W', 'C', 'H', 'U', 'N', 'K', '\0'};
+constexpr char     VERSIONS_MAGIC[8] = {'J', 'W', 'H', 'I', 'S', 'T', '\0', '\0'};
+constexpr uint32_t SNAPSHOT_VERSION  = 1;
+
+constexpr int HASH_SIZE   = 20;
+constexpr int HEADER_SIZE = sizeof(SnapshotFileHeader);
+
+//! NOTE: extra versions allowed beyond the policy before a prune, so that a prune that rewrites
+//! the files is amortized across several records
+constexpr int PRUNE_SLACK = 8;
+
+//! NOTE: 11 bits of the hash, i.e. 1 / AVG_CHUNK_SIZE chance to cut at each byte; high bits are
+//! taken since they depend on a longer window of the input
+constexpr uint64_t CHUNK_MASK = uint64_t{SnapshotStore::AVG_CHUNK_SIZE - 1} << (64 - 11);
+static_assert(SnapshotStore::AVG_CHUNK_SIZE == 1 << 11);
+
+static constexpr std::array<uint64_t, 256> make_gear_table() {
+    std::array<uint64_t, 256> table{};
+    uint64_t                  state = 0x4a57726974650001;
+    for (auto &e : table) {
+        //! splitmix64
+        uint64_t z = (state += 0x9e3779b97f4a7c15);
+        z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z          = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        e          = z ^ (z >> 31);
+    }
+    return table;
+}
+
+constexpr auto GEAR_TABLE = make_gear_table();
+
+static SnapshotFileHeader make_header(const char (&magic)[8]) {
+    SnapshotFileHeader header{};
+    memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    return header;
+}
+
+static bool prepare_file(QFile &file, const char (&magic)[8]) {
+    if (!file.open(QIODevice::ReadWrite)) { return false; }
+    if (file.size() == 0) {
+        const auto header = make_header(magic);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.flush();
+    }
+    SnapshotFileHeader header{};
+    file.seek(0);
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) != HEADER_SIZE
+        || memcmp(header.magic, magic, sizeof(header.magic)) != 0
+        || header.version != SNAPSHOT_VERSION) {
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+static QByteArray hash_of(QByteArrayView data) {
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+}
+
+SnapshotStore::~SnapshotStore() {
+    close();
+}
+
+bool SnapshotStore::open(const QString &dir) {
+    close();
+
+    if (!QDir(dir).exists() && !QDir().mkpath(dir)) { return false; }
+    dir_ = dir;
+    chunks_file_.setFileName(QDir(dir).filePath("CHUNKS"));
+    versions_file_.setFileName(QDir(dir).filePath("VERSIONS"));
+
+    if (!prepare_file(chunks_file_, CHUNKS_MAGIC) || !prepare_file(versions_file_, VERSIONS_MAGIC)
+        || !load_chunks() || !load_versions()) {
+        spdlog::error("failed to open snapshot store {}", dir.toStdString());
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SnapshotStore::close() {
+    if (chunks_file_.isOpen()) { chunks_file_.close(); }
+    if (versions_file_.isOpen()) { versions_file_.close(); }
+    chunks_size_ = 0;
+    chunk_index_.clear();
+    versions_.clear();
+    chapter_versions_.clear();
+    next_id_ = 1;
+}
+
+std::optional<uint64_t> SnapshotStore::record(int cid, const QString &text, qint64 timestamp) {
+    if (!is_open()) { return std::nullopt; }
+    if (timestamp < 0) { timestamp = QDateTime::currentMSecsSinceEpoch(); }
+
+    const auto data = text.toUtf8();
+
+    QList<QByteArray>     hashes{};
+    QList<QByteArrayView> new_chunks{};
+    QSet<QByteArray>      new_hashes{};
+    qsizetype             start = 0;
+    for (const auto end : split_chunks(data)) {
+        const auto chunk = QByteArrayView(data).sliced(start, end - start);
+        auto       hash  = hash_of(chunk);
+        if (!chunk_index_.contains(hash) && !new_hashes.contains(hash)) {
+            new_hashes.insert(hash);
+            new_chunks.append(chunk);
+        }
+        hashes.append(std::move(hash));
+        start = end;
+    }
+
+    if (const auto last = latest(cid); last && versions_[last->id].chunks == hashes) {
+        return last->id;
+    }
+
+    chunks_file_.seek(chunks_size_);
+    for (const auto &chunk : new_chunks) {
+        ChunkRecordHeader header{};
+        const auto        hash = hash_of(chunk);
+        memcpy(header.hash, hash.constData(), HASH_SIZE);
+        header.size = chunk.size();
+        if (chunks_file_.write(reinterpret_cast<const char *>(&header), sizeof(header))
+                != static_cast<qint64>(sizeof(header))
+            || chunks_file_.write(chunk.data(), chunk.size()) != chunk.size()) {
+            //! NOTE: the torn chunk is beyond the indexed ones and dropped on next open
+            spdlog::error("failed to write snapshot chunk to {}", dir_.toStdString());
+            return std::nullopt;
+        }
+        chunk_index_.insert(
+            hash,
+            ChunkRef{
+                .offset = chunks_size_ + static_cast<qint64>(sizeof(header)),
+                .size   = header.size,
+            });
+        chunks_size_ += sizeof(header) + chunk.size();
+    }
+    //! NOTE: chunks must land before the version referencing them
+    if (!chunks_file_.flush()) { return std::nullopt; }
+
+    const SnapshotVersion version{
+        .id        = next_id_,
+        .cid       = cid,
+        .timestamp = timestamp,
+        .size      = data.size(),
+    };
+    if (!append_version(version, hashes)) { return std::nullopt; }
+
+    if (policy_.max_versions > 0
+        && chapter_versions_[cid].size() > policy_.max_versions + PRUNE_SLACK) {
+        prune(timestamp);
+    }
+    return version.id;
+}
+
+QList<SnapshotVersion> SnapshotStore::versions(int cid) const {
+    QList<SnapshotVersion> result{};
+    const auto             ids = chapter_versions_.value(cid);
+    result.reserve(ids.size());
+    for (const auto id : ids) { result.append(versions_[id].info); }
+    return result;
+}
+
+std::optional<SnapshotVersion> SnapshotStore::latest(int cid) const {
+    const auto it = chapter_versions_.constFind(cid);
+    if (it == chapter_versions_.cend() || it->isEmpty()) { return std::nullopt; }
+    return versions_[it->back()].info;
+}
+
+std::optional<QString> SnapshotStore::restore(uint64_t id) {
+    if (!is_open() || !versions_.contains(id)) { return std::nullopt; }
+    const auto &record = versions_[id];
+
+    QByteArray data{};
+    data.reserve(record.info.size);
+    for (const auto &hash : record.chunks) {
+        const auto ref = chunk_index_.value(hash);
+        chunks_file_.seek(ref.offset);
+        const auto chunk = chunks_file_.read(ref.size);
+        if (chunk.size() != ref.size || hash_of(chunk) != hash) {
+            spdlog::error("corrupted snapshot chunk in {}", dir_.toStdString());
+            return std::nullopt;
+        }
+        data.append(chunk);
+    }
+    return QString::fromUtf8(data);
+}
+
+bool SnapshotStore::prune(qint64 now) {
+    if (!is_open()) { return false; }
+    if (now < 0) { now = QDateTime::currentMSecsSinceEpoch(); }
+
+    const qint64 day    = 24 * 60 * 60 * 1000;
+    const qint64 cutoff = policy_.max_age > 0 ? now - policy_.max_age * day : INT64_MIN;
+
+    bool dropped = false;
+    for (auto &ids : chapter_versions_) {
+        const int       total = ids.size();
+        QList<uint64_t> kept{};
+        for (int i = 0; i < total; ++i) {
+            const auto &info      = versions_[ids[i]].info;
+            const bool  is_latest = i + 1 == total;
+            const bool  in_count  = policy_.max_versions <= 0 || total - i <= policy_.max_versions;
+            if (is_latest || (in_count && info.timestamp >= cutoff)) {
+                kept.append(ids[i]);
+            } else {
+                versions_.remove(ids[i]);
+                dropped = true;
+            }
+        }
+        ids = std::move(kept);
+    }
+    if (dropped && !rewrite_versions()) { return false; }
+
+    const auto used       = used_chunks();
+    qint64     used_bytes = 0;
+    for (const auto &hash : used) {
+        used_bytes += sizeof(ChunkRecordHeader) + chunk_index_.value(hash).size;
+    }
+
+    //! NOTE: reclaim the space only if it's worth a rewrite
+    const qint64 garbage = chunks_size_ - HEADER_SIZE - used_bytes;
+    if (garbage > 0 && garbage * 2 >= chunks_size_ - HEADER_SIZE) { return rewrite_chunks(used); }
+    return true;
+}
+
+QList<qsizetype> SnapshotStore::split_chunks(QByteArrayView data) {
+    QList<qsizetype> bounds{};
+    const auto       size  = data.size();
+    qsizetype        start = 0;
+    while (start < size) {
+        if (size - start <= MIN_CHUNK_SIZE) {
+            bounds.append(size);
+            break;
+        }
+        const auto end  = qMin<qsizetype>(start + MAX_CHUNK_SIZE, size);
+        qsizetype  cut  = end;
+        uint64_t   hash = 0;
+        for (qsizetype i = start + MIN_CHUNK_SIZE; i < end; ++i) {
+            hash = (hash << 1) + GEAR_TABLE[static_cast<uint8_t>(data[i])];
+            if ((hash & CHUNK_MASK) == 0) {
+                cut = i + 1;
+                break;
+            }
+        }
+        bounds.append(cut);
+        start = cut;
+    }
+    return bounds;
+}
+
+bool SnapshotStore::load_chunks() {
+    const qint64 file_size = chunks_file_.size();
+    qint64       offset    = HEADER_SIZE;
+    while (file_size - offset >= static_cast<qint64>(sizeof(ChunkRecordHeader))) {
+        ChunkRecordHeader header{};
+        chunks_file_.seek(offset);
+        chunks_file_.read(reinterpret_cast<char *>(&header), sizeof(header));
+        const qint64 end = offset + sizeof(header) + header.size;
+        if (header.size == 0 || header.size > MAX_CHUNK_SIZE || end > file_size) { break; }
+        const auto hash = QByteArray(reinterpret_cast<const char *>(header.hash), HASH_SIZE);
+        chunk_index_.insert(
+            hash,
+            ChunkRef{
+                .offset = offset + static_cast<qint64>(sizeof(header)),
+                .size   = header.size,
+            });
+        offset = end;
+    }
+    //! NOTE: drop the torn tail
+    if (offset < file_size && !chunks_file_.resize(offset)) { return false; }
+    chunks_size_ = offset;
+    return true;
+}
+
+bool SnapshotStore::load_versions() {
+    versions_file_.seek(0);
+    const auto data   = versions_file_.readAll();
+    qsizetype  offset = HEADER_SIZE;
+    while (data.size() - offset >= static_cast<qsizetype>(sizeof(VersionRecordHeader))) {
+        VersionRecordHeader header{};
+        memcpy(&header, data.constData() + offset, sizeof(header));
+        const auto payload = static_cast<qsizetype>(header.chunk_count) * HASH_SIZE;
+        const auto total   = static_cast<qsizetype>(sizeof(header)) + payload;
+        if (payload > data.size() || offset + total > data.size()) { break; }
+
+        QByteArray record   = data.mid(offset, total);
+        const auto checksum = header.checksum;
+        memset(record.data() + offsetof(VersionRecordHeader, checksum), 0, sizeof(checksum));
+        if (qChecksum(record) != checksum) { break; }
+
+        VersionRecord version{};
+        version.info = SnapshotVersion{
+            .id        = header.id,
+            .cid       = header.cid,
+            .timestamp = header.timestamp,
+            .size      = static_cast<qint64>(header.size),
+        };
+        bool complete = true;
+        for (uint32_t i = 0; i < header.chunk_count; ++i) {
+            auto hash = record.mid(sizeof(header) + i * HASH_SIZE, HASH_SIZE);
+            complete  = complete && chunk_index_.contains(hash);
+            version.chunks.append(std::move(hash));
+        }
+        offset += total;
+
+        next_id_ = qMax(next_id_, header.id + 1);
+        if (!complete) {
+            spdlog::warn("drop incomplete snapshot {} in {}", header.id, dir_.toStdString());
+            continue;
+        }
+        chapter_versions_[header.cid].append(header.id);
+        versions_.insert(header.id, std::move(version));
+    }
+    //! NOTE: drop the torn tail
+    if (offset < data.size() && !versions_file_.resize(offset)) { return false; }
+    return true;
+}
+
+static QByteArray
+    serialize_version(const SnapshotVersion &version, const QList<QByteArray> &chunks) {
+    VersionRecordHeader header{};
+    header.id          = version.id;
+    header.timestamp   = version.timestamp;
+    header.size        = version.size;
+    header.cid         = version.cid;
+    header.chunk_count = chunks.size();
+
+    QByteArray record(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const auto &hash : chunks) { record.append(hash); }
+    const auto checksum = qChecksum(record);
+    memcpy(record.data() + offsetof(VersionRecordHeader, checksum), &checksum, sizeof(checksum));
+    return record;
+}
+
+bool SnapshotStore::append_version(
+    const SnapshotVersion &version, const QList<QByteArray> &chunks) {
+    const auto record = serialize_version(version, chunks);
+    versions_file_.seek(versions_file_.size());
+    if (versions_file_.write(record) != record.size() || !versions_file_.flush()) {
+        spdlog::error("failed to write snapshot version to {}", dir_.toStdString());
+        return false;
+    }
+    versions_.insert(version.id, VersionRecord{.info = version, .chunks = chunks});
+    chapter_versions_[version.cid].append(version.id);
+    next_id_ = qMax(next_id_, version.id + 1);
+    return true;
+}
+
+bool SnapshotStore::rewrite_versions() {
+    QList<uint64_t> ids = versions_.keys();
+    std::sort(ids.begin(), ids.end());
+
+    QSaveFile  file(versions_file_.fileName());
+    const auto header = make_header(VERSIONS_MAGIC);
+    if (!file.open(QIODevice::WriteOnly)) { return false; }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const auto id : ids) {
+        const auto &record = versions_[id];
+        file.write(serialize_version(record.info, record.chunks));
+    }
+
+    versions_file_.close();
+    const bool succeed = file.commit();
+    if (!succeed) { spdlog::error("failed to rewrite snapshot versions {}", dir_.toStdString()); }
+    //! NOTE: the dropped versions stay in the file on failure, they are dropped again next time
+    return prepare_file(versions_file_, VERSIONS_MAGIC) && succeed;
+}
+
+QSet<QByteArray> SnapshotStore::used_chunks() const {
+    QSet<QByteArray> used{};
+    for (const auto &record : versions_) {
+        for (const auto &hash : record.chunks) { used.insert(hash); }
+    }
+    return used;
+}
+
+bool SnapshotStore::rewrite_chunks(const QSet<QByteArray> &used) {
+    QSaveFile  file(chunks_file_.fileName());
+    const auto header = make_header(CHUNKS_MAGIC);
+    if (!file.open(QIODevice::WriteOnly)) { return false; }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    QHash<QByteArray, ChunkRef> index{};
+    qint64                      offset = HEADER_SIZE;
+    for (const auto &[hash, ref] : chunk_index_.asKeyValueRange()) {
+        if (!used.contains(hash)) { continue; }
+        chunks_file_.seek(ref.offset);
+        const auto chunk = chunks_file_.read(ref.size);
+        if (chunk.size() != ref.size) { return false; }
+        ChunkRecordHeader rec{};
+        memcpy(rec.hash, hash.constData(), HASH_SIZE);
+        rec.size = ref.size;
+        file.write(reinterpret_cast<const char *>(&rec), sizeof(rec));
+        file.write(chunk);
+        index.insert(
+            hash,
+            ChunkRef{
+                .offset = offset + static_cast<qint64>(sizeof(rec)),
+                .size   = ref.size,
+            });
+        offset += sizeof(rec) + ref.size;
+    }
+
+    chunks_file_.close();
+    const bool succeed = file.commit();
+    if (succeed) {
+        chunk_index_ = std::move(index);
+        chunks_size_ = offset;
+    } else {
+        spdlog::error("failed to rewrite snapshot chunks {}", dir_.toStdString());
+    }
+    return prepare_file(chunks_file_, CHUNKS_MAGIC) && succeed;
+}
+
+} // namespace jwrite
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <optional>
+#include <stdint.h>
+
+namespace jwrite {
+
+struct SnapshotVersion {
+    uint64_t id;
+    int      cid;
+    //! in units of millisecond since epoch
+    qint64   timestamp;
+    //! size of the utf-8 text in bytes
+    qint64   size;
+};
+
+/*!
+ * \brief per-book history of the chapter versions
+ *
+ * \note each version is split into content-defined chunks, i.e. the boundaries are decided by a
+ * rolling hash over the content instead of fixed offsets, so an edit only changes the chunks
+ * around it; chunks are stored once by their hash, and a version is merely the list of its chunk
+ * hashes, so keeping a version costs the edited chunks plus a few bytes per chunk
+ *
+ * \note chunks and versions live in two append-only files, a torn tail left by an unclean exit
+ * is dropped on open; chunks are always written before the version referencing them
+ */
+class SnapshotStore {
+public:
+    struct RetentionPolicy {
+        //! max versions kept per chapter
+        int max_versions = 64;
+        //! versions older than this are dropped, in units of day
+        int max_age      = 90;
+    };
+
+    //! in units of byte
+    constexpr static int MIN_CHUNK_SIZE = 512;
+    constexpr static int AVG_CHUNK_SIZE = 2048;
+    constexpr static int MAX_CHUNK_SIZE = 8192;
+
+    SnapshotStore() = default;
+    ~SnapshotStore();
+
+    SnapshotStore(const SnapshotStore &)            = delete;
+    SnapshotStore &operator=(const SnapshotStore &) = delete;
+
+    /*!
+     * \param [in] dir directory of the store, created if not exists
+     */
+    bool open(const QString &dir);
+    void close();
+
+    bool is_open() const {
+        return chunks_file_.isOpen() && versions_file_.isOpen();
+    }
+
+    void set_retention_policy(const RetentionPolicy &policy) {
+        policy_ = policy;
+    }
+
+    const RetentionPolicy &retention_policy() const {
+        return policy_;
+    }
+
+    /*!
+     * \brief record a new version of the chapter
+     *
+     * \return id of the version, the latest one if the text is unchanged since then
+     */
+    std::optional<uint64_t> record(int cid, const QString &text, qint64 timestamp = -1);
+
+    /*!
+     * \return versions of the chapter, the oldest first
+     */
+    QList<SnapshotVersion> versions(int cid) const;
+
+    std::optional<SnapshotVersion> latest(int cid) const;
+
+    std::optional<QString> restore(uint64_t id);
+
+    /*!
+     * \brief drop the versions out of the retention policy and reclaim the unused chunks
+     *
+     * \note the latest version of every chapter is always kept
+     */
+    bool prune(qint64 now = -1);
+
+    int total_chunks() const {
+        return chunk_index_.size();
+    }
+
+    qint64 stored_size() const {
+        return chunks_size_;
+    }
+
+    /*!
+     * \return boundaries of the content-defined chunks, i.e. the end offset of each chunk
+     */
+    static QList<qsizetype> split_chunks(QByteArrayView data);
+
+protected:
+    bool load_chunks();
+    bool load_versions();
+    bool append_version(const SnapshotVersion &version, const QList<QByteArray> &chunks);
+    bool rewrite_versions();
+    bool rewrite_chunks(const QSet<QByteArray> &used);
+
+    QSet<QByteArray> used_chunks() const;
+
+private:
+    struct ChunkRef {
+        qint64   offset;
+        uint32_t size;
+    };
+
+    struct VersionRecord {
+        SnapshotVersion   info;
+        QList<QByteArray> chunks;
+    };
+
+    QString                        dir_;
+    QFile                          chunks_file_;
+    QFile                          versions_file_;
+    qint64                         chunks_size_ = 0;
+    QHash<QByteArray, ChunkRef>    chunk_index_;
+    QHash<uint64_t, VersionRecord> versions_;
+    //! NOTE: ids of the versions of each chapter, the oldest first
+    QHash<int, QList<uint64_t>>    chapter_versions_;
+    uint64_t                       next_id_ = 1;
+    RetentionPolicy                policy_;
+};
+
+} // namespace jwrite
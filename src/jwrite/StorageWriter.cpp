@@ -0,0 +1,134 @@
+#include <jwrite/StorageWriter.h>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <spdlog/spdlog.h>
+
+namespace jwrite {
+
+StorageWriter::StorageWriter(QObject *parent)
+    : QObject(parent)
+    , busy_{false}
+    , stopping_{false}
+    , failed_{false}
+    , last_batch_{0}
+    , synced_batch_{0} {
+    thread_ = QThread::create([this] {
+        run();
+    });
+    thread_->start();
+}
+
+StorageWriter::~StorageWriter() {
+    {
+        QMutexLocker locker(&lock_);
+        stopping_ = true;
+        job_cond_.wakeAll();
+    }
+    //! NOTE: the pending jobs are drained before the thread quits
+    thread_->wait();
+    delete thread_;
+}
+
+int StorageWriter::submit(const QList<StorageWriteJob> &jobs) {
+    QMutexLocker locker(&lock_);
+    for (const auto &job : jobs) {
+        if (auto it = jobs_.find(job.path); it != jobs_.end()) {
+            it->content    = job.content;
+            it->encoder    = job.encoder;
+            it->on_written = job.on_written;
+        } else {
+            jobs_.insert(
+                job.path,
+                PendingJob{
+                    .content    = job.content,
+                    .encoder    = job.encoder,
+                    .on_written = job.on_written,
+                });
+            queue_.append(job.path);
+        }
+    }
+    const int batch = ++last_batch_;
+    if (!queue_.isEmpty()) {
+        job_cond_.wakeOne();
+        return batch;
+    }
+
+    //! NOTE: nothing to write, the batch is synced as long as the writer is idle
+    if (busy_) { return batch; }
+    if (!failed_) { synced_batch_ = batch; }
+    const int synced = synced_batch_;
+    locker.unlock();
+    emit on_synced(synced);
+    return batch;
+}
+
+void StorageWriter::wait_for_done() {
+    QMutexLocker locker(&lock_);
+    while (busy_ || !queue_.isEmpty()) { done_cond_.wait(&lock_); }
+}
+
+int StorageWriter::synced_batch() const {
+    QMutexLocker locker(&lock_);
+    return synced_batch_;
+}
+
+int StorageWriter::total_pending() const {
+    QMutexLocker locker(&lock_);
+    return queue_.size() + (busy_ ? 1 : 0);
+}
+
+bool StorageWriter::write_atomically(const QString &path, const QByteArray &data) {
+    if (const auto dir = QFileInfo(path).absoluteDir(); !dir.exists()) { dir.mkpath("."); }
+
+    //! NOTE: QSaveFile writes to a temporary file, syncs it to disk and renames it on commit
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) { return false; }
+    //! NOTE: the temporary file is discarded if not committed
+    if (file.write(data) != data.size()) { return false; }
+    return file.commit();
+}
+
+void StorageWriter::run() {
+    QMutexLocker locker(&lock_);
+    while (true) {
+        while (queue_.isEmpty() && !stopping_) { job_cond_.wait(&lock_); }
+        if (queue_.isEmpty()) { break; }
+
+        const auto path = queue_.takeFirst();
+        const auto job  = jobs_.take(path);
+        busy_           = true;
+        locker.unlock();
+
+        QByteArray data{};
+        if (const auto text = std::get_if<QString>(&job.content)) {
+            data = job.encoder ? job.encoder(*text) : text->toUtf8();
+        } else {
+            data = std::get<QByteArray>(job.content);
+        }
+
+        const bool succeed = write_atomically(path, data);
+        if (!succeed) {
+            spdlog::error("failed to write {}", path.toStdString());
+            emit on_write_failed(path);
+        } else if (job.on_written) {
+            job.on_written();
+        }
+
+        locker.relock();
+        busy_ = false;
+        if (!succeed) { failed_ = true; }
+        if (queue_.isEmpty()) {
+            //! NOTE: a failed job is never retried here, the next batch rewrites the dirty files
+            if (!failed_) { synced_batch_ = last_batch_; }
+            failed_         = false;
+            const int batch = synced_batch_;
+            locker.unlock();
+            emit on_synced(batch);
+            locker.relock();
+            done_cond_.wakeAll();
+        }
+    }
+}
+
+} // namespace jwrite
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+#include <QString>
+#include <QHash>
+#include <QList>
+#include <functional>
+#include <variant>
+
+namespace jwrite {
+
+struct StorageWriteJob {
+    using Encoder  = std::function<QByteArray(const QString &)>;
+    using Callback = std::function<void()>;
+
+    QString path;
+    //! NOTE: text is encoded as utf-8 on the writer thread
+    std::variant<QByteArray, QString> content;
+    //! NOTE: custom encoding of the text, also called on the writer thread
+    Encoder encoder = {};
+    //! NOTE: called on the writer thread once the file is written successfully
+    Callback on_written = {};
+};
+
+/*!
+ * \brief dedicated thread that persists file snapshots atomically
+ *
+ * \note each file is written to a temporary file, synced to disk and then renamed over the target,
+ * so that a crash never leaves a truncated file behind
+ *
+ * \note jobs are queued in batches, a pending job of the same path is replaced by the newer
+ * snapshot in place; batches are enqueued atomically, so the writer is always idle at a batch
+ * boundary and the files on disk reflect exactly the latest synced batch
+ */
+class StorageWriter : public QObject {
+    Q_OBJECT
+
+signals:
+    /*!
+     * \brief emitted on the writer thread once the queue is drained
+     */
+    void on_synced(int batch);
+    void on_write_failed(const QString &path);
+
+public:
+    explicit StorageWriter(QObject *parent = nullptr);
+    ~StorageWriter() override;
+
+    /*!
+     * \return id of the batch, increases monotonically
+     */
+    int submit(const QList<StorageWriteJob> &jobs);
+
+    /*!
+     * \brief block until the queue is drained
+     */
+    void wait_for_done();
+
+    /*!
+     * \return the latest batch whose jobs and all the earlier jobs are written successfully, 0 if
+     * there is none
+     */
+    int synced_batch() const;
+
+    int total_pending() const;
+
+    static bool write_atomically(const QString &path, const QByteArray &data);
+
+protected:
+    void run();
+
+private:
+    struct PendingJob {
+        std::variant<QByteArray, QString> content;
+        StorageWriteJob::Encoder          encoder;
+        StorageWriteJob::Callback         on_written;
+    };
+
+    QThread                   *thread_;
+    mutable QMutex             lock_;
+    QWaitCondition             job_cond_;
+    QWaitCondition             done_cond_;
+    QList<QString>             queue_;
+    QHash<QString, PendingJob> jobs_;
+    bool                       busy_;
+    bool                       stopping_;
+    bool                       failed_;
+    int                        last_batch_;
+    int                        synced_batch_;
+};
+
+} // namespace jwrite
@@ -46,6 +46,7 @@ void TextBlock::mark_as_dirty(int line_nr) {
     Q_ASSERT(line_nr >= 0 && line_nr < lines.size());
     dirty_line_nr = !is_dirty() ? line_nr : qMin(dirty_line_nr, line_nr);
     parent->mark_as_dirty();
+    revision = parent->revision;
 }
 
 bool TextBlock::is_dirty() const {
@@ -140,6 +141,7 @@ void TextViewEngine::CursorPosition::reset() {
 TextViewEngine::TextViewEngine(const QFontMetrics &metrics, int width)
     : fm(metrics) {
     text_ref = nullptr;
+    revision = 0;
     reset_block_spacing(6.0);
     reset_line_spacing(1.0);
     reset(metrics, width);
@@ -193,6 +195,7 @@ bool TextViewEngine::is_cursor_available() const {
 
 void TextViewEngine::mark_as_dirty() {
     dirty = true;
+    ++revision;
 }
 
 TextLine &TextViewEngine::current_line() {
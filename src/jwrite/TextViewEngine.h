@@ -35,6 +35,9 @@ struct TextBlock {
     QVector<TextLine> lines;
 
     int dirty_line_nr;
+    //! NOTE: engine revision of the last invalidation, it changes whenever the text of the block
+    //! changes, so that it is safe to use as a cache key of the block content
+    int revision;
 
     void            reset(const QString *ref, int pos);
     void            mark_as_dirty(int line_nr);
@@ -83,6 +86,8 @@ struct TextViewEngine {
     const QString *preedit_text_ref;
 
     bool dirty;
+    //! NOTE: bumped on every layout invalidation, used to validate caches derived from the layout
+    int revision;
 
     QList<TextBlock *> block_pool;
 
@@ -1,54 +1,384 @@
 #include <jwrite/Tokenizer.h>
+#include <jwrite/AppConfig.h>
 #include <QtConcurrent/QtConcurrent>
 #include <QCoreApplication>
+#include <algorithm>
 #include <vector>
-#include <string>
 
 namespace jwrite {
 
+//! NOTE: max length of the text window to segment when looking for the first/last word
+constexpr int MAX_WORD_WINDOW = 16;
+
+//! NOTE: max length of a dictionary word in runes, same as cppjieba::MAX_WORD_LENGTH
+constexpr int MAX_WORD_LENGTH = 512;
+
+//! NOTE: same as cppjieba::MIN_DOUBLE
+constexpr double MIN_LOG_PROB = -3.14e+100;
+
+struct TokenizerRune {
+    uint32_t rune;
+    //! offset in utf-16 units
+    int      offset;
+    //! length in utf-16 units
+    int      len;
+};
+
+//! NOTE: scratch buffers of the segmentation, reused across calls
+struct TokenizerScratch {
+    struct Route {
+        double weight;
+        int    last;
+    };
+
+    std::vector<TokenizerRune> runes;
+    std::vector<Route>         route;
+    std::vector<int>           mp_words;
+    std::vector<double>        hmm_weight;
+    std::vector<int>           hmm_path;
+};
+
+static inline bool is_separator(uint32_t rune) {
+    //! NOTE: keep in sync with cppjieba::SPECIAL_SEPARATORS
+    switch (rune) {
+        case U' ':
+        case U'\t':
+        case U'\n':
+        case U'\uff0c':
+        case U'\u3002': {
+            return true;
+        } break;
+        default: {
+            return false;
+        } break;
+    }
+}
+
+static inline bool is_ascii_letter(uint32_t rune) {
+    return (rune >= 'a' && rune <= 'z') || (rune >= 'A' && rune <= 'Z');
+}
+
+static inline bool is_ascii_digit(uint32_t rune) {
+    return rune >= '0' && rune <= '9';
+}
+
+static inline void append_word_end(
+    const TokenizerScratch &scratch, int last, QList<int> &boundaries) {
+    const auto &rune = scratch.runes[last];
+    boundaries.append(rune.offset + rune.len);
+}
+
+/*!
+ * \brief max probability segmentation of runes [begin, end) over the dictionary
+ *
+ * \note emits the index of the last rune of each word into scratch.mp_words
+ */
+static void cut_mp(const TokenizerDict &dict, TokenizerScratch &scratch, int begin, int end) {
+    const int  n     = end - begin;
+    auto      &route = scratch.route;
+    const auto runes = scratch.runes.data() + begin;
+
+    route.resize(n + 1);
+    route[n] = {0.0, n};
+    for (int i = n - 1; i >= 0; --i) {
+        int          node   = dict.child_of(dict.root(), runes[i].rune);
+        const bool   known  = node != -1 && dict.is_word(node);
+        const double weight = known ? dict.weight_of(node) : dict.min_weight();
+        route[i]            = {MIN_LOG_PROB, i};
+        if (const double value = weight + route[i + 1].weight; value > route[i].weight) {
+            route[i] = {value, i};
+        }
+        for (int j = i + 1; node != -1 && j < n && j - i + 1 <= MAX_WORD_LENGTH; ++j) {
+            node = dict.child_of(node, runes[j].rune);
+            if (node == -1) { break; }
+            if (!dict.is_word(node)) { continue; }
+            if (const double value = dict.weight_of(node) + route[j + 1].weight;
+                value > route[i].weight) {
+                route[i] = {value, j};
+            }
+        }
+    }
+
+    scratch.mp_words.clear();
+    for (int i = 0; i < n; i = route[i].last + 1) {
+        scratch.mp_words.push_back(begin + route[i].last);
+    }
+}
+
+/*!
+ * \brief hmm segmentation of runes [begin, end) which contains no ascii runes
+ */
+static void cut_viterbi(
+    const TokenizerDict &dict,
+    TokenizerScratch    &scratch,
+    int                  begin,
+    int                  end,
+    QList<int>          &boundaries) {
+    constexpr int Y = TokenizerDict::STATE_TOTAL;
+
+    const int X      = end - begin;
+    auto     &weight = scratch.hmm_weight;
+    auto     &path   = scratch.hmm_path;
+    weight.resize(X * Y);
+    path.resize(X * Y);
+
+    const auto emit_prob = [&](int x, int y) {
+        const auto emit = dict.find_emit(scratch.runes[begin + x].rune);
+        return emit ? emit->prob[y] : MIN_LOG_PROB;
+    };
+
+    for (int y = 0; y < Y; ++y) {
+        weight[y * X] = dict.start_prob(y) + emit_prob(0, y);
+        path[y * X]   = -1;
+    }
+    for (int x = 1; x < X; ++x) {
+        const auto emit = dict.find_emit(scratch.runes[begin + x].rune);
+        for (int y = 0; y < Y; ++y) {
+            const int    now  = x + y * X;
+            const double prob = emit ? emit->prob[y] : MIN_LOG_PROB;
+            weight[now]       = MIN_LOG_PROB;
+            path[now]         = TokenizerDict::E;
+            for (int prev = 0; prev < Y; ++prev) {
+                const int    old   = x - 1 + prev * X;
+                const double value = weight[old] + dict.trans_prob(prev, y) + prob;
+                if (value > weight[now]) {
+                    weight[now] = value;
+                    path[now]   = prev;
+                }
+            }
+        }
+    }
+
+    const double end_e = weight[X - 1 + TokenizerDict::E * X];
+    const double end_s = weight[X - 1 + TokenizerDict::S * X];
+    int          state = end_e >= end_s ? TokenizerDict::E : TokenizerDict::S;
+
+    //! NOTE: backtrack the states and collect the word ends, i.e. the E and S states
+    const int from = boundaries.size();
+    for (int x = X - 1; x >= 0; --x) {
+        const int prev = path[x + state * X];
+        if (state == TokenizerDict::E || state == TokenizerDict::S) {
+            append_word_end(scratch, begin + x, boundaries);
+        }
+        state = prev;
+    }
+    std::reverse(boundaries.begin() + from, boundaries.end());
+}
+
+/*!
+ * \brief hmm segmentation of runes [begin, end), ascii letters and numbers are cut by rules
+ */
+static void cut_hmm(
+    const TokenizerDict &dict,
+    TokenizerScratch    &scratch,
+    int                  begin,
+    int                  end,
+    QList<int>          &boundaries) {
+    const auto &runes = scratch.runes;
+    int         left  = begin;
+    int         right = begin;
+    while (right != end) {
+        if (runes[right].rune >= 0x80) {
+            ++right;
+            continue;
+        }
+        if (left != right) { cut_viterbi(dict, scratch, left, right, boundaries); }
+        left = right;
+        if (is_ascii_letter(runes[right].rune)) {
+            ++right;
+            while (right != end
+                   && (is_ascii_letter(runes[right].rune) || is_ascii_digit(runes[right].rune))) {
+                ++right;
+            }
+        } else if (is_ascii_digit(runes[right].rune)) {
+            ++right;
+            while (right != end
+                   && (is_ascii_digit(runes[right].rune) || runes[right].rune == '.')) {
+                ++right;
+            }
+        } else {
+            ++right;
+        }
+        append_word_end(scratch, right - 1, boundaries);
+        left = right;
+    }
+    if (left != right) { cut_viterbi(dict, scratch, left, right, boundaries); }
+}
+
+/*!
+ * \brief mixed segmentation of runes [begin, end), consecutive single runes that are not words of
+ * the user dictionary are segmented again with the hmm model
+ */
+static void cut_mixed(
+    const TokenizerDict &dict,
+    TokenizerScratch    &scratch,
+    int                  begin,
+    int                  end,
+    QList<int>          &boundaries) {
+    cut_mp(dict, scratch, begin, end);
+
+    const auto &words    = scratch.mp_words;
+    const auto  is_plain = [&](int i) {
+        const int first = i == 0 ? begin : words[i - 1] + 1;
+        return first == words[i] && !dict.is_user_single_word(scratch.runes[first].rune);
+    };
+
+    const int total = words.size();
+    for (int i = 0; i < total;) {
+        if (!is_plain(i)) {
+            append_word_end(scratch, words[i], boundaries);
+            ++i;
+            continue;
+        }
+        const int first = i == 0 ? begin : words[i - 1] + 1;
+        int       j     = i;
+        while (j < total && is_plain(j)) { ++j; }
+        cut_hmm(dict, scratch, first, words[j - 1] + 1, boundaries);
+        i = j;
+    }
+}
+
 QFuture<Tokenizer *> Tokenizer::build() {
-    return QtConcurrent::run([] {
-        const auto dir      = QCoreApplication::applicationDirPath() + "/dicts";
-        auto       instance = new Tokenizer;
-        instance->cutter_   = std::make_unique<cppjieba::Jieba>(
-            (dir + "/jieba.dict.utf8").toLocal8Bit().toStdString(),
-            (dir + "/hmm_model.utf8").toLocal8Bit().toStdString(),
-            (dir + "/user.dict.utf8").toLocal8Bit().toStdString(),
-            (dir + "/idf.utf8").toLocal8Bit().toStdString(),
-            (dir + "/stop_words.utf8").toLocal8Bit().toStdString());
+    const auto source_dir = QCoreApplication::applicationDirPath() + "/dicts";
+    const auto cache_path =
+        AppConfig::get_instance().path(AppConfig::StandardPath::Cache) + "/jieba.dict.bin";
+    return QtConcurrent::run([source_dir, cache_path] {
+        auto instance   = new Tokenizer;
+        instance->dict_ = TokenizerDict::open(source_dir, cache_path);
         return instance;
     });
 }
 
 Tokenizer &Tokenizer::get_instance() {
-    static std::unique_ptr<Tokenizer> instance{};
-    if (!instance) { instance.reset(Tokenizer::build().result()); }
+    //! NOTE: initialization of the local static is thread-safe, the instance may be requested
+    //! from the workers of background jobs
+    static std::unique_ptr<Tokenizer> instance(Tokenizer::build().result());
     return *instance;
 }
 
+void Tokenizer::cut_boundaries(QStringView text, QList<int> &boundaries) const {
+    thread_local TokenizerScratch scratch{};
+
+    boundaries.clear();
+    boundaries.append(0);
+    if (text.isEmpty()) { return; }
+
+    auto &runes = scratch.runes;
+    runes.clear();
+    const int len = text.length();
+    for (int i = 0; i < len;) {
+        const auto c = text[i];
+        if (c.isHighSurrogate() && i + 1 < len && text[i + 1].isLowSurrogate()) {
+            runes.push_back({QChar::surrogateToUcs4(c, text[i + 1]), i, 2});
+            i += 2;
+        } else {
+            runes.push_back({c.unicode(), i, 1});
+            ++i;
+        }
+    }
+
+    const int total = runes.size();
+
+    //! NOTE: every rune is taken as a word if the dictionary is unavailable
+    if (!dict_) {
+        for (int i = 0; i < total; ++i) { append_word_end(scratch, i, boundaries); }
+        return;
+    }
+
+    int from = 0;
+    for (int i = 0; i < total; ++i) {
+        if (!is_separator(runes[i].rune)) { continue; }
+        if (from != i) { cut_mixed(*dict_, scratch, from, i, boundaries); }
+        append_word_end(scratch, i, boundaries);
+        from = i + 1;
+    }
+    if (from != total) { cut_mixed(*dict_, scratch, from, total, boundaries); }
+
+    Q_ASSERT(boundaries.back() == len);
+}
+
+int Tokenizer::get_last_word_length(QStringView text) const {
+    if (text.isEmpty()) { return 0; }
+    thread_local QList<int> boundaries{};
+    const auto              window = text.right(MAX_WORD_WINDOW);
+    cut_boundaries(window, boundaries);
+    Q_ASSERT(boundaries.size() >= 2);
+    return window.length() - boundaries[boundaries.size() - 2];
+}
+
+int Tokenizer::get_first_word_length(QStringView text) const {
+    if (text.isEmpty()) { return 0; }
+    thread_local QList<int> boundaries{};
+    cut_boundaries(text.left(MAX_WORD_WINDOW), boundaries);
+    Q_ASSERT(boundaries.size() >= 2);
+    return boundaries[1];
+}
+
+bool Tokenizer::contains(QStringView word) const {
+    if (!dict_ || word.isEmpty()) { return false; }
+    const int len  = word.length();
+    int       node = dict_->root();
+    for (int i = 0; i < len && node != -1; ++i) {
+        uint32_t rune = word[i].unicode();
+        if (word[i].isHighSurrogate() && i + 1 < len && word[i + 1].isLowSurrogate()) {
+            rune = QChar::surrogateToUcs4(word[i], word[i + 1]);
+            ++i;
+        }
+        node = dict_->child_of(node, rune);
+    }
+    return node != -1 && dict_->is_word(node);
+}
+
 QStringList Tokenizer::cut(const QString &sentence) const {
     if (sentence.isEmpty()) { return {}; }
-    std::vector<std::string> words{};
-    cutter_->Cut(sentence.toStdString(), words, true);
+    QList<int> boundaries{};
+    cut_boundaries(sentence, boundaries);
     QStringList results{};
-    for (const auto &word : words) { results << QString::fromStdString(word); }
+    for (int i = 1; i < boundaries.size(); ++i) {
+        results << sentence.mid(boundaries[i - 1], boundaries[i] - boundaries[i - 1]);
+    }
     return results;
 }
 
 QString Tokenizer::get_last_word(const QString &sentence) const {
-    if (sentence.isEmpty()) { return ""; }
-    const int                max_len = 16;
-    std::vector<std::string> words{};
-    cutter_->Cut(sentence.right(max_len).toStdString(), words, true);
-    return QString::fromStdString(words.back());
+    return sentence.right(get_last_word_length(sentence));
 }
 
 QString Tokenizer::get_first_word(const QString &sentence) const {
-    if (sentence.isEmpty()) { return ""; }
-    const int                max_len = 16;
-    std::vector<std::string> words{};
-    cutter_->Cut(sentence.left(max_len).toStdString(), words, true);
-    return QString::fromStdString(words.front());
+    return sentence.left(get_first_word_length(sentence));
+}
+
+void BlockWordBoundaries::reset() {
+    records_.clear();
+}
+
+const QList<int> &BlockWordBoundaries::get(const Tokenizer &tokenizer, const TextBlock *block) {
+    Q_ASSERT(block);
+    if (auto it = records_.find(block); it != records_.end()) {
+        if (it->revision == block->revision) { return it->boundaries; }
+    } else if (records_.size() >= MAX_RECORDS) {
+        records_.clear();
+    }
+    auto &rec    = records_[block];
+    rec.revision = block->revision;
+    tokenizer.cut_boundaries(block->text(), rec.boundaries);
+    return rec.boundaries;
+}
+
+int BlockWordBoundaries::find_prev(const Tokenizer &tokenizer, const TextBlock *block, int pos) {
+    const auto &boundaries = get(tokenizer, block);
+    Q_ASSERT(pos >= 0 && pos <= boundaries.back());
+    if (pos == 0) { return 0; }
+    const auto it = std::lower_bound(boundaries.begin(), boundaries.end(), pos);
+    Q_ASSERT(it != boundaries.begin());
+    return *std::prev(it);
+}
+
+int BlockWordBoundaries::find_next(const Tokenizer &tokenizer, const TextBlock *block, int pos) {
+    const auto &boundaries = get(tokenizer, block);
+    Q_ASSERT(pos >= 0 && pos <= boundaries.back());
+    const auto it = std::upper_bound(boundaries.begin(), boundaries.end(), pos);
+    return it != boundaries.end() ? *it : boundaries.back();
 }
 
 } // namespace jwrite
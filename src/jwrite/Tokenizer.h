@@ -1,23 +1,93 @@
 #pragma once
 
-#include <cppjieba/Jieba.hpp>
+#include <jwrite/TokenizerDict.h>
+#include <jwrite/TextViewEngine.h>
 #include <QtCore>
 #include <QFuture>
 #include <memory>
 
 namespace jwrite {
 
+/*!
+ * \brief chinese word segmentation over a precompiled dictionary
+ *
+ * \note implements the mixed segmentation of cppjieba, i.e. max probability segmentation over the
+ * dictionary and the hmm model for the consecutive unknown single characters
+ */
 class Tokenizer {
 public:
     static QFuture<Tokenizer *> build();
     static Tokenizer           &get_instance();
 
+    /*!
+     * \brief segment utf-16 text into words in place
+     *
+     * \param [in] text text to segment
+     * \param [out] boundaries word boundaries in utf-16 units, starts with 0 and ends with
+     * text.length(), so that the i-th word is text[boundaries[i], boundaries[i + 1])
+     *
+     * \note the buffer is cleared but its capacity is kept, pass the same buffer in repeated calls
+     * to avoid allocation; surrogate pairs are never split
+     */
+    void cut_boundaries(QStringView text, QList<int> &boundaries) const;
+
+    /*!
+     * \return length of the last word of the text in utf-16 units, 0 if the text is empty
+     */
+    int get_last_word_length(QStringView text) const;
+
+    /*!
+     * \return length of the first word of the text in utf-16 units, 0 if the text is empty
+     */
+    int get_first_word_length(QStringView text) const;
+
+    /*!
+     * \return whether the word is in the dictionary, always false if the dictionary is unavailable
+     */
+    bool contains(QStringView word) const;
+
     QStringList cut(const QString &sentence) const;
     QString     get_last_word(const QString &sentence) const;
     QString     get_first_word(const QString &sentence) const;
 
 private:
-    std::unique_ptr<cppjieba::Jieba> cutter_;
+    std::unique_ptr<TokenizerDict> dict_;
+};
+
+/*!
+ * \brief word boundaries of the text blocks, segmented lazily on the first query and cached per
+ * block
+ *
+ * \note records are keyed by the block and its revision, so that an edit of the block invalidates
+ * its boundaries; the whole block is segmented at once, so words are never cut by a text window
+ */
+class BlockWordBoundaries {
+public:
+    void reset();
+
+    const QList<int> &get(const Tokenizer &tokenizer, const TextBlock *block);
+
+    /*!
+     * \return the closest word boundary before pos in the block, 0 if pos is 0
+     */
+    int find_prev(const Tokenizer &tokenizer, const TextBlock *block, int pos);
+
+    /*!
+     * \return the closest word boundary after pos in the block, length of the block if pos is at
+     * the end
+     */
+    int find_next(const Tokenizer &tokenizer, const TextBlock *block, int pos);
+
+private:
+    //! NOTE: released blocks are never reported, drop all the records once there are too many
+    constexpr static int MAX_RECORDS = 256;
+
+    struct BlockRecord {
+        int        revision;
+        QList<int> boundaries;
+    };
+
+    QHash<const TextBlock *, BlockRecord> records_;
 };
 
 } // namespace jwrite
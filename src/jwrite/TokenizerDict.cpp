@@ -0,0 +1,321 @@
+#include <jwrite/TokenizerDict.h>
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDir>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <cstring>
+
+namespace jwrite {
+
+constexpr char MAGIC[8] = {'J', 'W', 'D', 'I', 'C', 'T', '\0', '\0'};
+
+//! NOTE: same as cppjieba::MIN_DOUBLE, used as the log probability of impossible events
+constexpr double MIN_LOG_PROB = -3.14e+100;
+
+using rune_string_t = std::u32string;
+
+static rune_string_t to_runes(const QByteArray &utf8) {
+    const auto ucs4 = QString::fromUtf8(utf8).toUcs4();
+    return rune_string_t(ucs4.begin(), ucs4.end());
+}
+
+//! NOTE: same semantics as limonp::Split, empty fields are kept except the trailing one
+static QList<QByteArray> split_columns(const QByteArray &line, char sep) {
+    auto columns = line.split(sep);
+    if (!columns.isEmpty() && columns.back().isEmpty()) { columns.removeLast(); }
+    return columns;
+}
+
+static bool read_lines(const QString &path, QList<QByteArray> &lines) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) { return false; }
+    lines.clear();
+    while (!file.atEnd()) {
+        auto line = file.readLine();
+        while (line.endsWith('\n') || line.endsWith('\r')) { line.chop(1); }
+        lines.append(std::move(line));
+    }
+    return true;
+}
+
+static qsizetype align_image(QByteArray &image) {
+    while (image.size() % alignof(double) != 0) { image.append('\0'); }
+    return image.size();
+}
+
+template <typename T>
+static uint64_t append_section(QByteArray &image, const std::vector<T> &items) {
+    const auto offset = align_image(image);
+    image.append(reinterpret_cast<const char *>(items.data()), items.size() * sizeof(T));
+    return offset;
+}
+
+template <typename T>
+static bool is_section_valid(uint64_t offset, uint32_t total, qint64 size) {
+    if (offset % alignof(T) != 0) { return false; }
+    return offset <= static_cast<uint64_t>(size)
+        && total <= (static_cast<uint64_t>(size) - offset) / sizeof(T);
+}
+
+std::unique_ptr<TokenizerDict>
+    TokenizerDict::open(const QString &source_dir, const QString &cache_path) {
+    const auto dict_path      = source_dir + "/jieba.dict.utf8";
+    const auto user_dict_path = source_dir + "/user.dict.utf8";
+    const auto hmm_path       = source_dir + "/hmm_model.utf8";
+    const auto digest         = get_source_digest({dict_path, user_dict_path, hmm_path});
+
+    const auto try_map = [&]() -> std::unique_ptr<TokenizerDict> {
+        auto file = std::make_unique<QFile>(cache_path);
+        if (!file->open(QIODevice::ReadOnly)) { return nullptr; }
+        const auto data = file->map(0, file->size());
+        if (!data) { return nullptr; }
+        auto dict = std::make_unique<TokenizerDict>();
+        if (!dict->attach(reinterpret_cast<const char *>(data), file->size())) { return nullptr; }
+        if (QByteArray::fromRawData(dict->header_->source_digest, 16) != digest) { return nullptr; }
+        dict->file_ = std::move(file);
+        return dict;
+    };
+
+    if (auto dict = try_map()) { return dict; }
+
+    auto image = compile(dict_path, user_dict_path, hmm_path, digest);
+    if (image.isEmpty()) {
+        spdlog::error("failed to compile tokenizer dictionary from {}", source_dir.toStdString());
+        return nullptr;
+    }
+
+    QDir().mkpath(QFileInfo(cache_path).absolutePath());
+    QSaveFile file(cache_path);
+    if (file.open(QIODevice::WriteOnly) && file.write(image) == image.size() && file.commit()) {
+        if (auto dict = try_map()) { return dict; }
+    }
+
+    spdlog::warn(
+        "failed to map tokenizer dictionary {}, fallback to in-memory image",
+        cache_path.toStdString());
+    auto dict    = std::make_unique<TokenizerDict>();
+    dict->image_ = std::move(image);
+    if (!dict->attach(dict->image_.constData(), dict->image_.size())) { return nullptr; }
+    return dict;
+}
+
+QByteArray TokenizerDict::compile(
+    const QString    &dict_path,
+    const QString    &user_dict_path,
+    const QString    &hmm_path,
+    const QByteArray &source_digest) {
+    Q_ASSERT(source_digest.size() == 16);
+
+    Header header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    memcpy(header.source_digest, source_digest.constData(), sizeof(header.source_digest));
+    header.version = VERSION;
+
+    //! NOTE: follows cppjieba::DictTrie, weights are log frequencies normalized by the sum of the
+    //! main dictionary, and words inserted later override the earlier ones
+    QList<QByteArray>                             lines{};
+    std::vector<std::pair<rune_string_t, double>> entries{};
+
+    if (!read_lines(dict_path, lines)) { return {}; }
+    double freq_sum = 0.0;
+    for (const auto &line : lines) {
+        if (line.isEmpty()) { continue; }
+        const auto columns = split_columns(line, ' ');
+        if (columns.size() != 3) { return {}; }
+        const double freq = columns[1].toDouble();
+        if (freq <= 0.0) { return {}; }
+        entries.emplace_back(to_runes(columns[0]), freq);
+        freq_sum += freq;
+    }
+    if (entries.empty()) { return {}; }
+
+    std::vector<double> weights{};
+    weights.reserve(entries.size());
+    for (auto &[_, weight] : entries) {
+        weight = std::log(weight / freq_sum);
+        weights.push_back(weight);
+    }
+    std::sort(weights.begin(), weights.end());
+    header.min_weight                = weights.front();
+    const double user_default_weight = weights[weights.size() / 2];
+
+    std::vector<uint32_t> single_words{};
+    if (!read_lines(user_dict_path, lines)) { lines.clear(); }
+    for (const auto &line : lines) {
+        if (line.isEmpty()) { continue; }
+        const auto columns = split_columns(line, ' ');
+        if (columns.isEmpty() || columns.size() > 3) { continue; }
+        const auto word   = to_runes(columns[0]);
+        const auto weight = columns.size() == 3 ? std::log(columns[1].toInt() / freq_sum)
+                                                : user_default_weight;
+        entries.emplace_back(word, weight);
+        if (word.size() == 1) { single_words.push_back(word[0]); }
+    }
+    std::sort(single_words.begin(), single_words.end());
+    single_words.erase(std::unique(single_words.begin(), single_words.end()), single_words.end());
+
+    std::map<rune_string_t, double> words{};
+    for (auto &[word, weight] : entries) {
+        if (!word.empty()) { words[std::move(word)] = weight; }
+    }
+    entries.clear();
+    std::vector<std::pair<rune_string_t, double>> keys(words.begin(), words.end());
+    words.clear();
+
+    //! NOTE: keys are sorted, so that the keys under a node form a contiguous range, build the trie
+    //! breadth-first to keep the edges of each node contiguous
+    struct Pending {
+        uint32_t node;
+        size_t   lo;
+        size_t   hi;
+        size_t   depth;
+    };
+
+    std::vector<Node>    nodes{};
+    std::vector<Edge>    edges{};
+    std::vector<Pending> queue{};
+    nodes.push_back(Node{});
+    queue.push_back(Pending{0, 0, keys.size(), 0});
+    for (size_t head = 0; head < queue.size(); ++head) {
+        auto [index, lo, hi, depth] = queue[head];
+        if (lo < hi && keys[lo].first.size() == depth) {
+            nodes[index].is_word = 1;
+            nodes[index].weight  = keys[lo].second;
+            ++lo;
+        }
+        nodes[index].first_edge = edges.size();
+        while (lo < hi) {
+            const auto rune = keys[lo].first[depth];
+            auto       end  = lo + 1;
+            while (end < hi && keys[end].first[depth] == rune) { ++end; }
+            const auto child = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(Node{});
+            edges.push_back(Edge{static_cast<uint32_t>(rune), child});
+            queue.push_back(Pending{child, lo, end, depth + 1});
+            lo = end;
+        }
+        nodes[index].total_edges = edges.size() - nodes[index].first_edge;
+    }
+
+    //! NOTE: follows cppjieba::HMMModel, comment lines start with '#', the lines in order are
+    //! start probs, transition probs of each state and then emit probs of each state
+    if (!read_lines(hmm_path, lines)) { return {}; }
+    for (auto &line : lines) { line = line.trimmed(); }
+    lines.removeIf([](const QByteArray &line) {
+        return line.isEmpty() || line.startsWith('#');
+    });
+    if (lines.size() < 1 + STATE_TOTAL * 2) { return {}; }
+
+    for (int i = 0; i < 1 + STATE_TOTAL; ++i) {
+        const auto columns = split_columns(lines[i], ' ');
+        if (columns.size() != STATE_TOTAL) { return {}; }
+        for (int j = 0; j < STATE_TOTAL; ++j) {
+            const double prob = columns[j].toDouble();
+            if (i == 0) {
+                header.start_prob[j] = prob;
+            } else {
+                header.trans_prob[i - 1][j] = prob;
+            }
+        }
+    }
+
+    std::map<uint32_t, Emit> emit_table{};
+    for (int state = 0; state < STATE_TOTAL; ++state) {
+        for (const auto &item : split_columns(lines[1 + STATE_TOTAL + state], ',')) {
+            const auto pair = split_columns(item, ':');
+            if (pair.size() != 2) { return {}; }
+            const auto rune = to_runes(pair[0]);
+            if (rune.size() != 1) { return {}; }
+            auto [it, inserted] = emit_table.try_emplace(rune[0]);
+            if (inserted) {
+                it->second.rune = rune[0];
+                std::fill(std::begin(it->second.prob), std::end(it->second.prob), MIN_LOG_PROB);
+            }
+            it->second.prob[state] = pair[1].toDouble();
+        }
+    }
+    std::vector<Emit> emits{};
+    emits.reserve(emit_table.size());
+    for (const auto &[_, emit] : emit_table) { emits.push_back(emit); }
+
+    header.total_nodes        = nodes.size();
+    header.total_edges        = edges.size();
+    header.total_single_words = single_words.size();
+    header.total_emits        = emits.size();
+
+    QByteArray image(sizeof(Header), '\0');
+    header.nodes_offset        = append_section(image, nodes);
+    header.edges_offset        = append_section(image, edges);
+    header.single_words_offset = append_section(image, single_words);
+    header.emits_offset        = append_section(image, emits);
+    memcpy(image.data(), &header, sizeof(Header));
+
+    return image;
+}
+
+QByteArray TokenizerDict::get_source_digest(const QStringList &paths) {
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(QByteArray::number(VERSION));
+    for (const auto &path : paths) {
+        const QFileInfo info(path);
+        hash.addData(info.absoluteFilePath().toUtf8());
+        hash.addData(QByteArray::number(info.exists() ? info.size() : -1));
+        hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    }
+    return hash.result();
+}
+
+int TokenizerDict::child_of(int node, uint32_t rune) const {
+    Q_ASSERT(node >= 0 && static_cast<uint32_t>(node) < header_->total_nodes);
+    const auto first = edges_ + nodes_[node].first_edge;
+    const auto last  = first + nodes_[node].total_edges;
+    const auto it    = std::lower_bound(first, last, rune, [](const Edge &edge, uint32_t rune) {
+        return edge.rune < rune;
+    });
+    return it != last && it->rune == rune ? static_cast<int>(it->node) : -1;
+}
+
+bool TokenizerDict::is_user_single_word(uint32_t rune) const {
+    const auto first = single_words_;
+    const auto last  = first + header_->total_single_words;
+    return std::binary_search(first, last, rune);
+}
+
+const TokenizerDict::Emit *TokenizerDict::find_emit(uint32_t rune) const {
+    const auto first = emits_;
+    const auto last  = first + header_->total_emits;
+    const auto it    = std::lower_bound(first, last, rune, [](const Emit &emit, uint32_t rune) {
+        return emit.rune < rune;
+    });
+    return it != last && it->rune == rune ? it : nullptr;
+}
+
+bool TokenizerDict::attach(const char *data, qint64 size) {
+    if (!data || size < static_cast<qint64>(sizeof(Header))) { return false; }
+    const auto header = reinterpret_cast<const Header *>(data);
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0) { return false; }
+    if (header->version != VERSION) { return false; }
+    if (header->total_nodes == 0) { return false; }
+    if (!is_section_valid<Node>(header->nodes_offset, header->total_nodes, size)) { return false; }
+    if (!is_section_valid<Edge>(header->edges_offset, header->total_edges, size)) { return false; }
+    if (!is_section_valid<uint32_t>(
+            header->single_words_offset, header->total_single_words, size)) {
+        return false;
+    }
+    if (!is_section_valid<Emit>(header->emits_offset, header->total_emits, size)) { return false; }
+
+    header_       = header;
+    nodes_        = reinterpret_cast<const Node *>(data + header->nodes_offset);
+    edges_        = reinterpret_cast<const Edge *>(data + header->edges_offset);
+    single_words_ = reinterpret_cast<const uint32_t *>(data + header->single_words_offset);
+    emits_        = reinterpret_cast<const Emit *>(data + header->emits_offset);
+    return true;
+}
+
+} // namespace jwrite
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <memory>
+#include <stdint.h>
+
+namespace jwrite {
+
+/*!
+ * \brief read-only view of a precompiled segmentation dictionary
+ *
+ * \note the binary image is made of position independent plain arrays, so it is memory-mapped and
+ * used in place without parsing; processes that map the same file share the pages
+ *
+ * \note layout: header | nodes | edges | user single words | emit table, the trie stores the
+ * children of each node as a contiguous run of edges sorted by rune
+ */
+class TokenizerDict {
+public:
+    constexpr static uint32_t VERSION = 1;
+
+    enum HmmState {
+        B           = 0,
+        E           = 1,
+        M           = 2,
+        S           = 3,
+        STATE_TOTAL = 4,
+    };
+
+    struct Header {
+        char     magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        //! md5 of the metadata of the source dictionaries
+        char     source_digest[16];
+        double   min_weight;
+        double   start_prob[STATE_TOTAL];
+        double   trans_prob[STATE_TOTAL][STATE_TOTAL];
+        uint32_t total_nodes;
+        uint32_t total_edges;
+        uint32_t total_single_words;
+        uint32_t total_emits;
+        uint64_t nodes_offset;
+        uint64_t edges_offset;
+        uint64_t single_words_offset;
+        uint64_t emits_offset;
+    };
+
+    struct Node {
+        uint32_t first_edge;
+        uint32_t total_edges;
+        uint32_t is_word;
+        uint32_t reserved;
+        double   weight;
+    };
+
+    struct Edge {
+        uint32_t rune;
+        uint32_t node;
+    };
+
+    struct Emit {
+        uint32_t rune;
+        uint32_t reserved;
+        double   prob[STATE_TOTAL];
+    };
+
+    TokenizerDict()                                 = default;
+    TokenizerDict(const TokenizerDict &)            = delete;
+    TokenizerDict &operator=(const TokenizerDict &) = delete;
+
+    /*!
+     * \brief open the compiled dictionary, recompile it from the text sources if it is missing or
+     * out of date
+     *
+     * \param [in] source_dir directory of jieba.dict.utf8, user.dict.utf8 and hmm_model.utf8
+     * \param [in] cache_path path of the compiled dictionary
+     *
+     * \return nullptr if the sources are unavailable
+     *
+     * \note falls back to an in-memory image if the compiled dictionary can not be written or
+     * mapped
+     */
+    static std::unique_ptr<TokenizerDict>
+        open(const QString &source_dir, const QString &cache_path);
+
+    /*!
+     * \brief compile the text dictionaries of cppjieba into the binary image
+     *
+     * \return compiled image, empty if any of the sources is unavailable or malformed
+     */
+    static QByteArray compile(
+        const QString    &dict_path,
+        const QString    &user_dict_path,
+        const QString    &hmm_path,
+        const QByteArray &source_digest);
+
+    static QByteArray get_source_digest(const QStringList &paths);
+
+    int root() const {
+        return 0;
+    }
+
+    //! \return index of the child node along the rune, -1 if absent
+    int child_of(int node, uint32_t rune) const;
+
+    bool is_word(int node) const {
+        return nodes_[node].is_word != 0;
+    }
+
+    double weight_of(int node) const {
+        return nodes_[node].weight;
+    }
+
+    double min_weight() const {
+        return header_->min_weight;
+    }
+
+    bool is_user_single_word(uint32_t rune) const;
+
+    double start_prob(int state) const {
+        return header_->start_prob[state];
+    }
+
+    double trans_prob(int from, int to) const {
+        return header_->trans_prob[from][to];
+    }
+
+    //! \return emit probabilities of the rune in all states, nullptr if the rune is unknown
+    const Emit *find_emit(uint32_t rune) const;
+
+protected:
+    bool attach(const char *data, qint64 size);
+
+private:
+    std::unique_ptr<QFile> file_;
+    QByteArray             image_;
+    const Header          *header_       = nullptr;
+    const Node            *nodes_        = nullptr;
+    const Edge            *edges_        = nullptr;
+    const uint32_t        *single_words_ = nullptr;
+    const Emit            *emits_        = nullptr;
+};
+
+} // namespace jwrite
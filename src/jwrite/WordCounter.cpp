@@ -1,20 +1,39 @@
 #include <jwrite/WordCounter.h>
 #include <QSet>
+#include <magic_enum.hpp>
+#include <array>
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JWRITE_WORD_COUNTER_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace jwrite {
 
 int LossenWordCounter::count_all(const QString& text) {
+    int state = 0;
+    return count_partial(text, state);
+}
+
+int LossenWordCounter::count_partial(QStringView text, int& state) {
     int count = text.length();
     for (const auto c : text) {
         if (c.isSpace()) { --count; }
     }
+    state = 0;
     return count;
 }
 
 int StrictWordCounter::count_all(const QString& text) {
+    int state = static_cast<int>(State::Unknown);
+    return count_partial(text, state) + count_pending(state);
+}
+
+int StrictWordCounter::count_partial(QStringView text, int& state_in_out) {
     int count = 0;
 
-    State next_state = State::Unknown;
+    State next_state = static_cast<State>(state_in_out);
     State state      = next_state;
 
     for (const auto ch : text) {
@@ -60,13 +79,16 @@ int StrictWordCounter::count_all(const QString& text) {
         state = next_state;
     }
 
-    if (state != State::Unknown && state != State::Blank && state != State::Punctuation) {
-        ++count;
-    }
+    state_in_out = static_cast<int>(state);
 
     return count;
 }
 
+int StrictWordCounter::count_pending(int state_in) {
+    const auto state = static_cast<State>(state_in);
+    return state != State::Unknown && state != State::Blank && state != State::Punctuation ? 1 : 0;
+}
+
 StrictWordCounter::State StrictWordCounter::predicate_char_state(QChar ch) {
     if (ch.isSpace()) { return State::Blank; }
     if (ch.isTitleCase() || ch.isUpper() || ch.isLower()) { return State::Word; }
@@ -77,4 +99,222 @@ StrictWordCounter::State StrictWordCounter::predicate_char_state(QChar ch) {
     return State::Unknown;
 }
 
+namespace {
+
+using State = StrictWordCounter::State;
+
+//! NOTE: low 3 bits of the table entry store the char state, the rest are the char flags
+constexpr uint8_t STATE_MASK  = 0x07;
+constexpr uint8_t PREFIX_FLAG = 0x08; //<! one of 'b', 'B', 'o', 'x', 'X'
+constexpr uint8_t DOT_FLAG    = 0x10; //<! '.'
+constexpr uint8_t HYPHEN_FLAG = 0x20; //<! '-'
+
+struct CharClassTable {
+    std::array<uint8_t, 0x10000> entries;
+    //! NOTE: inclusive bound of the cjk ideograph run that is entirely classified as character
+    char16_t                     cjk_lo;
+    char16_t                     cjk_hi;
+
+    CharClassTable() {
+        static_assert(magic_enum::enum_count<State>() <= STATE_MASK + 1);
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const QChar ch(static_cast<char16_t>(i));
+            uint8_t     entry = static_cast<uint8_t>(StrictWordCounter::predicate_char_state(ch));
+            if (ch == 'b' || ch == 'B' || ch == 'o' || ch == 'x' || ch == 'X') {
+                entry |= PREFIX_FLAG;
+            }
+            if (ch == '.') { entry |= DOT_FLAG; }
+            if (ch == '-') { entry |= HYPHEN_FLAG; }
+            entries[i] = entry;
+        }
+
+        //! NOTE: derive the run from the table itself so that the fast path never disagrees with
+        //! the scalar one, even if the unicode data of qt changes
+        cjk_lo = 0x4e00;
+        cjk_hi = 0x4e00;
+        if (state_of(cjk_lo) == State::Character) {
+            while (cjk_lo > 0 && state_of(cjk_lo - 1) == State::Character) { --cjk_lo; }
+            while (cjk_hi < 0xffff && state_of(cjk_hi + 1) == State::Character) { ++cjk_hi; }
+        } else {
+            cjk_lo = 1;
+            cjk_hi = 0;
+        }
+    }
+
+    State state_of(char16_t ch) const {
+        return static_cast<State>(entries[ch] & STATE_MASK);
+    }
+
+    static const CharClassTable &get() {
+        static const CharClassTable TABLE;
+        return TABLE;
+    }
+};
+
+#ifdef JWRITE_WORD_COUNTER_SSE2
+inline __m128i in_range_epu16(__m128i v, char16_t lo, char16_t hi) {
+    //! NOTE: sse2 has no unsigned 16-bit compare, flip the sign bit to compare as signed
+    const __m128i bias   = _mm_set1_epi16(static_cast<short>(0x8000));
+    const __m128i offset = _mm_xor_si128(_mm_sub_epi16(v, _mm_set1_epi16(lo)), bias);
+    const __m128i bound  = _mm_set1_epi16(static_cast<short>((hi - lo + 1) ^ 0x8000));
+    return _mm_cmplt_epi16(offset, bound);
+}
+#endif
+
+/*!
+ * \return length of the prefix of the text where every unit lies in [lo1, hi1] or [lo2, hi2]
+ */
+int scan_run(
+    const char16_t *text, int len, char16_t lo1, char16_t hi1, char16_t lo2, char16_t hi2) {
+    int i = 0;
+#ifdef JWRITE_WORD_COUNTER_SSE2
+    for (; i + 8 <= len; i += 8) {
+        const __m128i v    = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i));
+        const __m128i hit  = _mm_or_si128(in_range_epu16(v, lo1, hi1), in_range_epu16(v, lo2, hi2));
+        const int     mask = _mm_movemask_epi8(hit);
+        if (mask != 0xffff) {
+            int miss = 0;
+            while (mask & (0b11 << (miss * 2))) { ++miss; }
+            return i + miss;
+        }
+    }
+#endif
+    for (; i < len; ++i) {
+        const char16_t ch = text[i];
+        if (!(ch >= lo1 && ch <= hi1) && !(ch >= lo2 && ch <= hi2)) { break; }
+    }
+    return i;
+}
+
+} // namespace
+
+int FastStrictWordCounter::count_all(const QString &text) {
+    int state = static_cast<int>(State::Unknown);
+    return count_partial(text, state) + count_pending(state);
+}
+
+int FastStrictWordCounter::count_partial(QStringView text, int &state_in_out) {
+    const auto &table = CharClassTable::get();
+    const auto  data  = text.utf16();
+    const int   len   = text.length();
+
+    int   count = 0;
+    State state = static_cast<State>(state_in_out);
+
+    int i = 0;
+    while (i < len) {
+        //! fast path: skip the runs that keep the current state
+        switch (state) {
+            case State::Character: {
+                //! NOTE: every ideograph after a character closes exactly one word
+                const int run  = scan_run(data + i, len - i, table.cjk_lo, table.cjk_hi, 1, 0);
+                count         += run;
+                i             += run;
+            } break;
+            case State::Word: {
+                i += scan_run(data + i, len - i, u'a', u'z', u'A', u'Z');
+            } break;
+            case State::Blank: {
+                i += scan_run(data + i, len - i, u' ', u' ', u' ', u' ');
+            } break;
+            default: {
+            } break;
+        }
+        if (i == len) { break; }
+
+        //! slow path: run the state machine on a single unit
+        const uint8_t entry      = table.entries[data[i++]];
+        State         next_state = static_cast<State>(entry & STATE_MASK);
+        switch (state) {
+            case State::Unknown:
+                [[fallthrough]];
+            case State::Blank:
+                [[fallthrough]];
+            case State::Punctuation: {
+            } break;
+            case State::Zero: {
+                if ((entry & PREFIX_FLAG) || next_state == State::Zero) {
+                    next_state = State::NumberPrefix;
+                } else if ((entry & DOT_FLAG) || next_state == State::Number) {
+                    next_state = State::Number;
+                } else {
+                    ++count;
+                }
+            } break;
+            case State::NumberPrefix: {
+                if (next_state == State::Zero) { next_state = State::Number; }
+            } break;
+            case State::Number: {
+                if (next_state == State::Number || next_state == State::Zero
+                    || (entry & DOT_FLAG)) {
+                    next_state = State::Number;
+                } else {
+                    ++count;
+                }
+            } break;
+            case State::Character: {
+                ++count;
+            } break;
+            case State::Word: {
+                if (next_state == State::Word || (entry & HYPHEN_FLAG)) {
+                    next_state = State::Word;
+                } else {
+                    ++count;
+                }
+            } break;
+        }
+        state = next_state;
+    }
+
+    state_in_out = static_cast<int>(state);
+
+    return count;
+}
+
+void BlockWordCounter::reset() {
+    records_.clear();
+    generation_ = 0;
+}
+
+int BlockWordCounter::count(AbstractWordCounter* counter, const QVector<TextBlock*>& blocks) {
+    Q_ASSERT(counter);
+
+    ++generation_;
+
+    //! NOTE: blocks are joined with a line break in the stored text, keep the same semantics
+    constexpr QChar BLOCK_SEP('\n');
+
+    int total = 0;
+    int state = 0;
+    for (int index = 0; index < blocks.size(); ++index) {
+        const auto block = blocks[index];
+        if (index > 0) { total += counter->count_partial(QStringView(&BLOCK_SEP, 1), state); }
+        auto& rec = records_[block];
+        if (rec.generation == 0 || rec.revision != block->revision || rec.state_in != state) {
+            rec.revision  = block->revision;
+            rec.state_in  = state;
+            rec.count     = counter->count_partial(block->text(), state);
+            rec.state_out = state;
+        } else {
+            state = rec.state_out;
+        }
+        rec.generation  = generation_;
+        total          += rec.count;
+    }
+    total += counter->count_pending(state);
+
+    //! NOTE: drop records of released blocks once they outnumber the alive ones
+    if (records_.size() > blocks.size() * 2) {
+        for (auto it = records_.begin(); it != records_.end();) {
+            if (it->generation != generation_) {
+                it = records_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    return total;
+}
+
 } // namespace jwrite
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <jwrite/TextViewEngine.h>
 #include <QString>
+#include <QStringView>
+#include <QHash>
 
 namespace jwrite {
 
@@ -8,16 +11,52 @@ class AbstractWordCounter {
 public:
     virtual ~AbstractWordCounter() = default;
 
+    /*!
+     * \return identifier of the counting rule, counts from counters with the same name are
+     * interchangeable, empty name means the counts should never be persisted
+     */
+    virtual QString name() const {
+        return "";
+    }
+
     virtual int count_all(const QString& text) = 0;
 
     virtual int count_and_cache(int key, const QString& text) {
         return count_all(text);
     }
+
+    /*!
+     * \brief count the words completed within the text piece and resume from the given state
+     *
+     * \param [in] text piece of text that continues the text fed previously
+     * \param [inout] state opaque state of the counter, 0 refers to the initial state
+     *
+     * \return number of words completed within the piece
+     *
+     * \note the default implementation treats each piece as standalone text, counters that can
+     * carry their state across pieces should override both this and count_pending
+     */
+    virtual int count_partial(QStringView text, int& state) {
+        state = 0;
+        return count_all(text.toString());
+    }
+
+    /*!
+     * \return number of words still pending in the given state when the text ends
+     */
+    virtual int count_pending(int state) {
+        return 0;
+    }
 };
 
 class LossenWordCounter : public AbstractWordCounter {
 public:
+    QString name() const override {
+        return "lossen";
+    }
+
     int count_all(const QString& text) override;
+    int count_partial(QStringView text, int& state) override;
 };
 
 class StrictWordCounter : public AbstractWordCounter {
@@ -34,9 +73,52 @@ public:
     };
 
 public:
+    QString name() const override {
+        return "strict";
+    }
+
     int count_all(const QString& text) override;
+    int count_partial(QStringView text, int& state) override;
+    int count_pending(int state) override;
 
     static State predicate_char_state(QChar ch);
 };
 
+/*!
+ * \brief drop-in replacement of StrictWordCounter with exactly the same results
+ *
+ * \note characters are classified through a precomputed table covering all the UTF-16 code
+ * units, and runs of CJK ideographs, ascii letters and spaces that cannot change the counter
+ * state are skipped in a vectorized pass
+ */
+class FastStrictWordCounter : public StrictWordCounter {
+public:
+    int count_all(const QString& text) override;
+    int count_partial(QStringView text, int& state) override;
+};
+
+/*!
+ * \brief word counter over the text blocks of a TextViewEngine which caches the count per block
+ *
+ * \note only the blocks whose content or incoming counter state changed are recounted, the
+ * result is exactly the same as counting the text of all blocks joined by line breaks at once
+ */
+class BlockWordCounter {
+public:
+    void reset();
+    int  count(AbstractWordCounter* counter, const QVector<TextBlock*>& blocks);
+
+private:
+    struct BlockRecord {
+        int revision;
+        int state_in;
+        int state_out;
+        int count;
+        int generation;
+    };
+
+    QHash<const TextBlock*, BlockRecord> records_;
+    int                                  generation_ = 0;
+};
+
 } // namespace jwrite
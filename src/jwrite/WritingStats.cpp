@@ -0,0 +1,279 @@
+#include <jwrite/WritingStats.h>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QFile>
+#include <QMap>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+
+namespace jwrite {
+
+struct WritingStatsHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t record_size;
+};
+
+constexpr char     STATS_MAGIC[8] = {'J', 'W', 'S', 'T', 'A', 'T', 'S', '\0'};
+constexpr uint32_t STATS_VERSION  = 1;
+
+static WritingStatsHeader make_header() {
+    WritingStatsHeader header{};
+    memcpy(header.magic, STATS_MAGIC, sizeof(STATS_MAGIC));
+    header.version     = STATS_VERSION;
+    header.record_size = sizeof(WritingRecord);
+    return header;
+}
+
+WritingStats::~WritingStats() {
+    close();
+}
+
+bool WritingStats::open(const QString &path) {
+    close();
+
+    path_          = path;
+    flushed_       = 0;
+    last_activity_ = 0;
+    session_       = -1;
+
+    bool  need_rewrite = false;
+    QFile file(path);
+    if (file.exists()) {
+        if (!file.open(QIODevice::ReadOnly)) {
+            spdlog::error("failed to open writing stats {}", path.toStdString());
+            path_.clear();
+            return false;
+        }
+        const auto         data   = file.readAll();
+        const auto         header = make_header();
+        WritingStatsHeader file_header{};
+        if (data.size() >= static_cast<qsizetype>(sizeof(file_header))) {
+            memcpy(&file_header, data.constData(), sizeof(file_header));
+        }
+        if (memcmp(&file_header, &header, sizeof(header)) != 0) {
+            spdlog::warn("discard malformed writing stats {}", path.toStdString());
+            need_rewrite = true;
+        } else {
+            const auto payload = data.size() - static_cast<qsizetype>(sizeof(header));
+            //! NOTE: a partial record is left by an interrupted append, drop it
+            need_rewrite       = payload % sizeof(WritingRecord) != 0;
+            records_.resize(payload / sizeof(WritingRecord));
+            memcpy(
+                records_.data(),
+                data.constData() + sizeof(header),
+                records_.size() * sizeof(WritingRecord));
+        }
+    }
+
+    if (!records_.isEmpty()) {
+        session_       = records_.back().session;
+        last_activity_ = records_.back().start + records_.back().span;
+    }
+
+    const auto before = QDateTime::currentSecsSinceEpoch() - DOWNSAMPLE_AFTER_DAYS * 24 * 3600;
+    for (const auto &rec : records_) {
+        if (rec.start >= before) { break; }
+        if (rec.span == SAMPLE_SPAN) {
+            records_     = downsample(records_, before);
+            need_rewrite = true;
+            break;
+        }
+    }
+
+    if (need_rewrite && !rewrite()) { return false; }
+    flushed_ = records_.size();
+
+    return true;
+}
+
+void WritingStats::close() {
+    if (!is_open()) { return; }
+    if (tail_) {
+        records_.append(*tail_);
+        tail_.reset();
+    }
+    flush();
+    path_.clear();
+    records_.clear();
+    flushed_ = 0;
+}
+
+void WritingStats::record(int delta, int64_t now) {
+    if (delta == 0 || !is_open()) { return; }
+
+    if (session_ == -1 || now - last_activity_ >= SESSION_GAP) { ++session_; }
+
+    //! NOTE: never go backwards even if the clock does, so that the records stay sorted
+    int64_t start = now - now % SAMPLE_SPAN;
+    if (tail_) {
+        start = qMax(start, tail_->start);
+        if (tail_->start != start || tail_->session != session_) {
+            records_.append(*tail_);
+            tail_.reset();
+            flush();
+        }
+    } else if (!records_.isEmpty()) {
+        start = qMax(start, records_.back().start);
+    }
+
+    if (!tail_) {
+        tail_ = WritingRecord{
+            .start   = start,
+            .span    = SAMPLE_SPAN,
+            .session = session_,
+            .added   = 0,
+            .removed = 0,
+        };
+    }
+
+    if (delta > 0) {
+        tail_->added += delta;
+    } else {
+        tail_->removed -= delta;
+    }
+    last_activity_ = now;
+}
+
+void WritingStats::record(int delta) {
+    record(delta, QDateTime::currentSecsSinceEpoch());
+}
+
+bool WritingStats::flush() {
+    if (!is_open()) { return false; }
+    if (flushed_ == records_.size()) { return true; }
+
+    QFile      file(path_);
+    const bool fresh = !file.exists() || file.size() == 0;
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        spdlog::error("failed to write writing stats {}", path_.toStdString());
+        return false;
+    }
+    if (fresh) {
+        const auto header = make_header();
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+    const auto bytes = (records_.size() - flushed_) * sizeof(WritingRecord);
+    if (file.write(reinterpret_cast<const char *>(records_.constData() + flushed_), bytes)
+        != static_cast<qint64>(bytes)) {
+        spdlog::error("failed to write writing stats {}", path_.toStdString());
+        return false;
+    }
+    flushed_ = records_.size();
+    return true;
+}
+
+template <typename Fn>
+void WritingStats::for_each_record(int64_t from, int64_t to, Fn &&fn) const {
+    auto it = std::lower_bound(
+        records_.cbegin(), records_.cend(), from, [](const WritingRecord &rec, int64_t time) {
+            return rec.start < time;
+        });
+    for (; it != records_.cend() && it->start < to; ++it) { fn(*it); }
+    if (tail_ && tail_->start >= from && tail_->start < to) { fn(*tail_); }
+}
+
+QList<WritingBucket>
+    WritingStats::query(Granularity granularity, int64_t from, int64_t to) const {
+    QList<WritingBucket> buckets{};
+    int64_t              bucket_end = 0;
+    for_each_record(from, to, [&](const WritingRecord &rec) {
+        if (buckets.isEmpty() || rec.start >= bucket_end) {
+            int64_t bucket_start = 0;
+            switch (granularity) {
+                case Granularity::Hour: {
+                    bucket_start = rec.start - rec.start % DOWNSAMPLED_SPAN;
+                    bucket_end   = bucket_start + DOWNSAMPLED_SPAN;
+                } break;
+                case Granularity::Day: {
+                    const auto date = QDateTime::fromSecsSinceEpoch(rec.start).date();
+                    bucket_start    = date.startOfDay().toSecsSinceEpoch();
+                    bucket_end      = date.addDays(1).startOfDay().toSecsSinceEpoch();
+                } break;
+            }
+            buckets.append(WritingBucket{.start = bucket_start, .added = 0, .removed = 0});
+        }
+        buckets.back().added   += rec.added;
+        buckets.back().removed += rec.removed;
+    });
+    return buckets;
+}
+
+QList<WritingSession> WritingStats::sessions(int64_t from, int64_t to) const {
+    QMap<int, WritingSession> sessions{};
+    for_each_record(from, to, [&](const WritingRecord &rec) {
+        auto it = sessions.find(rec.session);
+        if (it == sessions.end()) {
+            it = sessions.insert(
+                rec.session,
+                WritingSession{
+                    .id      = rec.session,
+                    .start   = rec.start,
+                    .end     = rec.start + rec.span,
+                    .added   = 0,
+                    .removed = 0,
+                });
+        }
+        it->start    = qMin(it->start, rec.start);
+        it->end      = qMax(it->end, rec.start + rec.span);
+        it->added   += rec.added;
+        it->removed += rec.removed;
+    });
+    return sessions.values();
+}
+
+int WritingStats::current_session() const {
+    return session_;
+}
+
+QList<WritingRecord>
+    WritingStats::downsample(const QList<WritingRecord> &records, int64_t before) {
+    QMap<std::pair<int64_t, int>, WritingRecord> merged{};
+
+    qsizetype index = 0;
+    for (; index < records.size() && records[index].start < before; ++index) {
+        const auto &rec   = records[index];
+        const auto  start = rec.start - rec.start % DOWNSAMPLED_SPAN;
+        auto        it    = merged.find({start, rec.session});
+        if (it == merged.end()) {
+            it = merged.insert(
+                {start, rec.session},
+                WritingRecord{
+                    .start   = start,
+                    .span    = DOWNSAMPLED_SPAN,
+                    .session = rec.session,
+                    .added   = 0,
+                    .removed = 0,
+                });
+        }
+        it->added   += rec.added;
+        it->removed += rec.removed;
+    }
+
+    QList<WritingRecord> result{};
+    result.reserve(merged.size() + records.size() - index);
+    for (const auto &rec : merged) { result.append(rec); }
+    result.append(records.mid(index));
+    return result;
+}
+
+bool WritingStats::rewrite() {
+    QSaveFile file(path_);
+    if (!file.open(QIODevice::WriteOnly)) {
+        spdlog::error("failed to rewrite writing stats {}", path_.toStdString());
+        return false;
+    }
+    const auto header = make_header();
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(
+        reinterpret_cast<const char *>(records_.constData()),
+        records_.size() * sizeof(WritingRecord));
+    if (!file.commit()) {
+        spdlog::error("failed to rewrite writing stats {}", path_.toStdString());
+        return false;
+    }
+    return true;
+}
+
+} // namespace jwrite
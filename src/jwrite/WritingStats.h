@@ -0,0 +1,136 @@
+#pragma once
+
+#include <QString>
+#include <QList>
+#include <optional>
+#include <stdint.h>
+
+namespace jwrite {
+
+/*!
+ * \brief fixed-size record of the writing activity in a time span
+ *
+ * \note records of the same session in the same span are merged, so that the totals per session
+ * remain exact after the records are downsampled
+ */
+struct WritingRecord {
+    //! start of the span in seconds since epoch, aligned to the span
+    int64_t start;
+    //! length of the span in seconds
+    int32_t span;
+    int32_t session;
+    //! words added and removed in the span, both non-negative
+    int32_t added;
+    int32_t removed;
+};
+
+static_assert(sizeof(WritingRecord) == 24);
+
+struct WritingBucket {
+    int64_t start;
+    int     added;
+    int     removed;
+
+    int net() const {
+        return added - removed;
+    }
+};
+
+struct WritingSession {
+    int     id;
+    int64_t start;
+    int64_t end;
+    int     added;
+    int     removed;
+
+    int net() const {
+        return added - removed;
+    }
+};
+
+/*!
+ * \brief append-only time series of the word deltas of a book
+ *
+ * \note edits are accumulated into a per-minute record in memory, a record is appended to the file
+ * once its minute or session is over, so recording an edit costs a few integer ops
+ *
+ * \note minute records older than DOWNSAMPLE_AFTER_DAYS are merged into hourly records when the
+ * series is opened, the file is only rewritten then
+ */
+class WritingStats {
+public:
+    constexpr static int SAMPLE_SPAN           = 60;
+    constexpr static int DOWNSAMPLED_SPAN      = 3600;
+    constexpr static int SESSION_GAP           = 30 * 60;
+    constexpr static int DOWNSAMPLE_AFTER_DAYS = 7;
+
+    enum class Granularity {
+        Hour,
+        Day,
+    };
+
+    WritingStats() = default;
+    ~WritingStats();
+
+    WritingStats(const WritingStats &)            = delete;
+    WritingStats &operator=(const WritingStats &) = delete;
+
+    bool open(const QString &path);
+    void close();
+
+    bool is_open() const {
+        return !path_.isEmpty();
+    }
+
+    /*!
+     * \param [in] delta change of the word count caused by an edit
+     * \param [in] now time of the edit in seconds since epoch
+     */
+    void record(int delta, int64_t now);
+    void record(int delta);
+
+    /*!
+     * \brief append the finished records to the file
+     */
+    bool flush();
+
+    /*!
+     * \return non-empty buckets in [from, to), days are split in local time
+     *
+     * \note hourly buckets are aligned in utc
+     */
+    QList<WritingBucket> query(Granularity granularity, int64_t from, int64_t to) const;
+
+    /*!
+     * \return sessions that have activities in [from, to)
+     */
+    QList<WritingSession> sessions(int64_t from, int64_t to) const;
+
+    /*!
+     * \return id of the latest session, -1 if there is none
+     */
+    int current_session() const;
+
+    /*!
+     * \brief merge the minute records before the time into hourly records of each session
+     *
+     * \param [in] records records sorted by start
+     */
+    static QList<WritingRecord> downsample(const QList<WritingRecord> &records, int64_t before);
+
+protected:
+    bool rewrite();
+
+    template <typename Fn>
+    void for_each_record(int64_t from, int64_t to, Fn &&fn) const;
+
+private:
+    QString                      path_;
+    QList<WritingRecord>         records_;
+    std::optional<WritingRecord> tail_;
+    qsizetype                    flushed_       = 0;
+    int64_t                      last_activity_ = 0;
+    int                          session_       = -1;
+};
+
+} // namespace jwrite
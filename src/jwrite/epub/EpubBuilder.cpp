@@ -1,7 +1,7 @@
 #include "EpubBuilder.h"
 #include <minizip/zip.h>
-#include <QDir>
-#include <QStack>
+#include <QFile>
+#include <utility>
 
 namespace jwrite::epub {
 
@@ -19,7 +19,8 @@ static const char *CONTAINER = R"(<?xml version="1.0" encoding="UTF-8"?>
   </rootfiles>
 </container>)";
 
-static const char *CONTENT_TEMPLATE = R"(<?xml version="1.0" encoding="UTF-8"?>
+//! NOTE: split around the body, so that the chapters of a volume are streamed one by one
+static const char *CONTENT_HEAD_TEMPLATE = R"(<?xml version="1.0" encoding="UTF-8"?>
 <!DOCTYPE html>
 <html xmlns="http://www.w3.org/1999/xhtml" xmlns:epub="http://www.idpf.org/2007/ops" xml:lang="zh-CN">
 <head>
@@ -31,7 +32,9 @@ static const char *CONTENT_TEMPLATE = R"(<?xml version="1.0" encoding="UTF-8"?>
 </head>
 <body epub:type="bodymatter">
     <section id="%1" class="level1">
-        <h1>%1</h1>%2
+        <h1>%1</h1>)";
+
+static const char *CONTENT_TAIL = R"(
     </section>
 </body>
 </html>)";
@@ -163,135 +166,132 @@ static const char *TOC_NCX_SUB_ITEM_TEMPLATE = R"(
 EpubBuilder::EpubBuilder(const QString &filename)
     : filename_(filename)
     , book_title_("未命名书籍")
-    , author_("佚名") {
-    Q_ASSERT(build_dir_.isValid());
+    , author_("佚名")
+    , zip_{nullptr}
+    , failed_{false} {}
+
+EpubBuilder::~EpubBuilder() {
+    //! NOTE: an unfinished build still leaves a valid archive behind
+    if (zip_) { zipClose(zip_, nullptr); }
 }
 
-void EpubBuilder::build() {
-    write_meta_inf();
+bool EpubBuilder::build() {
+    if (!open()) { return false; }
+
     write_content_opf();
     write_stylesheet();
     write_toc_ncx();
     write_nav_html();
     write_title_page();
 
-    auto zip = zipOpen(filename_.toLocal8Bit().data(), false);
-
-    const QDir root(build_dir_.path());
-
-    QStack<QDir> stack;
-    stack.push(root);
-
-    while (!stack.empty()) {
-        auto dir = stack.pop();
-        for (auto entry : dir.entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot)) {
-            if (entry.isDir()) {
-                stack.push(entry.filePath());
-                continue;
-            }
-
-            if (!entry.isFile()) { continue; }
-
-            QFile file(entry.filePath());
-            if (!file.open(QIODevice::ReadOnly)) { continue; }
-
-            zip_fileinfo zipfi{};
-            zipOpenNewFileInZip(
-                zip,
-                root.relativeFilePath(entry.filePath()).toStdString().c_str(),
-                &zipfi,
-                nullptr,
-                0,
-                nullptr,
-                0,
-                nullptr,
-                Z_DEFLATED,
-                Z_DEFAULT_COMPRESSION);
-
-            const auto content = file.readAll();
-            zipWriteInFileInZip(zip, content.data(), content.size());
-        }
-    }
-
-    zipCloseFileInZip(zip);
-    zipClose(zip, nullptr);
+    const bool succeed = zipClose(std::exchange(zip_, nullptr), nullptr) == ZIP_OK;
+    return succeed && !failed_;
 }
 
 EpubBuilder &EpubBuilder::feed(FeedCallback request) {
-    QDir dir(build_dir_.path());
-
-    if (!dir.exists("EPUB")) { dir.mkdir("EPUB"); }
-    dir.cd("EPUB");
-    if (!dir.exists("text")) { dir.mkdir("text"); }
-    dir.cd("text");
+    if (!open()) { return *this; }
 
     for (int vol_index = 0; vol_index < toc_marker_.size(); ++vol_index) {
         QStringList chap_titles;
-        QString     content;
 
+        begin_entry(QString("EPUB/text/ch%1.xhtml").arg(vol_index + 1));
+        write_data(QString(CONTENT_HEAD_TEMPLATE).arg(vol_toc_[vol_index]).toUtf8());
+
+        //! NOTE: only one chapter is held in memory at a time
         for (int chap_index = 0; chap_index < toc_marker_[vol_index]; ++chap_index) {
             QString title{};
             QString chapter{};
             request(vol_index, chap_index, title, chapter);
             chap_titles << title;
-            content += QString("\n        <section id=\"%1\" class=\"level2\">\n            "
-                               "<h2>%1</h2>\n        <p></p>")
-                           .arg(title);
+
+            QString content = QString("\n        <section id=\"%1\" class=\"level2\">\n            "
+                                      "<h2>%1</h2>\n        <p></p>")
+                                  .arg(title);
             for (const auto &para : chapter.split('\n')) {
                 content += QString("\n            <p>%1</p>").arg(para);
             }
             content += "</section>\n";
+            write_data(content.toUtf8());
         }
 
-        chap_toc_ << chap_titles;
-        content = QString(CONTENT_TEMPLATE).arg(vol_toc_[vol_index]).arg(content);
-
-        QFile file(dir.filePath(QString("ch%1.xhtml").arg(vol_index + 1)));
-        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) { continue; }
+        write_data(CONTENT_TAIL);
+        end_entry();
 
-        file.write(content.toUtf8());
+        chap_toc_ << chap_titles;
     }
 
     return *this;
 }
 
-void EpubBuilder::write_title_page() {
-    QDir dir(build_dir_.path());
+bool EpubBuilder::open() {
+    if (zip_) { return true; }
+    if (failed_) { return false; }
 
-    if (!dir.exists("EPUB")) { dir.mkdir("EPUB"); }
-    dir.cd("EPUB");
-    if (!dir.exists("text")) { dir.mkdir("text"); }
-    dir.cd("text");
+    zip_ = zipOpen(filename_.toLocal8Bit().data(), APPEND_STATUS_CREATE);
+    if (!zip_) {
+        failed_ = true;
+        return false;
+    }
 
-    QFile file(dir.filePath("title_page.xhtml"));
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) { return; }
+    //! NOTE: epub requires the mimetype to be the first entry and stored uncompressed
+    write_entry("mimetype", "application/epub+zip", false);
+    write_meta_inf();
 
-    file.write(QString(TITLE_PAGE_TEMPLATE).arg(book_title_).arg(author_).toUtf8());
+    return !failed_;
 }
 
-void EpubBuilder::write_stylesheet() {
-    QDir dir(build_dir_.path());
+bool EpubBuilder::begin_entry(const QString &path, bool compress) {
+    Q_ASSERT(zip_);
+    zip_fileinfo zipfi{};
+    const int    ret = zipOpenNewFileInZip(
+        zip_,
+        path.toUtf8().constData(),
+        &zipfi,
+        nullptr,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        compress ? Z_DEFLATED : 0,
+        compress ? Z_DEFAULT_COMPRESSION : Z_NO_COMPRESSION);
+    if (ret != ZIP_OK) { failed_ = true; }
+    return ret == ZIP_OK;
+}
 
-    if (!dir.exists("EPUB")) { dir.mkdir("EPUB"); }
-    dir.cd("EPUB");
-    if (!dir.exists("styles")) { dir.mkdir("styles"); }
-    dir.cd("styles");
+bool EpubBuilder::write_data(const QByteArray &data) {
+    Q_ASSERT(zip_);
+    const int ret = zipWriteInFileInZip(zip_, data.constData(), data.size());
+    if (ret != ZIP_OK) { failed_ = true; }
+    return ret == ZIP_OK;
+}
 
-    QFile stylesheet(":/res/template/epub/style.css");
-    if (!stylesheet.open(QIODevice::ReadOnly | QIODevice::Text)) { return; }
+bool EpubBuilder::end_entry() {
+    Q_ASSERT(zip_);
+    const int ret = zipCloseFileInZip(zip_);
+    if (ret != ZIP_OK) { failed_ = true; }
+    return ret == ZIP_OK;
+}
 
-    QFile file(dir.filePath("stylesheet1.css"));
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) { return; }
+bool EpubBuilder::write_entry(const QString &path, const QByteArray &data, bool compress) {
+    if (!begin_entry(path, compress)) { return false; }
+    const bool succeed = write_data(data);
+    return end_entry() && succeed;
+}
 
-    file.write(stylesheet.readAll());
+void EpubBuilder::write_title_page() {
+    write_entry(
+        "EPUB/text/title_page.xhtml",
+        QString(TITLE_PAGE_TEMPLATE).arg(book_title_).arg(author_).toUtf8());
 }
 
-void EpubBuilder::write_toc_ncx() {
-    QDir dir(build_dir_.path());
+void EpubBuilder::write_stylesheet() {
+    QFile stylesheet(":/res/template/epub/style.css");
+    if (!stylesheet.open(QIODevice::ReadOnly | QIODevice::Text)) { return; }
 
-    if (!dir.exists("EPUB")) { dir.mkdir("EPUB"); }
-    dir.cd("EPUB");
+    write_entry("EPUB/styles/stylesheet1.css", stylesheet.readAll());
+}
 
+void EpubBuilder::write_toc_ncx() {
     QString toc_items;
     int     nav_point = 0;
     for (int i = 0; i < toc_marker_.size(); ++i) {
@@ -312,18 +312,10 @@ void EpubBuilder::write_toc_ncx() {
 
     const auto content = QString(TOC_NCX_TEMPLATE).arg(book_title_).arg(toc_items);
 
-    QFile file(dir.filePath("toc.ncx"));
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) { return; }
-
-    file.write(content.toUtf8());
+    write_entry("EPUB/toc.ncx", content.toUtf8());
 }
 
 void EpubBuilder::write_nav_html() {
-    QDir dir(build_dir_.path());
-
-    if (!dir.exists("EPUB")) { dir.mkdir("EPUB"); }
-    dir.cd("EPUB");
-
     QString nav_items;
     int     index = 0;
     for (int i = 0; i < toc_marker_.size(); ++i) {
@@ -344,18 +336,10 @@ void EpubBuilder::write_nav_html() {
 
     const auto content = QString(NAV_TEMPLATE).arg(book_title_).arg(nav_items);
 
-    QFile file(dir.filePath("nav.xhtml"));
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) { return; }
-
-    file.write(content.toUtf8());
+    write_entry("EPUB/nav.xhtml", content.toUtf8());
 }
 
 void EpubBuilder::write_content_opf() {
-    QDir dir(build_dir_.path());
-
-    if (!dir.exists("EPUB")) { dir.mkdir("EPUB"); }
-    dir.cd("EPUB");
-
     QString toc_ref;
     QString toc;
 
@@ -371,32 +355,12 @@ void EpubBuilder::write_content_opf() {
     const auto content =
         QString(CONTENT_OPF_TEMPLATE).arg(book_title_).arg(author_).arg(toc_ref).arg(toc);
 
-    QFile file(dir.filePath("content.opf"));
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) { return; }
-
-    file.write(content.toUtf8());
+    write_entry("EPUB/content.opf", content.toUtf8());
 }
 
 void EpubBuilder::write_meta_inf() {
-    QDir dir(build_dir_.path());
-
-    if (!dir.exists("META-INF")) { dir.mkdir("META-INF"); }
-
-    if (QFile file(dir.filePath("mimetype")); file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        file.write("application/epub+zip");
-    }
-
-    dir.cd("META-INF");
-
-    if (QFile file(dir.filePath("com.apple.ibooks.display-options.xml"));
-        file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        file.write(DISPLAY_OPTIONS);
-    }
-
-    if (QFile file(dir.filePath("container.xml"));
-        file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        file.write(CONTAINER);
-    }
+    write_entry("META-INF/com.apple.ibooks.display-options.xml", DISPLAY_OPTIONS);
+    write_entry("META-INF/container.xml", CONTAINER);
 }
 
 } // namespace jwrite::epub
@@ -2,19 +2,33 @@
 
 #include <QString>
 #include <QList>
-#include <QTemporaryDir>
+#include <QByteArray>
 #include <functional>
 
 namespace jwrite::epub {
 
+/*!
+ * \brief builder of the epub archive, every entry is generated in memory and written straight
+ * into the archive
+ *
+ * \note the archive is created on the first feed or build, chapters are streamed into the entry
+ * of their volume one by one, and the toc is written at last once all the titles are known
+ */
 class EpubBuilder {
 public:
     //! proto: void(int vol_index, int chap_index, QString &out_chap_title, QString &out_content)
     using FeedCallback = std::function<void(int, int, QString &, QString &)>;
 
     EpubBuilder(const QString &filename);
+    ~EpubBuilder();
 
-    void         build();
+    EpubBuilder(const EpubBuilder &)            = delete;
+    EpubBuilder &operator=(const EpubBuilder &) = delete;
+
+    /*!
+     * \return false if any entry failed to be written
+     */
+    bool         build();
     EpubBuilder &feed(FeedCallback request);
 
     EpubBuilder &with_name(const QString &book_title) {
@@ -34,6 +48,12 @@ public:
     }
 
 protected:
+    bool open();
+    bool begin_entry(const QString &path, bool compress = true);
+    bool write_data(const QByteArray &data);
+    bool end_entry();
+    bool write_entry(const QString &path, const QByteArray &data, bool compress = true);
+
     void write_meta_inf();
     void write_content_opf();
     void write_stylesheet();
@@ -45,7 +65,9 @@ private:
     QString            filename_;
     QString            book_title_;
     QString            author_;
-    QTemporaryDir      build_dir_;
+    //! NOTE: zipFile of minizip, kept opaque to not leak the header
+    void              *zip_;
+    bool               failed_;
     QStringList        vol_toc_;
     QList<QStringList> chap_toc_;
     QList<int>         toc_marker_;
@@ -11,11 +11,13 @@
 #include <QKeyEvent>
 #include <QSplitter>
 #include <QDateTime>
+#include <QDir>
 #include <QFrame>
 #include <QPainter>
 #include <QMenu>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QToolTip>
 
 using namespace widgetkit;
 
@@ -125,26 +127,101 @@ void EditPage::request_sync_wcstate() {
         tr("EditPage.word_count_format").arg(get_friendly_word_count(chap_words_)));
 }
 
-void EditPage::do_update_wcstate(const QString &text, bool text_changed) {
+void EditPage::do_update_wcstate(bool text_changed) {
     jwrite_profiler_start(WordCounterCost);
-    if (text_changed) { total_words_ -= chap_words_; }
-    chap_words_ = word_counter_->count_all(text);
-    if (text_changed) { total_words_ += chap_words_; }
+    const int last_chap_words = chap_words_;
+    chap_words_               = ui_editor_->count_words(block_word_counter_, word_counter_.get());
+    if (text_changed) {
+        total_words_ += chap_words_ - last_chap_words;
+        writing_stats_.record(chap_words_ - last_chap_words);
+    }
     jwrite_profiler_record(WordCounterCost);
 }
 
 void EditPage::do_flush_wcstate() {
+    stats_engine_->cancel();
     chap_words_  = 0;
     total_words_ = 0;
-    if (book_manager_) {
-        jwrite_profiler_start(WordCounterCost);
-        for (const auto cid : book_manager_->get_all_chapters()) {
-            const int count =
-                word_counter_->count_all(book_manager_->fetch_chapter_content(cid).value());
-            if (cid == current_cid_) { chap_words_ = count; }
-            total_words_ += count;
+    if (!book_manager_) { return; }
+
+    jwrite_profiler_start(WordCounterCost);
+    QList<int> pending_chapters{};
+    for (const auto cid : book_manager_->get_all_chapters()) {
+        //! NOTE: served from the word count index without touching the chapter content
+        if (const auto opt = book_manager_->find_chapter_word_count(cid)) {
+            if (cid == current_cid_) { chap_words_ = *opt; }
+            total_words_ += *opt;
+        } else {
+            pending_chapters << cid;
         }
-        jwrite_profiler_record(WordCounterCost);
+    }
+    jwrite_profiler_record(WordCounterCost);
+
+    //! NOTE: count the rest in the background, results are merged as they arrive
+    if (!pending_chapters.isEmpty()) {
+        full_stats_requested_ = false;
+        stats_engine_->compute(
+            pending_chapters, book_manager_->get_chapter_loader(), word_counter_);
+    }
+}
+
+void EditPage::request_book_stats() {
+    if (!book_manager_) { return; }
+    //! NOTE: never interrupt a running job, the word state depends on the flush job
+    if (stats_engine_->is_running()) { return; }
+
+    full_stats_requested_ = true;
+    stats_engine_->compute(
+        book_manager_->get_all_chapters(), book_manager_->get_chapter_loader(), word_counter_);
+
+    //! NOTE: only the chapters changed since the last request are segmented again
+    keyword_index_->update(book_manager_->get_all_chapters(), book_manager_->get_chapter_loader());
+}
+
+void EditPage::do_update_book_stats_tooltip(int done, int total) {
+    const int max_terms = 8;
+
+    const auto &stats = stats_engine_->partial_stats();
+    auto        text  = tr("EditPage.book_stats_format")
+                    .arg(get_friendly_word_count(stats.words))
+                    .arg(stats.chars)
+                    .arg(stats.paragraphs)
+                    .arg(stats.punctuations);
+    if (done < total) { text += '\n' + tr("EditPage.book_stats_progress").arg(done).arg(total); }
+
+    if (writing_stats_.is_open()) {
+        const auto now   = QDateTime::currentSecsSinceEpoch() + 1;
+        const auto today = QDate::currentDate().startOfDay().toSecsSinceEpoch();
+        const auto days  = writing_stats_.query(WritingStats::Granularity::Day, today, now);
+
+        int session_words = 0;
+        for (const auto &session : writing_stats_.sessions(today, now)) {
+            if (session.id == writing_stats_.current_session()) { session_words = session.net(); }
+        }
+        text += '\n'
+              + tr("EditPage.writing_activity_format")
+                    .arg(days.isEmpty() ? 0 : days.front().net())
+                    .arg(session_words);
+    }
+
+    if (!keyword_index_->is_running() && !keyword_index_->is_empty()) {
+        const auto join_terms = [](const QList<KeywordEntry> &entries) {
+            QStringList terms{};
+            for (const auto &entry : entries) { terms << entry.term; }
+            return terms.join(' ');
+        };
+        if (const auto keywords = keyword_index_->top_keywords(max_terms); !keywords.isEmpty()) {
+            text += '\n' + tr("EditPage.book_keywords_format").arg(join_terms(keywords));
+        }
+        if (const auto entities = keyword_index_->top_entities(max_terms); !entities.isEmpty()) {
+            text += '\n' + tr("EditPage.book_entities_format").arg(join_terms(entities));
+        }
+    }
+
+    ui_word_count_->setToolTip(text);
+    if (ui_word_count_->underMouse()) {
+        const auto pos = ui_word_count_->mapToGlobal(QPoint(0, ui_word_count_->height()));
+        QToolTip::showText(pos, text, ui_word_count_);
     }
 }
 
@@ -162,19 +239,22 @@ void EditPage::do_open_chapter(int cid) {
                   ? book_manager_->fetch_chapter_content(next_cid).value()
                   : QString{};
 
+    std::optional<int> last_words;
     if (last_cid != -1) {
         const auto loc = ui_editor_->currentTextLoc();
         if (loc.block_index != -1) { chapter_locs_[last_cid] = loc; }
+        //! NOTE: take the running total before the editor is reset to the next chapter
+        last_words = ui_editor_->count_words(block_word_counter_, word_counter_.get());
     }
 
-    do_update_wcstate(text, false);
-
     {
         auto guard = ui_editor_->lock_guard();
         ui_editor_->reset(text, true);
     }
 
-    book_manager_->sync_chapter_content(last_cid, text);
+    do_update_wcstate(false);
+
+    book_manager_->sync_chapter_content(last_cid, text, last_words);
 
     if (chapter_locs_.contains(next_cid)) {
         last_loc_ = chapter_locs_[next_cid];
@@ -184,18 +264,43 @@ void EditPage::do_open_chapter(int cid) {
 
     current_cid_ = next_cid;
 
-    //! TODO: provide interface in AbstractBookManager to get volume id of a chapter
-    for (const int vid : book_manager_->get_volumes()) {
-        if (!book_manager_->get_chapters_of_volume(vid).contains(cid)) { continue; }
+    if (const int vid = book_manager_->get_volume_of_chapter(cid); vid != -1) {
         ui_book_dir_->setSubItemSelected(vid, cid);
         ui_book_dir_->setTopItemEllapsed(vid, false);
     }
 
     jwrite_profiler_record(SwitchChapter);
 
+    do_prefetch_around(next_cid);
+
     //! TODO: scroll book dir to the selected chapter
 }
 
+void EditPage::do_prefetch_around(int cid) {
+    Q_ASSERT(book_manager_);
+
+    //! NOTE: the current chapter excluded
+    constexpr int MAX_RECENT_CHAPTERS = 4;
+
+    QList<int> targets{};
+    if (const int vid = book_manager_->get_volume_of_chapter(cid); vid != -1) {
+        const auto &chapters = book_manager_->get_chapters_of_volume(vid);
+        const int   index    = chapters.indexOf(cid);
+        //! NOTE: the next chapter first, reading forward is the common case
+        if (index + 1 < chapters.size()) { targets.append(chapters[index + 1]); }
+        if (index > 0) { targets.append(chapters[index - 1]); }
+    }
+
+    recent_cids_.removeOne(cid);
+    for (const int recent : recent_cids_) {
+        if (!targets.contains(recent)) { targets.append(recent); }
+    }
+    recent_cids_.prepend(cid);
+    if (recent_cids_.size() > MAX_RECENT_CHAPTERS + 1) { recent_cids_.removeLast(); }
+
+    book_manager_->prefetch_chapters(targets);
+}
+
 QString EditPage::get_friendly_word_count(int count) {
     if (count > 1000 * 100) {
         return " " + QString::number(count * 1e-4, 'f', 2)
@@ -210,6 +315,8 @@ QString EditPage::get_friendly_word_count(int count) {
 void EditPage::reset_word_counter(AbstractWordCounter *word_counter) {
     Q_ASSERT(word_counter);
     word_counter_.reset(word_counter);
+    block_word_counter_.reset();
+    if (book_manager_) { book_manager_->set_word_counter(word_counter_.get()); }
     request_invalidate_wcstate();
     do_flush_wcstate();
     request_sync_wcstate();
@@ -288,6 +395,14 @@ void EditPage::update_color_scheme(const ColorScheme &scheme) {
         pal.setColor(QPalette::WindowText, scheme.text());
         w->setPalette(pal);
     }
+
+    if (auto w = ui_perf_hud_) {
+        auto pal = w->palette();
+        pal.setColor(QPalette::Window, scheme.floating_item());
+        pal.setColor(QPalette::Base, scheme.floating_item_border());
+        pal.setColor(QPalette::WindowText, scheme.text());
+        w->setPalette(pal);
+    }
 }
 
 QString EditPage::get_book_id_of_source() const {
@@ -297,8 +412,14 @@ QString EditPage::get_book_id_of_source() const {
 void EditPage::drop_source_ref() {
     if (!book_manager_) { return; }
 
+    stats_engine_->cancel();
+    keyword_index_->reset();
+    writing_stats_.close();
+    journal_.close();
+    book_manager_->set_word_counter(nullptr);
     book_manager_ = nullptr;
     chapter_locs_.clear();
+    recent_cids_.clear();
     current_cid_ = -1;
 
     total_words_ = 0;
@@ -312,6 +433,14 @@ bool EditPage::reset_source(AbstractBookManager *book_manager) {
 
     drop_source_ref();
     book_manager_ = book_manager;
+    book_manager_->set_word_counter(word_counter_.get());
+
+    if (QDir dir{AppConfig::get_instance().path(AppConfig::StandardPath::UserData)};
+        dir.cd(book_manager_->info_ref().uuid)) {
+        writing_stats_.open(dir.filePath("STATS"));
+        //! NOTE: records left by the previous opening are kept until the next checkpoint
+        journal_.open(dir.filePath("JOURNAL"));
+    }
 
     ui_book_dir_->setModel(std::make_unique<BookModel>(book_manager_, ui_book_dir_));
 
@@ -341,13 +470,32 @@ void EditPage::sync_chapter_from_editor() {
     Q_ASSERT(book_manager_);
 
     {
-        auto guard = ui_editor_->lock_guard();
-        book_manager_->sync_chapter_content(current_cid_, ui_editor_->take());
+        auto      guard = ui_editor_->lock_guard();
+        const int words = ui_editor_->count_words(block_word_counter_, word_counter_.get());
+        book_manager_->sync_chapter_content(current_cid_, ui_editor_->take(), words);
     }
 
     current_cid_ = -1;
 }
 
+void EditPage::flush_chapter_to_source() {
+    if (current_cid_ == -1) { return; }
+
+    Q_ASSERT(book_manager_);
+
+    auto      guard = ui_editor_->lock_guard();
+    const int words = ui_editor_->count_words(block_word_counter_, word_counter_.get());
+    book_manager_->sync_chapter_content(current_cid_, ui_editor_->text(), words);
+}
+
+qint64 EditPage::journal_mark() const {
+    return journal_.mark();
+}
+
+void EditPage::checkpoint_journal(qint64 mark) {
+    journal_.checkpoint(mark);
+}
+
 void EditPage::focus_editor() {
     if (ui_editor_->hasFocus()) { return; }
     if (last_loc_.block_index != -1) {
@@ -406,10 +554,42 @@ void EditPage::handle_editor_on_activate() {
 }
 
 void EditPage::handle_editor_on_text_change(const QString &text) {
-    do_update_wcstate(text, true);
+    do_update_wcstate(true);
     request_sync_wcstate();
 }
 
+void EditPage::handle_editor_on_text_edit(const TextEditAction &action) {
+    if (current_cid_ == -1) { return; }
+    journal_.append(current_cid_, action);
+    if (journal_.needs_checkpoint()) { emit on_request_checkpoint(); }
+}
+
+void EditPage::handle_stats_engine_on_chapter_stats_ready(const ChapterStats &stats) {
+    if (!book_manager_) { return; }
+
+    //! NOTE: the chapter in the editor may have been edited since it was loaded by the engine,
+    //! its count is owned by the editor and stored when the chapter is synced
+    const bool is_current = stats.cid == current_cid_;
+    if (!is_current) { book_manager_->put_chapter_word_count(stats.cid, stats.words); }
+
+    //! NOTE: the word state is already complete when the full book stats are requested
+    if (full_stats_requested_) { return; }
+
+    total_words_ += is_current ? chap_words_ : stats.words;
+    request_sync_wcstate();
+}
+
+void EditPage::handle_stats_engine_on_progress(int done, int total) {
+    if (!full_stats_requested_) { return; }
+    do_update_book_stats_tooltip(done, total);
+}
+
+void EditPage::handle_keyword_index_on_finished(bool canceled) {
+    if (canceled || !full_stats_requested_ || stats_engine_->is_running()) { return; }
+    const int chapters = stats_engine_->partial_stats().chapters;
+    do_update_book_stats_tooltip(chapters, chapters);
+}
+
 void EditPage::handle_editor_on_focus_lost(VisualTextEditContext::TextLoc last_loc) {
     if (current_cid_ != -1) { chapter_locs_[current_cid_] = last_loc; }
     last_loc_ = last_loc;
@@ -469,8 +649,7 @@ void EditPage::handle_on_rename_selected_toc_item() {
     //! ATTENTION: do not use focusTopItem() here to get the vid, it is not always the
     //! corresponding top item to of the selected sub item
 
-    for (const int vid : book_manager_->get_volumes()) {
-        if (!book_manager_->get_chapters_of_volume(vid).contains(cid)) { continue; }
+    if (const int vid = book_manager_->get_volume_of_chapter(cid); vid != -1) {
         request_rename_toc_item(vid, cid);
     }
 }
@@ -480,7 +659,8 @@ EditPage::EditPage(QWidget *parent)
     , current_cid_{-1}
     , chap_words_{0}
     , total_words_{0}
-    , word_counter_{std::make_unique<StrictWordCounter>()}
+    , word_counter_{std::make_shared<FastStrictWordCounter>()}
+    , full_stats_requested_{false}
     , book_manager_{nullptr} {
     init();
     request_invalidate_wcstate();
@@ -497,6 +677,9 @@ void EditPage::init() {
     ui_editor_     = new Editor;
     ui_menu_       = new FloatingMenu(ui_editor_);
     ui_word_count_ = new FloatingLabel(ui_editor_);
+    ui_perf_hud_   = new PerformanceHud(ui_editor_);
+    stats_engine_  = new BookStatsEngine(this);
+    keyword_index_ = new BookKeywordIndex(this);
 
     ui_new_volume_  = new FlatButton;
     ui_sidebar_     = new QWidget;
@@ -558,6 +741,9 @@ void EditPage::init() {
     //! install book dir item render proxy
     ui_book_dir_->setItemRenderProxy(std::make_unique<BookDirItemRenderProxy>());
 
+    ui_perf_hud_->set_anchor(ui_word_count_);
+    ui_perf_hud_->setVisible(false);
+
     auto quit_edit_action     = new QAction(ui_menu_);
     auto open_settings_action = new QAction(ui_menu_);
 
@@ -571,11 +757,28 @@ void EditPage::init() {
     connect(open_settings_action, &QAction::triggered, this, &EditPage::on_request_open_settings);
     connect(ui_editor_, &Editor::activated, this, &EditPage::handle_editor_on_activate);
     connect(ui_editor_, &Editor::textChanged, this, &EditPage::handle_editor_on_text_change);
+    connect(ui_editor_, &Editor::textEdited, this, &EditPage::handle_editor_on_text_edit);
     connect(
         ui_book_dir_, &TwoLevelTree::itemSelected, this, &EditPage::handle_book_dir_on_select_item);
     connect(ui_new_volume_, &FlatButton::pressed, this, &EditPage::handle_on_create_volume);
     connect(ui_new_chapter_, &FlatButton::pressed, this, &EditPage::handle_on_create_chapter);
     connect(ui_editor_, &Editor::focusLost, this, &EditPage::handle_editor_on_focus_lost);
+    connect(ui_word_count_, &FloatingLabel::clicked, this, &EditPage::request_book_stats);
+    connect(
+        stats_engine_,
+        &BookStatsEngine::on_chapter_stats_ready,
+        this,
+        &EditPage::handle_stats_engine_on_chapter_stats_ready);
+    connect(
+        stats_engine_,
+        &BookStatsEngine::on_progress,
+        this,
+        &EditPage::handle_stats_engine_on_progress);
+    connect(
+        keyword_index_,
+        &BookKeywordIndex::on_finished,
+        this,
+        &EditPage::handle_keyword_index_on_finished);
     connect(
         ui_book_dir_,
         &TwoLevelTree::contextMenuRequested,
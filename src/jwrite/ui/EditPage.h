@@ -4,9 +4,14 @@
 #include <jwrite/ui/FloatingLabel.h>
 #include <jwrite/ui/TwoLevelTree.h>
 #include <jwrite/ui/FloatingMenu.h>
+#include <jwrite/ui/PerformanceHud.h>
 #include <jwrite/ColorScheme.h>
 #include <jwrite/VisualTextEditContext.h>
 #include <jwrite/WordCounter.h>
+#include <jwrite/BookStats.h>
+#include <jwrite/BookKeywords.h>
+#include <jwrite/WritingStats.h>
+#include <jwrite/EditJournal.h>
 #include <jwrite/GlobalCommand.h>
 #include <jwrite/BookManager.h>
 #include <widget-kit/FlatButton.h>
@@ -23,16 +28,21 @@ signals:
     void on_request_rename_toc_item(const BookInfo &book_info, int vid, int cid);
     void on_request_quit_edit();
     void on_request_open_settings();
+    void on_request_checkpoint();
 
 public:
     void request_rename_toc_item(int vid, int cid);
 
     void request_invalidate_wcstate();
     void request_sync_wcstate();
-    void do_update_wcstate(const QString &text, bool text_changed);
+    void do_update_wcstate(bool text_changed);
     void do_flush_wcstate();
 
+    void request_book_stats();
+    void do_update_book_stats_tooltip(int done, int total);
+
     void do_open_chapter(int cid);
+    void do_prefetch_around(int cid);
 
 public:
     static QString get_friendly_word_count(int count);
@@ -48,6 +58,9 @@ public:
     int  add_volume(int index, const QString &title);
     int  add_chapter(int volume_index, const QString &title);
     void sync_chapter_from_editor();
+    void flush_chapter_to_source();
+    qint64 journal_mark() const;
+    void   checkpoint_journal(qint64 mark);
     void focus_editor();
 
     void rename_toc_item(int id, const QString &title);
@@ -61,6 +74,10 @@ public:
         ui_editor_->set_soft_center_mode_enabled(!ui_editor_->soft_center_mode_enabled());
     }
 
+    void set_performance_hud_visible(bool visible) {
+        ui_perf_hud_->setVisible(visible);
+    }
+
     Editor *editor() {
         return ui_editor_;
     }
@@ -72,6 +89,7 @@ public:
 public:
     void handle_editor_on_activate();
     void handle_editor_on_text_change(const QString &text);
+    void handle_editor_on_text_edit(const TextEditAction &action);
     void handle_editor_on_focus_lost(VisualTextEditContext::TextLoc last_loc);
     void handle_book_dir_on_select_item(bool is_top_item, int top_item_id, int sub_item_id);
     void handle_book_dir_on_double_click_item(bool is_top_item, int top_item_id, int sub_item_id);
@@ -79,6 +97,9 @@ public:
     void handle_on_create_volume();
     void handle_on_create_chapter();
     void handle_on_rename_selected_toc_item();
+    void handle_stats_engine_on_chapter_stats_ready(const ChapterStats &stats);
+    void handle_stats_engine_on_progress(int done, int total);
+    void handle_keyword_index_on_finished(bool canceled);
 
 public:
     explicit EditPage(QWidget *parent = nullptr);
@@ -87,10 +108,19 @@ protected:
     void init();
 
 private:
-    std::unique_ptr<AbstractWordCounter>      word_counter_;
+    std::shared_ptr<AbstractWordCounter>      word_counter_;
+    BlockWordCounter                          block_word_counter_;
+    BookStatsEngine                          *stats_engine_;
+    BookKeywordIndex                         *keyword_index_;
+    WritingStats                              writing_stats_;
+    EditJournal                               journal_;
+    //! NOTE: true if the running statistics job is requested for the full book stats
+    bool                                      full_stats_requested_;
     AbstractBookManager                      *book_manager_;
     int                                       current_cid_;
     QMap<int, VisualTextEditContext::TextLoc> chapter_locs_;
+    //! NOTE: recently opened chapters, the latest first
+    QList<int>                                recent_cids_;
     int                                       chap_words_;
     int                                       total_words_;
     VisualTextEditContext::TextLoc            last_loc_;
@@ -100,6 +130,7 @@ private:
     widgetkit::FlatButton   *ui_new_chapter_;
     TwoLevelTree            *ui_book_dir_;
     FloatingLabel           *ui_word_count_;
+    PerformanceHud          *ui_perf_hud_;
     QWidget                 *ui_sidebar_;
     QMap<QString, QWidget *> ui_named_widgets_;
     FloatingMenu            *ui_menu_;
@@ -64,6 +64,7 @@ void Editor::reset(QString &text, bool swap) {
     int active_block_index = context_->engine.active_block_index != -1 ? 0 : -1;
 
     last_text_loc_ = std::nullopt;
+    word_boundaries_.reset();
 
     context_->viewport_y_pos = 0;
     context_->engine.clear_all();
@@ -163,6 +164,17 @@ QString Editor::text() const {
     return blocks.join("\n");
 }
 
+int Editor::count_words(BlockWordCounter &cache, AbstractWordCounter *counter) const {
+    auto &lock = context_->lock;
+
+    //! NOTE: the text is only edited on the gui thread, a write lock held here is always the one
+    //! of the caller, otherwise wait for the read lock instead of walking the blocks unlocked
+    if (lock.on_write()) { return cache.count(counter, context_->engine.active_blocks); }
+
+    const auto guard = lock.read_lock_guard();
+    return cache.count(counter, context_->engine.active_blocks);
+}
+
 VisualTextEditContext::TextLoc Editor::currentTextLoc() const {
     return context_->current_textloc();
 }
@@ -262,6 +274,7 @@ void Editor::execute_delete_action(int times) {
     }
     const auto loc = currentTextLoc();
     history_.push(TextEditAction::from_action(TextEditAction::Type::Delete, loc, deleted_text));
+    emit textEdited({.type = TextEditAction::Type::Delete, .loc = loc, .text = deleted_text});
 }
 
 void Editor::direct_insert(const QString &text) {
@@ -295,6 +308,7 @@ void Editor::execute_insert_action(const QString &text, bool batch_mode) {
         direct_insert(text);
     }
     history_.push(TextEditAction::from_action(TextEditAction::Type::Insert, loc, text));
+    emit textEdited({.type = TextEditAction::Type::Insert, .loc = loc, .text = text});
 }
 
 bool Editor::insert_action_filter(const QString &text) {
@@ -437,6 +451,7 @@ void Editor::undo() {
                 direct_delete(action.text.length(), nullptr);
             } break;
         }
+        emit textEdited(action);
         emit textChanged(context_->edit_text);
         requestUpdate(true);
     }
@@ -455,6 +470,7 @@ void Editor::redo() {
                 direct_delete(action.text.length(), nullptr);
             } break;
         }
+        emit textEdited(action);
         emit textChanged(context_->edit_text);
         requestUpdate(true);
     }
@@ -514,7 +530,7 @@ void Editor::render() {
     }
 
     if (update_requested_) {
-        update();
+        updateTextView();
         update_requested_ = false;
     }
 }
@@ -556,20 +572,23 @@ void Editor::init() {
     setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::MinimumExpanding);
     setContentsMargins({});
 
-    min_text_line_chars_       = 12;
-    focus_mode_                = AppConfig::TextFocusMode::Highlight;
-    soft_center_mode_          = false;
-    elastic_resize_            = false;
-    expected_scroll_           = 0.0;
-    auto_centre_edit_line_     = AutoCentre::Never;
-    blink_cursor_should_paint_ = true;
-    inserted_filter_enabled_   = true;
-    drag_sel_flag_             = false;
-    oob_drag_sel_flag_         = false;
-    smooth_scroll_enabled_     = true;
-    auto_scroll_mode_          = false;
-    ui_cursor_shape_[0]        = Qt::ArrowCursor;
-    ui_cursor_shape_[1]        = Qt::ArrowCursor;
+    min_text_line_chars_           = 12;
+    focus_mode_                    = AppConfig::TextFocusMode::Highlight;
+    soft_center_mode_              = false;
+    elastic_resize_                = false;
+    expected_scroll_               = 0.0;
+    auto_centre_edit_line_         = AutoCentre::Never;
+    blink_cursor_should_paint_     = true;
+    inserted_filter_enabled_       = true;
+    drag_sel_flag_                 = false;
+    oob_drag_sel_flag_             = false;
+    smooth_scroll_enabled_         = true;
+    auto_scroll_mode_              = false;
+    ui_cursor_shape_[0]            = Qt::ArrowCursor;
+    ui_cursor_shape_[1]            = Qt::ArrowCursor;
+    unfocused_text_layer_ready_    = false;
+    unfocused_text_layer_revision_ = -1;
+    unfocused_text_layer_y_pos_    = 0.0;
 
     set_soft_center_mode_enabled(true);
     set_elastic_resize_enabled(false);
@@ -615,7 +634,7 @@ void Editor::requestUpdate(bool sync) {
         }
     } else {
         update_requested_ = false;
-        update();
+        updateTextView();
     }
 }
 
@@ -629,95 +648,234 @@ void Editor::restoreCursorShape() {
     setCursorShape(ui_cursor_shape_[1]);
 }
 
-void Editor::drawTextArea(QPainter *p) {
+bool Editor::isUnfocusedTextLayerValid() const {
+    if (!unfocused_text_layer_ready_) { return false; }
+    auto color = palette().color(QPalette::Text);
+    color.setAlpha(unfocused_text_opacity_ * 255);
+    return unfocused_text_layer_revision_ == context_->engine.revision
+        && unfocused_text_layer_y_pos_ == context_->viewport_y_pos
+        && unfocused_text_layer_color_ == color
+        && unfocused_text_layer_.size() == size() * devicePixelRatioF();
+}
+
+void Editor::updateUnfocusedTextLayer() {
+    const auto &d   = context_->cached_render_state;
+    const auto &e   = context_->engine;
+    const auto  dpr = devicePixelRatioF();
+
+    auto color = palette().color(QPalette::Text);
+    color.setAlpha(unfocused_text_opacity_ * 255);
+
+    //! NOTE: the focused block is drawn over the layer on each frame, so it's left out
+    const int focused_index =
+        e.is_cursor_available() && d.active_block_visible ? e.active_block_index : -1;
+
+    QList<UnfocusedTextBlock> blocks{};
+    for (int index = d.visible_block.first; index <= d.visible_block.last; ++index) {
+        if (index == focused_index) { continue; }
+        const auto block = e.active_blocks[index];
+        blocks.append({block, block->revision, getTextBlockRect(index)});
+    }
+
+    const auto size       = this->size() * dpr;
+    const bool full_reset = !unfocused_text_layer_ready_ || unfocused_text_layer_color_ != color
+                         || unfocused_text_layer_.size() != size;
+
+    //! NOTE: only the area of the blocks that are changed, moved, focused or unfocused since the
+    //! last update is repainted, e.g. the edited block and the following ones if its height changed
+    QRegion dirty_region{};
+    if (full_reset) {
+        if (unfocused_text_layer_.size() != size) {
+            unfocused_text_layer_ = QPixmap(size);
+            unfocused_text_layer_.setDevicePixelRatio(dpr);
+        }
+        dirty_region = rect();
+    } else {
+        for (const auto &block : unfocused_text_layer_blocks_) {
+            if (!blocks.contains(block)) { dirty_region |= block.rect; }
+        }
+        for (const auto &block : blocks) {
+            if (!unfocused_text_layer_blocks_.contains(block)) { dirty_region |= block.rect; }
+        }
+    }
+
+    if (!dirty_region.isEmpty()) {
+        QPainter p(&unfocused_text_layer_);
+        p.setClipRegion(dirty_region);
+        p.setCompositionMode(QPainter::CompositionMode_Clear);
+        p.fillRect(dirty_region.boundingRect(), Qt::transparent);
+        p.setCompositionMode(QPainter::CompositionMode_SourceOver);
+        p.setFont(ui_content_font_);
+        p.setPen(color);
+
+        //! NOTE: the blocks overlapped by the dirty region are drawn again within the clip, since
+        //! glyphs may overflow into the slack of the neighbours
+        const auto viewport = text_area();
+        for (int index = d.visible_block.first; index <= d.visible_block.last; ++index) {
+            if (index == focused_index) { continue; }
+            if (!dirty_region.intersects(getTextBlockRect(index))) { continue; }
+            const double y_pos =
+                viewport.top() + d.cached_block_y_pos[index] - context_->viewport_y_pos;
+            drawTextBlock(&p, e.active_blocks[index], y_pos);
+        }
+    }
+
+    unfocused_text_layer_ready_    = true;
+    unfocused_text_layer_revision_ = e.revision;
+    unfocused_text_layer_y_pos_    = context_->viewport_y_pos;
+    unfocused_text_layer_color_    = color;
+    unfocused_text_layer_blocks_   = std::move(blocks);
+}
+
+QRect Editor::getTextBlockRect(int block_index) const {
     const auto &d = context_->cached_render_state;
-    if (!d.found_visible_block) { return; }
+    const auto &e = context_->engine;
+    if (!d.cached_block_y_pos.contains(block_index)) { return QRect(); }
 
-    jwrite_profiler_start(TextBodyRenderCost);
+    const auto   block        = e.active_blocks[block_index];
+    const double line_spacing = e.line_height * e.line_spacing_ratio;
+    const double y_offset     = text_area().top() - context_->viewport_y_pos;
+    const double y_pos        = d.cached_block_y_pos[block_index] + y_offset;
+    const double height       = block->lines.size() * line_spacing;
 
-    const auto pal   = palette();
-    const auto flags = Qt::AlignBaseline | Qt::TextDontClip;
+    //! NOTE: glyphs may overflow the line box, leave a line of slack on both sides
+    const double slack = e.line_height;
+    return QRectF(0, y_pos - slack, width(), height + slack * 2).toAlignedRect();
+}
 
-    const auto focused_text_color = pal.color(QPalette::Text);
-    auto       default_text_color = focused_text_color;
+QRect Editor::getFocusedTextRect(int block_index, int row) const {
+    const auto &d = context_->cached_render_state;
+    const auto &e = context_->engine;
+    if (!d.cached_block_y_pos.contains(block_index)) { return QRect(); }
+
+    const auto   block        = e.active_blocks[block_index];
+    const double line_spacing = e.line_height * e.line_spacing_ratio;
+    const double y_offset     = text_area().top() - context_->viewport_y_pos;
+
+    double y_pos  = d.cached_block_y_pos[block_index] + y_offset;
+    double height = block->lines.size() * line_spacing;
+    if (focus_mode_ == AppConfig::TextFocusMode::FocusLine) {
+        y_pos  += row * line_spacing;
+        height  = line_spacing;
+    }
+
+    //! NOTE: glyphs may overflow the line box, leave a line of slack on both sides
+    const double slack = e.line_height;
+    return QRectF(0, y_pos - slack, width(), height + slack * 2).toAlignedRect();
+}
+
+void Editor::updateTextView() {
+    const auto &e = context_->engine;
 
     const bool on_focus_mode = focus_mode_ == AppConfig::TextFocusMode::FocusLine
                             || focus_mode_ == AppConfig::TextFocusMode::FocusBlock;
-    if (on_focus_mode && !context_->has_sel()) {
-        default_text_color.setAlpha(unfocused_text_opacity_ * 255);
+
+    //! NOTE: if only the cursor moves in focus mode, the unfocused text layer is still valid and
+    //! only the last and the next focused text need to be repainted
+    const bool partial = on_focus_mode && !last_focused_text_rect_.isNull() && !context_->has_sel()
+                      && e.is_cursor_available() && !e.is_dirty()
+                      && qAbs(context_->viewport_y_pos - expected_scroll_) <= 1e-3
+                      && isUnfocusedTextLayerValid();
+
+    if (partial) {
+        if (const auto rect = getFocusedTextRect(e.active_block_index, e.cursor.row);
+            !rect.isNull()) {
+            update(QRegion(last_focused_text_rect_) | rect);
+            return;
+        }
     }
 
-    p->save();
-    p->setPen(default_text_color);
+    update();
+}
 
+void Editor::drawTextLine(QPainter *p, const TextLine &line, double y_pos) {
+    const auto  &e             = context_->engine;
+    const auto   flags         = Qt::AlignBaseline | Qt::TextDontClip;
+    const auto   viewport      = text_area();
+    const double leading_space = line.is_first_line() ? e.standard_char_width * 2 : 0;
+    const double spacing       = line.char_spacing();
+
+    QRectF bb(viewport.left(), y_pos, viewport.width(), e.line_height);
+    bb.setLeft(viewport.left() + leading_space);
+    for (const auto c : line.text()) {
+        p->drawText(bb, flags, c);
+        const double advance = e.fm.horizontalAdvance(c);
+        bb.adjust(advance + spacing, 0, 0, 0);
+    }
+}
+
+void Editor::drawTextBlock(QPainter *p, const TextBlock *block, double y_pos) {
     const auto  &e            = context_->engine;
-    const double indent       = e.standard_char_width * 2;
     const double line_spacing = e.line_height * e.line_spacing_ratio;
-    const auto   viewport     = text_area();
+    for (const auto &line : block->lines) {
+        drawTextLine(p, line, y_pos);
+        y_pos += line_spacing;
+    }
+}
 
-    QRectF bb(viewport.left(), viewport.top(), viewport.width(), e.line_height);
-    bb.translate(0, d.first_visible_block_y_pos - context_->viewport_y_pos);
+void Editor::drawTextArea(QPainter *p) {
+    const auto &d = context_->cached_render_state;
+    if (!d.found_visible_block) { return; }
 
-    const auto y_pos = d.first_visible_block_y_pos - context_->viewport_y_pos;
-    auto       pos   = viewport.topLeft() + QPointF(0, y_pos);
+    jwrite_profiler_start(TextBodyRenderCost);
 
-    for (int index = d.visible_block.first; index <= d.visible_block.last; ++index) {
-        const auto block = e.active_blocks[index];
+    const bool on_focus_mode = focus_mode_ == AppConfig::TextFocusMode::FocusLine
+                            || focus_mode_ == AppConfig::TextFocusMode::FocusBlock;
 
-        if (e.active_block_index != index || !on_focus_mode) {
-            for (const auto &line : block->lines) {
-                const double leading_space = line.is_first_line() ? indent : 0;
-                const double spacing       = line.char_spacing();
-                bb.setLeft(viewport.left() + leading_space);
-                for (const auto c : line.text()) {
-                    p->drawText(bb, flags, c);
-                    const double advance = e.fm.horizontalAdvance(c);
-                    bb.adjust(advance + spacing, 0, 0, 0);
-                }
-                bb.translate(0, line_spacing);
-            }
-        } else if (focus_mode_ == AppConfig::TextFocusMode::FocusBlock) {
-            p->save();
-            p->setPen(focused_text_color);
-            for (const auto &line : block->lines) {
-                const double leading_space = line.is_first_line() ? indent : 0;
-                const double spacing       = line.char_spacing();
-                bb.setLeft(viewport.left() + leading_space);
-                for (const auto c : line.text()) {
-                    p->drawText(bb, flags, c);
-                    const double advance = e.fm.horizontalAdvance(c);
-                    bb.adjust(advance + spacing, 0, 0, 0);
-                }
-                bb.translate(0, line_spacing);
-            }
-            p->restore();
-        } else if (focus_mode_ == AppConfig::TextFocusMode::FocusLine) {
-            for (const auto &line : block->lines) {
-                const double leading_space = line.is_first_line() ? indent : 0;
-                const double spacing       = line.char_spacing();
-                bb.setLeft(viewport.left() + leading_space);
-                if (line.line_nr == e.cursor.row) {
-                    p->save();
-                    p->setPen(focused_text_color);
-                }
-                for (const auto c : line.text()) {
-                    p->drawText(bb, flags, c);
-                    const double advance = e.fm.horizontalAdvance(c);
-                    bb.adjust(advance + spacing, 0, 0, 0);
-                }
-                if (line.line_nr == e.cursor.row) { p->restore(); }
-                bb.translate(0, line_spacing);
-            }
-        } else {
-            Q_UNREACHABLE();
+    if (on_focus_mode && !context_->has_sel()) {
+        //! NOTE: the unfocused text is rendered into a dimmed layer and reused across the frames,
+        //! each frame only repaints the changed blocks of the layer and draws the focused block
+        updateUnfocusedTextLayer();
+        p->drawPixmap(0, 0, unfocused_text_layer_);
+        drawFocusedText(p);
+    } else {
+        const auto &e        = context_->engine;
+        const auto  viewport = text_area();
+
+        p->save();
+        p->setPen(palette().color(QPalette::Text));
+        for (int index = d.visible_block.first; index <= d.visible_block.last; ++index) {
+            const double y_pos =
+                viewport.top() + d.cached_block_y_pos[index] - context_->viewport_y_pos;
+            drawTextBlock(p, e.active_blocks[index], y_pos);
         }
+        p->restore();
 
-        bb.translate(0, e.block_spacing);
+        last_focused_text_rect_ = QRect();
     }
 
+    jwrite_profiler_record(TextBodyRenderCost);
+}
+
+void Editor::drawFocusedText(QPainter *p) {
+    const auto &d = context_->cached_render_state;
+    const auto &e = context_->engine;
+
+    last_focused_text_rect_ = QRect();
+    if (!e.is_cursor_available() || !d.active_block_visible) { return; }
+
+    const auto   block        = e.current_block();
+    const double line_spacing = e.line_height * e.line_spacing_ratio;
+    const double y_pos = text_area().top() + d.active_block_y_start - context_->viewport_y_pos;
+
+    //! NOTE: the focused block is not in the unfocused text layer, in the focus line mode the rest
+    //! of its lines are dimmed here
+    p->save();
+    p->setPen(palette().color(QPalette::Text));
+    if (focus_mode_ == AppConfig::TextFocusMode::FocusBlock) {
+        drawTextBlock(p, block, y_pos);
+    } else if (focus_mode_ == AppConfig::TextFocusMode::FocusLine) {
+        for (int row = 0; row < block->lines.size(); ++row) {
+            p->setPen(row == e.cursor.row ? palette().color(QPalette::Text)
+                                          : unfocused_text_layer_color_);
+            drawTextLine(p, block->lines[row], y_pos + row * line_spacing);
+        }
+    } else {
+        Q_UNREACHABLE();
+    }
     p->restore();
 
-    jwrite_profiler_record(TextBodyRenderCost);
+    last_focused_text_rect_ = getFocusedTextRect(e.active_block_index, e.cursor.row);
 }
 
 bool Editor::updateTextLocToVisualPos(const QPoint &vpos) {
@@ -1035,8 +1193,8 @@ void Editor::keyPressEvent(QKeyEvent *e) {
             if (len == 0) {
                 move(-1, false);
             } else {
-                const auto word   = tokenizer()->get_last_word(block->text().left(len).toString());
-                const int  offset = word.length();
+                const int offset =
+                    cursor.pos - word_boundaries_.find_prev(*tokenizer(), block, cursor.pos);
                 Q_ASSERT(offset <= cursor.pos);
                 move_to(block->text_pos + cursor.pos - offset, false);
             }
@@ -1047,8 +1205,8 @@ void Editor::keyPressEvent(QKeyEvent *e) {
             if (len == 0) {
                 move(1, false);
             } else {
-                const auto word = tokenizer()->get_first_word(block->text().right(len).toString());
-                const int  offset = word.length();
+                const int offset =
+                    word_boundaries_.find_next(*tokenizer(), block, cursor.pos) - cursor.pos;
                 Q_ASSERT(offset <= len);
                 move_to(block->text_pos + cursor.pos + offset, false);
             }
@@ -1117,8 +1275,8 @@ void Editor::keyPressEvent(QKeyEvent *e) {
             if (context_->has_sel() || len == 0) {
                 del(-1);
             } else {
-                const auto word   = tokenizer()->get_last_word(block->text().left(len).toString());
-                const int  offset = word.length();
+                const int offset =
+                    cursor.pos - word_boundaries_.find_prev(*tokenizer(), block, cursor.pos);
                 Q_ASSERT(offset <= cursor.pos);
                 del(-offset);
             }
@@ -1129,8 +1287,8 @@ void Editor::keyPressEvent(QKeyEvent *e) {
             if (context_->has_sel() || len == 0) {
                 del(1);
             } else {
-                const auto word = tokenizer()->get_first_word(block->text().right(len).toString());
-                const int  offset = word.length();
+                const int offset =
+                    word_boundaries_.find_next(*tokenizer(), block, cursor.pos) - cursor.pos;
                 Q_ASSERT(offset <= len);
                 del(offset);
             }
@@ -1179,8 +1337,8 @@ void Editor::keyPressEvent(QKeyEvent *e) {
             if (len == 0) {
                 move(-1, true);
             } else {
-                const auto word   = tokenizer()->get_last_word(block->text().left(len).toString());
-                const int  offset = word.length();
+                const int offset =
+                    cursor.pos - word_boundaries_.find_prev(*tokenizer(), block, cursor.pos);
                 Q_ASSERT(offset <= cursor.pos);
                 move_to(block->text_pos + cursor.pos - offset, true);
             }
@@ -1191,8 +1349,8 @@ void Editor::keyPressEvent(QKeyEvent *e) {
             if (len == 0) {
                 move(1, true);
             } else {
-                const auto word = tokenizer()->get_first_word(block->text().right(len).toString());
-                const int  offset = word.length();
+                const int offset =
+                    word_boundaries_.find_next(*tokenizer(), block, cursor.pos) - cursor.pos;
                 Q_ASSERT(offset <= len);
                 move_to(block->text_pos + cursor.pos + offset, true);
             }
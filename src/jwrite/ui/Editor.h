@@ -5,8 +5,10 @@
 #include <jwrite/TextRestrictRule.h>
 #include <jwrite/TextEditHistory.h>
 #include <jwrite/Tokenizer.h>
+#include <jwrite/WordCounter.h>
 #include <jwrite/AppConfig.h>
 #include <QTimer>
+#include <QPixmap>
 #include <QWidget>
 
 namespace jwrite::ui {
@@ -26,6 +28,8 @@ public:
 signals:
     void on_text_area_change(QRect area);
     void textChanged(const QString &text);
+    //! NOTE: emitted for every committed edit, in the order they are applied
+    void textEdited(const TextEditAction &action);
     void focusLost(VisualTextEditContext::TextLoc last_loc);
     void activated();
 
@@ -36,30 +40,35 @@ public slots:
     }
 
     void set_text_focus_mode(AppConfig::TextFocusMode mode) {
-        focus_mode_ = mode;
+        focus_mode_                 = mode;
+        unfocused_text_layer_ready_ = false;
         update();
     }
 
     void set_unfocused_text_opacity(double opacity) {
-        unfocused_text_opacity_ = opacity;
+        unfocused_text_opacity_     = opacity;
+        unfocused_text_layer_ready_ = false;
         update();
     }
 
     void set_line_spacing_ratio(double ratio) {
         context_->engine.line_spacing_ratio = ratio;
         context_->cached_render_data_ready  = false;
+        unfocused_text_layer_ready_         = false;
         update();
     }
 
     void set_block_spacing(double spacing) {
         context_->engine.block_spacing     = spacing;
         context_->cached_render_data_ready = false;
+        unfocused_text_layer_ready_        = false;
         update();
     }
 
     void set_font_size(int size) {
         ui_content_font_.setPointSize(size);
         context_->engine.reset_font_metrics(QFontMetrics(ui_content_font_));
+        unfocused_text_layer_ready_ = false;
         update();
     }
 
@@ -68,6 +77,7 @@ public slots:
         ui_content_font_ = font;
         ui_content_font_.setPointSize(size);
         context_->engine.reset_font_metrics(QFontMetrics(ui_content_font_));
+        unfocused_text_layer_ready_ = false;
         update();
     }
 
@@ -92,6 +102,14 @@ public:
 
     QString text() const;
 
+    /*!
+     * \brief count words of the current text, only the blocks changed since the last call on the
+     * same cache are recounted
+     *
+     * \note may be called with the write lock of the editor held by the caller, see lock_guard
+     */
+    int count_words(BlockWordCounter &cache, AbstractWordCounter *counter) const;
+
     VisualTextEditContext::TextLoc currentTextLoc() const;
     void                           setCursorToTextLoc(const VisualTextEditContext::TextLoc &loc);
 
@@ -171,7 +189,16 @@ protected:
     bool updateTextLocToVisualPos(const QPoint &vpos);
     void stopDragAndSelect();
 
+    bool  isUnfocusedTextLayerValid() const;
+    void  updateUnfocusedTextLayer();
+    QRect getTextBlockRect(int block_index) const;
+    QRect getFocusedTextRect(int block_index, int row) const;
+    void  updateTextView();
+
+    void drawTextLine(QPainter *p, const TextLine &line, double y_pos);
+    void drawTextBlock(QPainter *p, const TextBlock *block, double y_pos);
     void drawTextArea(QPainter *p);
+    void drawFocusedText(QPainter *p);
     void drawSelection(QPainter *p);
     void drawHighlightBlock(QPainter *p);
     void drawCursor(QPainter *p);
@@ -196,6 +223,7 @@ private:
     AbstractTextRestrictRule *restrict_rule_;
     Tokenizer                *tokenizer_;
     QFuture<Tokenizer *>      fut_tokenizer_;
+    BlockWordBoundaries       word_boundaries_;
     TextEditHistory           history_;
 
     std::optional<VisualTextEditContext::TextLoc> last_text_loc_;
@@ -209,6 +237,25 @@ private:
     AppConfig::TextFocusMode focus_mode_;
     double                   unfocused_text_opacity_;
 
+    //! NOTE: block drawn into the unfocused text layer, with the state it was drawn in
+    struct UnfocusedTextBlock {
+        const TextBlock *block;
+        int              revision;
+        QRect            rect;
+
+        bool operator==(const UnfocusedTextBlock &other) const {
+            return block == other.block && revision == other.revision && rect == other.rect;
+        }
+    };
+
+    QPixmap                   unfocused_text_layer_;
+    bool                      unfocused_text_layer_ready_;
+    int                       unfocused_text_layer_revision_;
+    double                    unfocused_text_layer_y_pos_;
+    QColor                    unfocused_text_layer_color_;
+    QList<UnfocusedTextBlock> unfocused_text_layer_blocks_;
+    QRect                     last_focused_text_rect_;
+
     bool   drag_sel_flag_;
     int    oob_drag_sel_flag_;
     QPoint oob_drag_sel_vpos_;
@@ -11,6 +11,8 @@
 #include <jwrite/epub/EpubBuilder.h>
 #include <jwrite/AppAction.h>
 #include <jwrite/WordCounter.h>
+#include <jwrite/EditJournal.h>
+#include <jwrite/BookContainer.h>
 #include <jwrite/ProfileUtils.h>
 #include <widget-kit/TextInputDialog.h>
 #include <widget-kit/OverlaySurface.h>
@@ -29,6 +31,13 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QApplication>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrent>
+#include <QMutex>
+#include <atomic>
+#include <memory>
 
 using namespace widgetkit;
 
@@ -36,56 +45,288 @@ namespace jwrite::ui {
 
 class BookManager : public InMemoryBookManager {
 public:
+    BookManager(AutosaveScheduler *autosave, ChapterCache *cache, ChapterPrefetcher *prefetcher)
+        : autosave_{autosave}
+        , cache_{cache}
+        , prefetcher_{prefetcher} {}
+
+    ~BookManager() override {
+        cache_->remove_book(info_ref().uuid);
+    }
+
     bool chapter_cached(int cid) const {
-        return chapters_.contains(cid);
+        return cache_->contains(key_of(cid));
     }
 
     bool is_chapter_dirty(int cid) const {
-        return modified_.contains(cid);
+        return cache_->is_dirty(key_of(cid));
+    }
+
+    uint64_t chapter_version(int cid) const {
+        return cache_->version(key_of(cid));
+    }
+
+    ChapterCache::Key key_of(int cid) const {
+        return {AbstractBookManager::info_ref().uuid, cid};
+    }
+
+    const QByteArray &dictionary() {
+        if (!dictionary_loaded_) {
+            QFile file(get_path_to_dictionary());
+            if (file.open(QIODevice::ReadOnly)) { dictionary_ = file.readAll(); }
+            dictionary_loaded_ = true;
+        }
+        return dictionary_;
+    }
+
+    /*!
+     * \brief train the dictionary on the cached chapters if the book has none yet
+     *
+     * \param [out] jobs the write of the trained dictionary is appended to, until it's persisted
+     *
+     * \note the dictionary is never changed once persisted, chapters encoded with it must never
+     * outlive it, so it's only returned after the storage writer has written it, the chapters
+     * are deflated without it meanwhile
+     *
+     * \return the persisted dictionary, or empty if there is none yet
+     */
+    const QByteArray &ensure_dictionary(QList<StorageWriteJob> &jobs) {
+        if (!dictionary().isEmpty()) { return dictionary_; }
+        if (dictionary_written_->load()) {
+            dictionary_ = trained_dictionary_;
+            return dictionary_;
+        }
+        if (trained_dictionary_.isEmpty()) {
+            const auto samples  = cache_->snapshot_of(AbstractBookManager::info_ref().uuid);
+            trained_dictionary_ = ChapterCodec::train_dictionary(samples.values());
+        }
+        if (!trained_dictionary_.isEmpty()) {
+            jobs.append({
+                .path       = get_path_to_dictionary(),
+                .content    = trained_dictionary_,
+                .on_written = [written = dictionary_written_] { written->store(true); },
+            });
+        }
+        return dictionary_;
     }
 
     OptionalString fetch_chapter_content(int cid) override {
         if (!has_chapter(cid)) {
             return std::nullopt;
-        } else if (chapters_.contains(cid)) {
-            return {chapters_.value(cid)};
+        } else if (auto text = cache_->get(key_of(cid))) {
+            return text;
+        } else if (unrecoverable_.contains(cid)) {
+            return QString{};
         } else if (const auto path = get_path_to_chapter(cid); QFile::exists(path)) {
-            QFile file(path);
-            file.open(QIODevice::ReadOnly | QIODevice::Text);
-            Q_ASSERT(file.isOpen());
-            const auto content = file.readAll();
-            file.close();
-            chapters_[cid] = content;
+            const auto content = reader_of(cid)();
+            if (!content) {
+                spdlog::error(
+                    "from book {}: failed to decode chapter {}",
+                    info().uuid.toStdString(),
+                    cid);
+                return repair_chapter(cid).value_or(QString{});
+            }
+            cache_->insert(key_of(cid), *content);
             return content;
         } else {
             return QString{};
         }
     }
 
-    bool sync_chapter_content(int cid, const QString &text) override {
+    QFuture<OptionalString> fetch_chapter_content_async(int cid) override {
+        if (!has_chapter(cid) || chapter_cached(cid)) {
+            return AbstractBookManager::fetch_chapter_content_async(cid);
+        }
+        //! NOTE: read through the cache, a one-off pass over the book such as the export never
+        //! displaces the chapters being edited
+        return QtConcurrent::run(reader_of(cid));
+    }
+
+    void prefetch_chapters(const QList<int> &cids) override {
+        if (!prefetcher_) { return; }
+        for (const int cid : cids) {
+            if (!has_chapter(cid) || chapter_cached(cid)) { continue; }
+            //! NOTE: corrupted chapters are left to the synchronous fetch which repairs them
+            prefetcher_->request(key_of(cid), cache_->stamp(), reader_of(cid));
+        }
+    }
+
+    /*!
+     * \return reader of the stored chapter which is safe to be called from any thread, the result
+     * is nullopt if the file is missing or corrupted
+     */
+    std::function<OptionalString()> reader_of(int cid) {
+        return [path = get_path_to_chapter(cid), dictionary = dictionary()]() -> OptionalString {
+            QFile file(path);
+            if (!file.open(QIODevice::ReadOnly)) { return std::nullopt; }
+            return ChapterCodec::read(&file, dictionary);
+        };
+    }
+
+    using InMemoryBookManager::sync_chapter_content;
+
+    bool sync_chapter_content(
+        int cid, const QString &text, std::optional<int> word_count) override {
         if (!has_chapter(cid)) { return false; }
+        //! NOTE: unchanged since saved, e.g. the periodic flush of an untouched chapter
+        if (cache_->update(key_of(cid), text) == 0) { return true; }
         spdlog::info("from book {}: sync chapter {}", info().uuid.toStdString(), cid);
-        chapters_[cid] = text;
-        modified_.insert(cid);
+        //! NOTE: the corrupted file is replaced on next sync
+        unrecoverable_.remove(cid);
+        update_word_count_index(cid, text, word_count);
+        if (autosave_) { autosave_->notify_dirty(); }
         return true;
     }
 
+    qint64 get_chapter_journal_mark(int cid) override {
+        if (!has_chapter(cid)) { return 0; }
+        return ChapterCodec::journal_mark_of(get_path_to_chapter(cid));
+    }
+
+    std::function<OptionalString(int)> get_chapter_loader() override {
+        //! NOTE: copies here are implicitly shared, the loader never touches the book manager
+        const auto all_chapters = get_all_chapters();
+        const auto cached       = cache_->snapshot_of(AbstractBookManager::info_ref().uuid);
+        const auto chapters     = QSet<int>(all_chapters.cbegin(), all_chapters.cend());
+        const auto dictionary   = this->dictionary();
+        QDir       dir{AppConfig::get_instance().path(AppConfig::StandardPath::UserData)};
+        dir.cd(AbstractBookManager::info_ref().uuid);
+        return [cached, chapters, dictionary, dir](int cid) -> OptionalString {
+            if (!chapters.contains(cid)) { return std::nullopt; }
+            if (cached.contains(cid)) { return {cached.value(cid)}; }
+            QFile file(dir.filePath(QString::number(cid)));
+            if (!file.open(QIODevice::ReadOnly)) { return QString{}; }
+            return ChapterCodec::read(&file, dictionary).value_or(QString{});
+        };
+    }
+
     QString get_path_to_chapter(int cid) const {
         QDir dir{AppConfig::get_instance().path(AppConfig::StandardPath::UserData)};
         dir.cd(AbstractBookManager::info_ref().uuid);
         return dir.filePath(QString::number(cid));
     }
 
+    QString get_path_to_history() const {
+        QDir dir{AppConfig::get_instance().path(AppConfig::StandardPath::UserData)};
+        dir.cd(AbstractBookManager::info_ref().uuid);
+        return dir.filePath("history");
+    }
+
+    /*!
+     * \brief get the job that records a version of the chapter if the latest one is older than the
+     * interval
+     *
+     * \note the job is run by the storage writer once the chapter is written, it shares the
+     * history with the book manager and stays valid after the book is removed
+     */
+    StorageWriteJob::Callback snapshot_job(int cid, const QString &text, qint64 interval) {
+        return [history = history_, path = get_path_to_history(), cid, text, interval] {
+            QMutexLocker locker(&history->lock);
+            auto        &store = history->open(path);
+            const auto   now   = QDateTime::currentMSecsSinceEpoch();
+            if (const auto last = store.latest(cid); last && now - last->timestamp < interval) {
+                return;
+            }
+            store.record(cid, text, now);
+        };
+    }
+
+    bool is_chapter_restored(int cid) override {
+        QMutexLocker locker(&history_->lock);
+        return history_->restored.contains(cid);
+    }
+
+    /*!
+     * \brief recover a corrupted chapter from its clean cached copy, or its latest snapshot if it's
+     * not cached
+     *
+     * \note the corrupted file is kept aside as "<cid>.corrupt", and the recovered text is cached
+     * as dirty so that the chapter is rewritten on next sync
+     *
+     * \note a chapter that fails to be recovered is not tried again in the session until it's
+     * rewritten, so that neither the backup nor the history is touched over and over
+     *
+     * \return the recovered text, or nothing if the chapter has neither
+     */
+    std::optional<QString> repair_chapter(int cid) {
+        if (unrecoverable_.contains(cid)) { return std::nullopt; }
+
+        const auto path   = get_path_to_chapter(cid);
+        const auto backup = path + ".corrupt";
+        QFile::remove(backup);
+        QFile::copy(path, backup);
+
+        //! NOTE: a clean cached copy is exactly what was stored, while the snapshot may be older
+        if (auto text = cache_->get(key_of(cid))) {
+            spdlog::warn(
+                "from book {}: rewrite chapter {} from the cache", info().uuid.toStdString(), cid);
+            cache_->mark_dirty(key_of(cid));
+            if (autosave_) { autosave_->notify_dirty(); }
+            return text;
+        }
+
+        QMutexLocker locker(&history_->lock);
+        auto        &store = history_->open(get_path_to_history());
+        if (const auto last = store.latest(cid)) {
+            if (auto text = store.restore(last->id)) {
+                spdlog::warn(
+                    "from book {}: restored chapter {} from snapshot {}",
+                    info().uuid.toStdString(),
+                    cid,
+                    last->id);
+                history_->restored.insert(cid);
+                cache_->update(key_of(cid), *text);
+                update_word_count_index(cid, *text);
+                if (autosave_) { autosave_->notify_dirty(); }
+                return text;
+            }
+        }
+
+        spdlog::error(
+            "from book {}: no snapshot to restore chapter {}", info().uuid.toStdString(), cid);
+        unrecoverable_.insert(cid);
+        return std::nullopt;
+    }
+
+    QString get_path_to_dictionary() const {
+        QDir dir{AppConfig::get_instance().path(AppConfig::StandardPath::UserData)};
+        dir.cd(AbstractBookManager::info_ref().uuid);
+        return dir.filePath("DICT");
+    }
+
 private:
-    QMap<int, QString> chapters_;
-    QSet<int>          modified_;
+    //! NOTE: snapshots are recorded on the storage writer thread
+    struct History {
+        QMutex        lock;
+        SnapshotStore store;
+        //! NOTE: chapters restored from the snapshots, see is_chapter_restored
+        QSet<int>     restored;
+
+        SnapshotStore &open(const QString &path) {
+            if (!store.is_open()) { store.open(path); }
+            return store;
+        }
+    };
+
+    AutosaveScheduler                *autosave_;
+    ChapterCache                     *cache_;
+    ChapterPrefetcher                *prefetcher_;
+    QByteArray                        dictionary_;
+    bool                              dictionary_loaded_ = false;
+    //! NOTE: trained but not persisted yet, see ensure_dictionary
+    QByteArray                        trained_dictionary_;
+    //! NOTE: corrupted chapters that failed to be repaired in this session
+    QSet<int>                         unrecoverable_;
+    std::shared_ptr<std::atomic_bool> dictionary_written_ = std::make_shared<std::atomic_bool>();
+    std::shared_ptr<History>          history_            = std::make_shared<History>();
 };
 
 bool JustWrite::do_load_book(const BookInfo &book_info) {
     if (books_.contains(book_info.uuid)) { return false; }
-    auto bm        = new BookManager;
+    auto bm        = new BookManager(autosave_, &chapter_cache_, chapter_prefetcher_);
     bm->info_ref() = book_info;
     books_.insert(book_info.uuid, bm);
+    ++manifest_revision_;
     return true;
 }
 
@@ -128,25 +369,40 @@ void JustWrite::do_remove_book(const QString &book_id) {
     Q_ASSERT(books_.contains(book_id));
     auto bm = books_.take(book_id);
     delete bm;
+    unloaded_books_.remove(book_id);
+    persisted_tocs_.remove(book_id);
+    closed_journal_marks_.remove(book_id);
+    ++manifest_revision_;
 }
 
 void JustWrite::request_open_book(const QString &book_id) {
     Q_ASSERT(books_.contains(book_id));
+    do_load_book_toc(book_id);
     auto bm = books_.value(book_id);
     Q_ASSERT(bm);
 
     get_wait_builder()
         .withPolicy(Progress::UseMinimumDisplayTime, false)
         .withBlockingJob([this, bm] {
+            //! NOTE: the journal of the last source is closed here, remember where it ends
+            if (const auto last = ui_edit_page_->get_book_id_of_source();
+                !last.isEmpty() && last != bm->info_ref().uuid) {
+                closed_journal_marks_.insert(last, ui_edit_page_->journal_mark());
+            }
+            closed_journal_marks_.remove(bm->info_ref().uuid);
             ui_edit_page_->reset_source(bm);
             request_switch_page(AppConfig::Page::Edit);
             ui_edit_page_->request_invalidate_wcstate();
-        })
-        .withAsyncJob([this, bm] {
+            //! NOTE: served by the word count index, the missing counts are computed in the
+            //! background by the statistics engine of the edit page
             ui_edit_page_->do_flush_wcstate();
+            //! NOTE: the chapter switch touches the chapter cache, the prefetcher and the widgets,
+            //! all of which live on the gui thread
             if (const auto &chapters = bm->get_all_chapters(); !chapters.isEmpty()) {
                 ui_edit_page_->do_open_chapter(chapters.back());
             }
+        })
+        .withAsyncJob([this] {
             ui_edit_page_->editor()->prepare_render_data();
         })
         .exec(ui_surface_);
@@ -188,6 +444,8 @@ void JustWrite::do_update_book_info(BookInfo &book_info) {
     Q_ASSERT(book_info.creation_time.isValid());
     Q_ASSERT(book_info.last_update_time.isValid());
     books_.value(book_info.uuid)->info_ref() = book_info;
+    ++manifest_revision_;
+    autosave_->notify_dirty();
 }
 
 void JustWrite::request_rename_toc_item(const QString &book_id, int toc_id, TocType type) {
@@ -224,10 +482,12 @@ void JustWrite::do_rename_toc_item(const QString &book_id, int toc_id, const QSt
         title.toLocal8Bit().toStdString());
     const bool succeed = bm->update_title(toc_id, title);
     Q_ASSERT(succeed);
+    autosave_->notify_dirty();
 }
 
 void JustWrite::request_export_book(const QString &book_id) {
     Q_ASSERT(books_.contains(book_id));
+    do_load_book_toc(book_id);
     auto bm = books_.value(book_id);
 
     if (const int cid = ui_edit_page_->book_dir()->selectedSubItem(); bm->has_chapter(cid)) {
@@ -245,9 +505,7 @@ void JustWrite::request_export_book(const QString &book_id) {
             option);
         if (choice == MessageBox::Cancel) { return; }
         if (choice == MessageBox::Yes) {
-            wait([&] {
-                bm->sync_chapter_content(cid, ui_edit_page_->editor()->text());
-            });
+            bm->sync_chapter_content(cid, ui_edit_page_->editor()->text());
         }
     }
 
@@ -261,8 +519,9 @@ void JustWrite::request_export_book(const QString &book_id) {
     };
 
     QMap<QString, ExportInfo> filters{
-        {tr("JustWrite.request_export_book.filter.plain_text"), {ExportType::PlainText, ".txt"}},
-        {tr("JustWrite.request_export_book.filter.epub"),       {ExportType::ePub, ".epub"}    },
+        {tr("JustWrite.request_export_book.filter.plain_text"), {ExportType::PlainText, ".txt"}  },
+        {tr("JustWrite.request_export_book.filter.epub"),       {ExportType::ePub, ".epub"}      },
+        {tr("JustWrite.request_export_book.filter.archive"),    {ExportType::Archive, ".jwbook"}},
     };
 
     QString selected{};
@@ -294,9 +553,17 @@ void JustWrite::request_export_book(const QString &book_id) {
         path.toLocal8Bit().toStdString(),
         magic_enum::enum_name(export_info.type));
 
+    //! NOTE: the archive is packed from the stored files, which must be up to date, and the
+    //! chapters to store are only collected on the gui thread
+    if (export_info.type == ExportType::Archive) { do_sync_local_storage(); }
+
+    //! NOTE: the export runs in a worker, the chapters are read through a loader created here, so
+    //! that neither the chapter cache nor the dictionary of the book is touched off the gui thread
+    const auto loader = bm->get_chapter_loader();
+
     bool succeed = true;
     wait([&] {
-        succeed = do_export_book(book_id, path, export_info.type);
+        succeed = do_export_book(book_id, path, export_info.type, loader);
     });
 
     if (succeed) {
@@ -321,18 +588,26 @@ void JustWrite::request_export_book(const QString &book_id) {
     }
 }
 
-bool JustWrite::do_export_book(const QString &book_id, const QString &path, ExportType type) {
+bool JustWrite::do_export_book(
+    const QString                    &book_id,
+    const QString                    &path,
+    ExportType                        type,
+    const ChapterReadAhead::loader_t &loader) {
     switch (type) {
         case ExportType::PlainText: {
-            return do_export_book_as_plain_text(book_id, path);
+            return do_export_book_as_plain_text(book_id, path, loader);
         } break;
         case ExportType::ePub: {
-            return do_export_book_as_epub(book_id, path);
+            return do_export_book_as_epub(book_id, path, loader);
+        } break;
+        case ExportType::Archive: {
+            return do_export_book_as_archive(book_id, path);
         } break;
     }
 }
 
-bool JustWrite::do_export_book_as_plain_text(const QString &book_id, const QString &path) {
+bool JustWrite::do_export_book_as_plain_text(
+    const QString &book_id, const QString &path, const ChapterReadAhead::loader_t &loader) {
     Q_ASSERT(books_.contains(book_id));
     auto bm = books_.value(book_id);
 
@@ -342,6 +617,9 @@ bool JustWrite::do_export_book_as_plain_text(const QString &book_id, const QStri
     QTextStream out(&file);
 
     //! TODO: use specified toc format
+    //! NOTE: only the next chapter is read ahead, so that the memory stays bounded by a chapter
+    ChapterReadAhead reader(loader, bm->get_all_chapters(), 1);
+
     const int total_volumes = bm->get_volumes().size();
     int       chap_index    = 0;
     for (int i = 0; i < total_volumes; ++i) {
@@ -352,7 +630,7 @@ bool JustWrite::do_export_book_as_plain_text(const QString &book_id, const QStri
             << "\n\n";
         const auto &chaps = bm->get_chapters_of_volume(vid);
         for (const auto cid : chaps) {
-            const auto content = bm->fetch_chapter_content(cid).value();
+            const auto content = reader.take(cid);
             out << tr("JustWrite.do_export_book_as_plain_text.default_chapter_format")
                        .arg(++chap_index)
                        .arg(bm->get_title(cid).value())
@@ -364,7 +642,8 @@ bool JustWrite::do_export_book_as_plain_text(const QString &book_id, const QStri
     return true;
 }
 
-bool JustWrite::do_export_book_as_epub(const QString &book_id, const QString &path) {
+bool JustWrite::do_export_book_as_epub(
+    const QString &book_id, const QString &path, const ChapterReadAhead::loader_t &loader) {
     Q_ASSERT(books_.contains(book_id));
     auto bm = books_.value(book_id);
 
@@ -385,21 +664,33 @@ bool JustWrite::do_export_book_as_epub(const QString &book_id, const QString &pa
             bm->get_chapters_of_volume(vid).size());
     }
 
-    int global_chap_index = 0;
-    builder.with_name(title)
+    //! NOTE: entries are streamed into the archive, read ahead no more than the next chapter
+    ChapterReadAhead reader(loader, bm->get_all_chapters(), 1);
+    int              global_chap_index = 0;
+    return builder.with_name(title)
         .with_author(author)
-        .feed([this, bm, &global_chap_index](
+        .feed([this, bm, &reader, &global_chap_index](
                   int vol_index, int chap_index, QString &out_chap_title, QString &out_content) {
             const int vid  = bm->get_volumes()[vol_index];
             const int cid  = bm->get_chapters_of_volume(vid)[chap_index];
             out_chap_title = tr("JustWrite.do_export_book_as_epub.default_chapter_format")
                                  .arg(++global_chap_index)
                                  .arg(bm->get_title(cid).value());
-            out_content = bm->fetch_chapter_content(cid).value();
+            out_content = reader.take(cid);
         })
         .build();
+}
 
-    return true;
+bool JustWrite::do_export_book_as_archive(const QString &book_id, const QString &path) {
+    Q_ASSERT(books_.contains(book_id));
+
+    //! NOTE: the book is synced by the caller, wait for the files to land
+    storage_writer_->wait_for_done();
+
+    QDir dir{AppConfig::get_instance().path(AppConfig::StandardPath::UserData)};
+    if (!dir.cd(book_id)) { return false; }
+
+    return BookContainer::import_from(dir.absolutePath(), path);
 }
 
 void JustWrite::request_init_from_local_storage() {
@@ -412,6 +703,8 @@ void JustWrite::request_init_from_local_storage() {
         for (auto &bm : books_) {
             ui_gallery_->updateDisplayCaseItem(ui_gallery_->totalItems(), bm->info_ref());
         }
+        spdlog::info("startup: gallery ready at {} ms", startup_timer_.elapsed());
+        QTimer::singleShot(0, this, &JustWrite::request_load_pending_tocs);
     }
 }
 
@@ -501,100 +794,177 @@ void JustWrite::do_load_local_storage() {
             Q_ASSERT(succeed);
         }
 
-        if (!dir.exists(uuid)) { continue; }
+        //! NOTE: the toc is loaded on demand, or in the background once the gallery is shown
+        if (dir.exists(uuid)) { unloaded_books_.insert(uuid); }
+    }
 
-        {
-            const bool succeed = dir.cd(uuid);
-            Q_ASSERT(succeed);
-        }
+    //! NOTE: the loaded state is exactly what's on the disk
+    persisted_manifest_ = manifest_revision_;
+
+    spdlog::info(
+        "<-- DONE: {} books loaded from manifest in {} ms",
+        books_.size(),
+        startup_timer_.elapsed());
+}
 
-        auto bm = books_.value(uuid);
-        Q_ASSERT(bm);
-
-        if (dir.exists("TOC")) {
-            const auto toc_path = dir.filePath("TOC");
-            QFile      toc_file(toc_path);
-            toc_file.open(QIODevice::ReadOnly | QIODevice::Text);
-            const auto toc_text = toc_file.readAll();
-            toc_file.close();
-
-            const auto toc_json = QJsonDocument::fromJson(toc_text);
-            Q_ASSERT(toc_json.isArray());
-            const auto &volumes = toc_json.array();
-
-            /*! Json Structure
-             *  [
-             *      {
-             *          'vid': <volume-id>,
-             *          'title': '<volume-title>',
-             *          'chapters': [
-             *              {
-             *                  'cid': <chapter-id>,
-             *                  'title': '<chapter-title>',
-             *              }
-             *          ]
-             *      }
-             *  ]
-             */
-
-            int vol_index = 0;
-            for (const auto &vol_ref : volumes) {
-                Q_ASSERT(vol_ref.isObject());
-                const auto &volume    = vol_ref.toObject();
-                const auto  vid       = volume["vid"].toInt();
-                const auto  vol_title = volume["title"].toString("");
-                bm->add_volume_as(vol_index++, vid, vol_title);
-                const auto &chapters   = volume["chapters"].toArray({});
-                int         chap_index = 0;
-                for (const auto &chap_ref : chapters) {
-                    Q_ASSERT(chap_ref.isObject());
-                    const auto &chapter    = chap_ref.toObject();
-                    const auto  cid        = chapter["cid"].toInt();
-                    const auto  chap_title = chapter["title"].toString("");
-                    bm->add_chapter_as(vid, chap_index++, cid, chap_title);
+bool JustWrite::do_load_book_toc(const QString &book_id) {
+    if (!unloaded_books_.remove(book_id)) { return false; }
+    Q_ASSERT(books_.contains(book_id));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QDir dir{AppConfig::get_instance().path(AppConfig::StandardPath::UserData)};
+    if (!dir.cd(book_id)) { return false; }
+
+    //! FIXME: unsafe cast
+    auto bm = static_cast<BookManager *>(books_.value(book_id));
+    Q_ASSERT(bm);
+
+    if (dir.exists("TOC")) {
+        const auto toc_path = dir.filePath("TOC");
+        QFile      toc_file(toc_path);
+        toc_file.open(QIODevice::ReadOnly | QIODevice::Text);
+        const auto toc_text = toc_file.readAll();
+        toc_file.close();
+
+        const auto toc_json = QJsonDocument::fromJson(toc_text);
+        Q_ASSERT(toc_json.isObject() || toc_json.isArray());
+        //! NOTE: a legacy toc is the bare list of volumes without the id counter
+        const auto volumes =
+            toc_json.isArray() ? toc_json.array() : toc_json.object()["volumes"].toArray({});
+
+        /*! Json Structure
+         *  {
+         *      'next_id': <next-toc-id>,
+         *      'volumes': [
+         *          {
+         *              'vid': <volume-id>,
+         *              'title': '<volume-title>',
+         *              'chapters': [
+         *                  {
+         *                      'cid': <chapter-id>,
+         *                      'title': '<chapter-title>',
+         *                      'word_count': {
+         *                          'counter': '<word-counter-name>',
+         *                          'count': <word-count>,
+         *                          'hash': '<content-hash>',
+         *                      },
+         *                  }
+         *              ]
+         *          }
+         *      ]
+         *  }
+         */
+
+        int vol_index = 0;
+        for (const auto &vol_ref : volumes) {
+            Q_ASSERT(vol_ref.isObject());
+            const auto &volume    = vol_ref.toObject();
+            const auto  vid       = volume["vid"].toInt();
+            const auto  vol_title = volume["title"].toString("");
+            bm->add_volume_as(vol_index++, vid, vol_title);
+            const auto &chapters   = volume["chapters"].toArray({});
+            int         chap_index = 0;
+            for (const auto &chap_ref : chapters) {
+                Q_ASSERT(chap_ref.isObject());
+                const auto &chapter    = chap_ref.toObject();
+                const auto  cid        = chapter["cid"].toInt();
+                const auto  chap_title = chapter["title"].toString("");
+                bm->add_chapter_as(vid, chap_index++, cid, chap_title);
+                if (const auto wc = chapter["word_count"]; wc.isObject()) {
+                    const auto &record = wc.toObject();
+                    bm->restore_word_count_record(
+                        cid,
+                        {
+                            .counter = record["counter"].toString(""),
+                            .count   = record["count"].toInt(),
+                            .hash    = record["hash"].toString("").toLatin1(),
+                        });
                 }
             }
         }
 
-        dir.cdUp();
+        if (toc_json.isObject()) { bm->restore_next_toc_id(toc_json.object()["next_id"].toInt()); }
+
+        persisted_tocs_.insert(book_id, bm->toc_revision());
     }
 
-    spdlog::info("<-- DONE");
-}
+    //! NOTE: records left in the journal mean the last session did not exit cleanly
+    int replayed_edits = 0;
+    if (dir.exists("JOURNAL")) {
+        replayed_edits = EditJournal::replay(dir.filePath("JOURNAL"), bm);
+    }
 
-void JustWrite::do_sync_local_storage() {
-    spdlog::info("sync data to local storage BEGIN -->");
+    spdlog::info(
+        "from book {}: toc of {} chapters loaded in {} ms, {} edits replayed",
+        book_id.toStdString(),
+        bm->get_all_chapters().size(),
+        timer.elapsed(),
+        replayed_edits);
 
-    QJsonObject local_storage;
-    QJsonArray  book_data;
+    if (replayed_edits > 0) { do_sync_local_storage(); }
 
-    //! FIXME: combine with local data
+    return true;
+}
 
-    for (const auto &[uuid, bm] : books_.asKeyValueRange()) {
-        const auto &book_info = bm->info_ref();
-        Q_ASSERT(uuid == book_info.uuid);
-        QJsonObject book;
-        book["book_id"]          = book_info.uuid;
-        book["name"]             = book_info.title;
-        book["author"]           = book_info.author;
-        book["cover_url"]        = book_info.cover_url;
-        book["creation_time"]    = book_info.creation_time.toString(Qt::ISODate);
-        book["last_update_time"] = book_info.last_update_time.toString(Qt::ISODate);
-        book_data.append(book);
+void JustWrite::request_load_pending_tocs() {
+    if (unloaded_books_.isEmpty()) { return; }
+    //! NOTE: one book per event loop iteration, the gallery stays responsive meanwhile
+    do_load_book_toc(*unloaded_books_.cbegin());
+    if (unloaded_books_.isEmpty()) {
+        spdlog::info("startup: all tocs loaded at {} ms", startup_timer_.elapsed());
+        return;
     }
+    QTimer::singleShot(0, this, &JustWrite::request_load_pending_tocs);
+}
 
-    local_storage["major_author"] = likely_author_;
-    local_storage["data"]         = book_data;
+void JustWrite::do_sync_local_storage() {
+    spdlog::info("sync data to local storage BEGIN -->");
+
+    ui_edit_page_->flush_chapter_to_source();
 
     QDir dir{AppConfig::get_instance().path(AppConfig::StandardPath::UserData)};
     Q_ASSERT(dir.exists());
 
     //! TODO: check validity of local storage file
 
-    QFile data_file(dir.filePath("mainfest.json"));
-    data_file.open(QIODevice::WriteOnly | QIODevice::Text);
-    data_file.write(QJsonDocument(local_storage).toJson());
-    data_file.close();
+    //! NOTE: only the contents are collected here, the files are written and the snapshots are
+    //! recorded by the storage writer
+    QList<StorageWriteJob>  jobs{};
+    QMap<QString, qint64>   journal_marks{};
+    QList<PendingChapter>   chapters{};
+    QMap<QString, uint64_t> toc_revisions{};
+    const auto              source_book_id = ui_edit_page_->get_book_id_of_source();
+
+    //! NOTE: the manifest and the tocs are only rewritten if changed since the revision on disk
+    if (manifest_revision_ != persisted_manifest_) {
+        QJsonObject local_storage;
+        QJsonArray  book_data;
+
+        //! FIXME: combine with local data
+
+        for (const auto &[uuid, bm] : books_.asKeyValueRange()) {
+            const auto &book_info = bm->info_ref();
+            Q_ASSERT(uuid == book_info.uuid);
+            QJsonObject book;
+            book["book_id"]          = book_info.uuid;
+            book["name"]             = book_info.title;
+            book["author"]           = book_info.author;
+            book["cover_url"]        = book_info.cover_url;
+            book["creation_time"]    = book_info.creation_time.toString(Qt::ISODate);
+            book["last_update_time"] = book_info.last_update_time.toString(Qt::ISODate);
+            book_data.append(book);
+        }
+
+        local_storage["major_author"] = likely_author_;
+        local_storage["data"]         = book_data;
+
+        jobs.append({
+            .path    = dir.filePath("mainfest.json"),
+            .content = QJsonDocument(local_storage).toJson(),
+        });
+    }
 
     //! NOTE: here we simply sync to local according to the book set in the memory, and remove
     //! the book from the set also means remove the book from the local storage, however, in the
@@ -603,47 +973,182 @@ void JustWrite::do_sync_local_storage() {
     //! FIXME: you know what I'm gonna say - yeah, that's not a good idea
 
     for (const auto &[uuid, bm] : books_.asKeyValueRange()) {
+        //! NOTE: nothing of the book has been touched before its toc is loaded
+        if (unloaded_books_.contains(uuid)) { continue; }
+
         if (!dir.exists(uuid)) { dir.mkdir(uuid); }
         dir.cd(uuid);
 
-        QJsonArray volumes;
-        for (const int vid : bm->get_volumes()) {
-            QJsonObject volume;
-            QJsonArray  chapters;
-            for (const int cid : bm->get_chapters_of_volume(vid)) {
-                QJsonObject chapter;
-                chapter["cid"]   = cid;
-                chapter["title"] = bm->get_title(cid).value().get();
-                chapters.append(chapter);
+        //! FIXME: unsafe cast
+        const auto book_manager = static_cast<BookManager *>(bm);
+
+        if (const auto revision = book_manager->toc_revision();
+            !persisted_tocs_.contains(uuid) || persisted_tocs_.value(uuid) != revision) {
+            QJsonArray volumes;
+            for (const int vid : bm->get_volumes()) {
+                QJsonObject volume;
+                QJsonArray  chapters;
+                for (const int cid : bm->get_chapters_of_volume(vid)) {
+                    QJsonObject chapter;
+                    chapter["cid"]   = cid;
+                    chapter["title"] = bm->get_title(cid).value().get();
+                    if (auto opt = book_manager->get_word_count_record(cid)) {
+                        QJsonObject word_count;
+                        word_count["counter"] = opt->counter;
+                        word_count["count"]   = opt->count;
+                        word_count["hash"]    = QString::fromLatin1(opt->hash);
+                        chapter["word_count"] = word_count;
+                    }
+                    chapters.append(chapter);
+                }
+                volume["vid"]      = vid;
+                volume["title"]    = bm->get_title(vid).value().get();
+                volume["chapters"] = chapters;
+                volumes.append(volume);
             }
-            volume["vid"]      = vid;
-            volume["title"]    = bm->get_title(vid).value().get();
-            volume["chapters"] = chapters;
-            volumes.append(volume);
+
+            QJsonObject toc;
+            toc["next_id"] = book_manager->next_toc_id();
+            toc["volumes"] = volumes;
+
+            jobs.append({.path = dir.filePath("TOC"), .content = QJsonDocument(toc).toJson()});
+            toc_revisions.insert(uuid, revision);
         }
 
-        QFile toc_file(dir.filePath("TOC"));
-        toc_file.open(QIODevice::WriteOnly | QIODevice::Text);
-        toc_file.write(QJsonDocument(volumes).toJson());
-        toc_file.close();
+        //! NOTE: records of the journal up to the mark are persisted once the batch is written,
+        //! the mark is also stored with the chapters, so that a replay never applies them twice
+        qint64 journal_mark = 0;
+        if (uuid == source_book_id) {
+            journal_mark = ui_edit_page_->journal_mark();
+        } else if (const auto it = closed_journal_marks_.constFind(uuid);
+                   it != closed_journal_marks_.cend()) {
+            journal_mark = *it;
+        } else {
+            //! NOTE: the journal is only scanned once per session
+            journal_mark = EditJournal::mark_of(dir.filePath("JOURNAL"));
+            closed_journal_marks_.insert(uuid, journal_mark);
+        }
+        journal_marks[uuid] = journal_mark;
 
-        //! FIXME: unsafe cast
-        const auto book_manager = static_cast<BookManager *>(bm);
+        const auto method     = chapter_compression_;
+        const auto dictionary = method == ChapterCodec::Dictionary
+                                  ? book_manager->ensure_dictionary(jobs)
+                                  : QByteArray{};
         for (const int cid : book_manager->get_all_chapters()) {
             if (!book_manager->is_chapter_dirty(cid)) { continue; }
             Q_ASSERT(book_manager->chapter_cached(cid));
-            const auto content = std::move(book_manager->fetch_chapter_content(cid).value());
-            QFile      file(book_manager->get_path_to_chapter(cid));
-            file.open(QIODevice::WriteOnly | QIODevice::Text);
-            Q_ASSERT(file.isOpen());
-            file.write(content.toUtf8());
-            file.close();
+            //! NOTE: implicitly shared, the content is never copied or compressed on the gui thread
+            const auto text = book_manager->fetch_chapter_content(cid).value();
+            jobs.append({
+                .path    = book_manager->get_path_to_chapter(cid),
+                .content = text,
+                .encoder =
+                    [method, dictionary, journal_mark](const QString &text) {
+                        return ChapterCodec::encode(text, method, dictionary, journal_mark);
+                    },
+                .on_written = book_manager->snapshot_job(cid, text, snapshot_interval_),
+            });
+            chapters.append({book_manager->key_of(cid), book_manager->chapter_version(cid)});
         }
 
         dir.cdUp();
     }
 
-    spdlog::info("<-- DONE");
+    const int batch = storage_writer_->submit(jobs);
+    pending_checkpoints_.insert(batch, journal_marks);
+    pending_chapters_.insert(batch, chapters);
+    pending_tocs_.insert(batch, {.manifest = manifest_revision_, .tocs = toc_revisions});
+    autosave_->notify_saved();
+
+    spdlog::info("<-- DONE: {} files queued in batch {}", jobs.size(), batch);
+}
+
+void JustWrite::do_checkpoint_journals(int synced_batch) {
+    //! NOTE: every batch covers all the books, the marks of the latest synced batch supersede the
+    //! earlier ones
+    const auto end = pending_checkpoints_.upperBound(synced_batch);
+    if (end == pending_checkpoints_.begin()) { return; }
+    const auto marks = std::prev(end).value();
+    pending_checkpoints_.erase(pending_checkpoints_.begin(), end);
+
+    QDir       dir{AppConfig::get_instance().path(AppConfig::StandardPath::UserData)};
+    const auto source_book_id = ui_edit_page_->get_book_id_of_source();
+    for (const auto &[uuid, mark] : marks.asKeyValueRange()) {
+        if (uuid == source_book_id) {
+            ui_edit_page_->checkpoint_journal(mark);
+        } else if (mark > 0) {
+            EditJournal::checkpoint(dir.filePath(uuid + "/JOURNAL"), mark);
+        }
+    }
+}
+
+void JustWrite::do_unpin_saved_chapters(int synced_batch) {
+    //! NOTE: a chapter edited after its snapshot was taken has a newer version and stays pinned
+    const auto end = pending_chapters_.upperBound(synced_batch);
+    for (auto it = pending_chapters_.begin(); it != end; ++it) {
+        for (const auto &[key, version] : it.value()) { chapter_cache_.mark_clean(key, version); }
+    }
+    pending_chapters_.erase(pending_chapters_.begin(), end);
+}
+
+void JustWrite::do_commit_persisted_tocs(int synced_batch) {
+    //! NOTE: a failed batch is never reported as synced, its files are submitted again next time
+    const auto end = pending_tocs_.upperBound(synced_batch);
+    for (auto it = pending_tocs_.begin(); it != end; ++it) {
+        persisted_manifest_ = qMax(persisted_manifest_, it->manifest);
+        for (const auto &[uuid, revision] : it->tocs.asKeyValueRange()) {
+            if (!books_.contains(uuid)) { continue; }
+            persisted_tocs_.insert(uuid, qMax(persisted_tocs_.value(uuid), revision));
+        }
+    }
+    pending_tocs_.erase(pending_tocs_.begin(), end);
+}
+
+void JustWrite::request_scrub_library() {
+    struct ScrubTarget {
+        QString    book_id;
+        int        cid;
+        QString    path;
+        QByteArray dictionary;
+    };
+
+    //! NOTE: dirty chapters are about to be rewritten anyway, skip them
+    QList<ScrubTarget> targets{};
+    for (auto book : books_) {
+        auto bm = static_cast<BookManager *>(book);
+        for (const int cid : bm->get_all_chapters()) {
+            if (bm->is_chapter_dirty(cid)) { continue; }
+            const auto path = bm->get_path_to_chapter(cid);
+            if (!QFile::exists(path)) { continue; }
+            targets.append({bm->info_ref().uuid, cid, path, bm->dictionary()});
+        }
+    }
+    if (targets.isEmpty()) { return; }
+
+    auto watcher = new QFutureWatcher<QList<ChapterCache::Key>>(this);
+    connect(watcher, &QFutureWatcher<QList<ChapterCache::Key>>::finished, this, [this, watcher] {
+        do_repair_chapters(watcher->result());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run([targets] {
+        QList<ChapterCache::Key> corrupted{};
+        for (const auto &target : targets) {
+            if (ChapterCodec::verify(target.path, target.dictionary)) { continue; }
+            corrupted.append({target.book_id, target.cid});
+        }
+        return corrupted;
+    }));
+}
+
+void JustWrite::do_repair_chapters(const QList<ChapterCache::Key> &chapters) {
+    for (const auto &[book_id, cid] : chapters) {
+        //! NOTE: the book may have been removed or the chapter rewritten during the scrub
+        if (!books_.contains(book_id)) { continue; }
+        auto bm = static_cast<BookManager *>(books_.value(book_id));
+        if (!bm->has_chapter(cid) || bm->is_chapter_dirty(cid)) { continue; }
+        spdlog::error("from book {}: chapter {} failed the scrub", book_id.toStdString(), cid);
+        bm->repair_chapter(cid);
+    }
 }
 
 void JustWrite::request_switch_page(AppConfig::Page page) {
@@ -694,7 +1199,10 @@ QString JustWrite::get_default_author() const {
 }
 
 void JustWrite::set_default_author(const QString &author, bool force) {
-    if (likely_author_.isEmpty() || force) { likely_author_ = author; }
+    if (likely_author_.isEmpty() || force) {
+        likely_author_ = author;
+        ++manifest_revision_;
+    }
 }
 
 void JustWrite::update_color_scheme(const ColorScheme &scheme) {
@@ -875,18 +1383,47 @@ void JustWrite::handle_on_request_close() {
 void JustWrite::handle_on_about_to_quit() {
     spdlog::info("client is about to quit");
     if (current_page_ == AppConfig::Page::Edit) { ui_edit_page_->sync_chapter_from_editor(); }
+    //! NOTE: chapters are collected on the gui thread, only the wait for the writer runs in the job
+    do_sync_local_storage();
     wait([this] {
-        do_sync_local_storage();
+        storage_writer_->wait_for_done();
     });
+    do_checkpoint_journals(storage_writer_->synced_batch());
+}
+
+void JustWrite::handle_edit_page_on_request_checkpoint() {
+    //! NOTE: the journal is checkpointed once the running batch is written
+    if (storage_writer_->total_pending() > 0) { return; }
+    do_sync_local_storage();
+}
+
+void JustWrite::handle_editor_on_text_edit(const TextEditAction &action) {
+    autosave_->notify_edit(action.text.length());
+}
+
+void JustWrite::handle_autosave_on_save_requested() {
+    //! NOTE: never queue snapshots behind a running batch, the request is retried on next poll
+    if (storage_writer_->total_pending() > 0) { return; }
+    do_sync_local_storage();
+}
+
+void JustWrite::handle_storage_writer_on_synced(int batch) {
+    do_checkpoint_journals(batch);
+    do_unpin_saved_chapters(batch);
+    do_commit_persisted_tocs(batch);
+}
+
+void JustWrite::handle_prefetcher_on_chapter_loaded(
+    const ChapterCache::Key &key, const QString &text, uint64_t stamp) {
+    //! NOTE: the book may have been removed since the request
+    if (!books_.contains(key.first)) { return; }
+    chapter_cache_.prefetch(key, text, stamp);
 }
 
 void JustWrite::handle_on_open_gallery() {
     if (current_page_ == AppConfig::Page::Gallery) { return; }
-    if (current_page_ == AppConfig::Page::Edit) {
-        wait([this] {
-            ui_edit_page_->sync_chapter_from_editor();
-        });
-    }
+    //! NOTE: a sync merely updates the chapter cache, the files are written by the storage writer
+    if (current_page_ == AppConfig::Page::Edit) { ui_edit_page_->sync_chapter_from_editor(); }
     request_switch_page(AppConfig::Page::Gallery);
 }
 
@@ -960,9 +1497,12 @@ void JustWrite::handle_config_on_option_change(AppConfig::Option opt, bool on) {
         } break;
         case Option::KeyVersionRecognition: {
         } break;
+        case Option::Autosave: {
+            autosave_->set_enabled(on);
+        } break;
         case Option::StrictWordCount: {
             if (on) {
-                ui_edit_page_->reset_word_counter(new StrictWordCounter);
+                ui_edit_page_->reset_word_counter(new FastStrictWordCounter);
             } else {
                 ui_edit_page_->reset_word_counter(new LossenWordCounter);
             }
@@ -970,6 +1510,9 @@ void JustWrite::handle_config_on_option_change(AppConfig::Option opt, bool on) {
         case Option::SmoothScroll: {
             ui_edit_page_->editor()->set_smooth_scroll_enabled(on);
         } break;
+        case Option::ShowPerformanceHud: {
+            ui_edit_page_->set_performance_hud_visible(on);
+        } break;
     }
 }
 
@@ -1031,15 +1574,48 @@ void JustWrite::handle_config_on_value_change(AppConfig::ValOption opt, const QS
         case Option::ChapterLimit: {
         } break;
         case Option::TimingBackupInterval: {
+            bool         ok       = false;
+            const double interval = value.toDouble(&ok);
+            if (!ok) { break; }
+            snapshot_interval_ = qRound64(interval * 60 * 1000);
         } break;
         case Option::QuantitativeBackupThreshold: {
         } break;
+        case Option::AutosaveIdleDelay: {
+            bool         ok    = false;
+            const double delay = value.toDouble(&ok);
+            if (!ok) { break; }
+            autosave_->set_idle_delay(qRound(delay * 1000));
+        } break;
+        case Option::AutosaveMaxInterval: {
+            bool         ok       = false;
+            const double interval = value.toDouble(&ok);
+            if (!ok) { break; }
+            autosave_->set_max_interval(qRound(interval * 1000));
+        } break;
+        case Option::AutosaveChangeThreshold: {
+            bool      ok        = false;
+            const int threshold = value.toUInt(&ok);
+            if (!ok) { break; }
+            autosave_->set_change_threshold(threshold);
+        } break;
         case Option::BackgroundImage: {
         } break;
         case Option::EditorBackgroundImage: {
         } break;
         case Option::BackgroundImageOpacity: {
         } break;
+        case Option::ChapterCacheSize: {
+            bool      ok   = false;
+            const int size = value.toUInt(&ok);
+            if (!ok) { break; }
+            chapter_cache_.set_budget(static_cast<qint64>(size) * 1024 * 1024);
+        } break;
+        case Option::ChapterCompression: {
+            if (const auto method = ChapterCodec::method_from_name(value)) {
+                chapter_compression_ = *method;
+            }
+        } break;
         case Option::ToolbarIconSize: {
             bool      ok   = false;
             const int size = value.toUInt(&ok);
@@ -1073,7 +1649,14 @@ void JustWrite::handle_config_on_value_change(AppConfig::ValOption opt, const QS
 }
 
 JustWrite::JustWrite()
-    : auto_hide_toolbar_on_fullscreen_{true} {
+    : auto_hide_toolbar_on_fullscreen_{true}
+    , storage_writer_{new StorageWriter(this)}
+    , autosave_{new AutosaveScheduler(this)}
+    , chapter_prefetcher_{new ChapterPrefetcher(this)}
+    , persisted_manifest_{0}
+    , manifest_revision_{0}
+    , chapter_compression_{ChapterCodec::Stored}
+    , snapshot_interval_{5 * 60 * 1000} {
     setupUi();
     setupConnections();
     setMouseTracking(true);
@@ -1239,6 +1822,32 @@ void JustWrite::setupConnections() {
         &EditPage::on_request_rename_toc_item,
         this,
         &JustWrite::handle_book_dir_on_rename_toc_item__adapter);
+    connect(
+        ui_edit_page_,
+        &EditPage::on_request_checkpoint,
+        this,
+        &JustWrite::handle_edit_page_on_request_checkpoint);
+    connect(
+        ui_edit_page_->editor(),
+        &Editor::textEdited,
+        this,
+        &JustWrite::handle_editor_on_text_edit);
+    connect(
+        autosave_,
+        &AutosaveScheduler::on_save_requested,
+        this,
+        &JustWrite::handle_autosave_on_save_requested);
+    connect(
+        storage_writer_,
+        &StorageWriter::on_synced,
+        this,
+        &JustWrite::handle_storage_writer_on_synced,
+        Qt::QueuedConnection);
+    connect(
+        chapter_prefetcher_,
+        &ChapterPrefetcher::on_chapter_loaded,
+        this,
+        &JustWrite::handle_prefetcher_on_chapter_loaded);
     connect(
         this,
         &JustWrite::on_page_change,
@@ -1249,6 +1858,8 @@ void JustWrite::setupConnections() {
 }
 
 void JustWrite::init() {
+    startup_timer_.start();
+
     auto &config = AppConfig::get_instance();
 
     //! NOTE: Qt gives out an unexpected minimum height to my widgets and QLayout::invalidate()
@@ -1267,6 +1878,9 @@ void JustWrite::init() {
         handle_config_on_value_change(opt, config.value(opt));
     }
 
+    //! NOTE: verify the stored chapters in the background once the startup settles
+    QTimer::singleShot(30 * 1000, this, &JustWrite::request_scrub_library);
+
     auto       page    = config.primary_page();
     const auto book_id = config.value(AppConfig::ValOption::LastEditingBookOnQuit);
     if (page == AppConfig::Page::Edit && !books_.contains(book_id)) {
@@ -1277,6 +1891,8 @@ void JustWrite::init() {
     } else {
         request_switch_page(page);
     }
+
+    spdlog::info("startup: initial page ready at {} ms", startup_timer_.elapsed());
 }
 
 bool JustWrite::eventFilter(QObject *watched, QEvent *event) {
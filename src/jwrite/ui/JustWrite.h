@@ -6,6 +6,12 @@
 #include <jwrite/ui/Gallery.h>
 #include <jwrite/AppConfig.h>
 #include <jwrite/BookManager.h>
+#include <jwrite/StorageWriter.h>
+#include <jwrite/AutosaveScheduler.h>
+#include <jwrite/ChapterCache.h>
+#include <jwrite/ChapterCodec.h>
+#include <jwrite/ChapterPrefetcher.h>
+#include <jwrite/SnapshotStore.h>
 #include <jwrite/GlobalCommand.h>
 #include <widget-kit/OverlaySurface.h>
 #include <widget-kit/Progress.h>
@@ -14,6 +20,7 @@
 #include <QStackedWidget>
 #include <QStackedLayout>
 #include <QSystemTrayIcon>
+#include <QElapsedTimer>
 #include <functional>
 #include <optional>
 
@@ -31,9 +38,20 @@ public:
     enum class ExportType {
         PlainText,
         ePub,
+        //! single-file container of the stored book, see BookContainer
+        Archive,
     };
 
 protected:
+    //! chapter & version of its persisted snapshot
+    using PendingChapter = QPair<ChapterCache::Key, uint64_t>;
+
+    //! revisions of the manifest and the tocs written in a batch
+    struct PendingToc {
+        uint64_t                manifest;
+        QMap<QString, uint64_t> tocs;
+    };
+
     enum ToolbarItemType {
         TI_Gallery,
         TI_Draft,
@@ -73,14 +91,29 @@ protected:
     void do_rename_toc_item(const QString &book_id, int toc, const QString &title);
 
     void request_export_book(const QString &book_id);
-    bool do_export_book(const QString &book_id, const QString &path, ExportType type);
-    bool do_export_book_as_plain_text(const QString &book_id, const QString &path);
-    bool do_export_book_as_epub(const QString &book_id, const QString &path);
+    bool do_export_book(
+        const QString                    &book_id,
+        const QString                    &path,
+        ExportType                        type,
+        const ChapterReadAhead::loader_t &loader);
+    bool do_export_book_as_plain_text(
+        const QString &book_id, const QString &path, const ChapterReadAhead::loader_t &loader);
+    bool do_export_book_as_epub(
+        const QString &book_id, const QString &path, const ChapterReadAhead::loader_t &loader);
+    bool do_export_book_as_archive(const QString &book_id, const QString &path);
 
     void request_init_from_local_storage();
     void do_init_local_storage();
     void do_sync_local_storage();
     void do_load_local_storage();
+    bool do_load_book_toc(const QString &book_id);
+    void request_load_pending_tocs();
+    void do_checkpoint_journals(int synced_batch);
+    void do_unpin_saved_chapters(int synced_batch);
+    void do_commit_persisted_tocs(int synced_batch);
+
+    void request_scrub_library();
+    void do_repair_chapters(const QList<ChapterCache::Key> &chapters);
 
     void request_switch_page(AppConfig::Page page);
 
@@ -121,6 +154,12 @@ public slots:
     void handle_book_dir_on_rename_toc_item(const QString &book_id, int toc_id, TocType type);
     void handle_book_dir_on_rename_toc_item__adapter(const BookInfo &book_info, int vid, int cid);
     void handle_edit_page_on_export();
+    void handle_edit_page_on_request_checkpoint();
+    void handle_editor_on_text_edit(const TextEditAction &action);
+    void handle_autosave_on_save_requested();
+    void handle_storage_writer_on_synced(int batch);
+    void handle_prefetcher_on_chapter_loaded(
+        const ChapterCache::Key &key, const QString &text, uint64_t stamp);
     void handle_on_page_change(AppConfig::Page page);
     void handle_on_open_help();
     void handle_on_open_settings();
@@ -157,9 +196,31 @@ private:
     QMap<AppConfig::Page, QSet<int>>     page_toolbar_mask_;
     AppConfig::Page                      current_page_;
     QMap<QString, AbstractBookManager *> books_;
+    //! NOTE: books listed in the manifest whose toc is not loaded yet
+    QSet<QString>                        unloaded_books_;
+    QElapsedTimer                        startup_timer_;
     QString                              likely_author_;
     bool                                 fullscreen_;
     bool                                 auto_hide_toolbar_on_fullscreen_;
+    StorageWriter                       *storage_writer_;
+    AutosaveScheduler                   *autosave_;
+    ChapterPrefetcher                   *chapter_prefetcher_;
+    //! NOTE: journal marks of the books in each submitted batch
+    QMap<int, QMap<QString, qint64>>     pending_checkpoints_;
+    //! NOTE: marks of the journals not opened by the edit page, which never change until opened
+    //! again, a checkpoint keeps the mark as well
+    QHash<QString, qint64>               closed_journal_marks_;
+    //! NOTE: versions of the dirty chapters in each submitted batch
+    QMap<int, QList<PendingChapter>>     pending_chapters_;
+    QMap<int, PendingToc>                pending_tocs_;
+    //! NOTE: revisions known to be on the disk, unchanged files are never rewritten
+    QHash<QString, uint64_t>             persisted_tocs_;
+    uint64_t                             persisted_manifest_;
+    uint64_t                             manifest_revision_;
+    ChapterCache                         chapter_cache_;
+    ChapterCodec::Method                 chapter_compression_;
+    //! NOTE: min interval between the snapshots of a chapter, in units of millisecond
+    qint64                               snapshot_interval_;
 
     QSystemTrayIcon           *ui_tray_icon_;
     TitleBar                  *ui_title_bar_;
@@ -0,0 +1,178 @@
+#include <jwrite/ui/PerformanceHud.h>
+#include <QPainter>
+#include <QEvent>
+
+namespace jwrite::ui {
+
+static QString get_friendly_duration(int64_t us) {
+    if (us >= 1000) {
+        return QStringLiteral("%1ms").arg(us / 1e3, 0, 'f', 1);
+    } else {
+        return QStringLiteral("%1us").arg(us);
+    }
+}
+
+void PerformanceHud::set_anchor(QWidget *anchor) {
+    if (anchor_) { anchor_->removeEventFilter(this); }
+    anchor_ = anchor;
+    if (anchor_) { anchor_->installEventFilter(this); }
+    update_geometry();
+}
+
+void PerformanceHud::update_geometry() {
+    if (auto w = parentWidget()) {
+        const auto size      = sizeHint();
+        const int  spacing_x = 32;
+        const int  spacing_y = 16;
+        const auto rect      = w->contentsRect();
+        const int  pos_x     = rect.right() - size.width() - spacing_x;
+        int        pos_y     = rect.top() + spacing_y;
+        if (anchor_ && anchor_->isVisible()) { pos_y = anchor_->geometry().bottom() + 1; }
+        setGeometry(QRect(QPoint(pos_x, pos_y), size));
+    } else {
+        setGeometry(0, 0, 0, 0);
+    }
+}
+
+void PerformanceHud::reload_stats() {
+    //! NOTE: skip the formatting work entirely when the hud is hidden
+    if (!isVisible()) { return; }
+
+    for (auto &line : lines_) {
+        const auto &hist = JwriteProfiler.recent_histogram(line.target);
+        const auto  name = QString(magic_enum::enum_name(line.target).data());
+        if (hist.empty()) {
+            line.text        = QStringLiteral("%1  -").arg(name);
+            line.over_budget = false;
+            continue;
+        }
+        const auto p50 = hist.percentile(0.50);
+        const auto p95 = hist.percentile(0.95);
+        const auto p99 = hist.percentile(0.99);
+        line.text      = QStringLiteral("%1  p50 %2  p95 %3  p99 %4  n=%5")
+                        .arg(name)
+                        .arg(get_friendly_duration(p50))
+                        .arg(get_friendly_duration(p95))
+                        .arg(get_friendly_duration(p99))
+                        .arg(hist.count());
+        line.over_budget = p99 > FRAME_BUDGET;
+    }
+
+    update_geometry();
+    update();
+}
+
+PerformanceHud::PerformanceHud(QWidget *parent)
+    : QWidget(parent)
+    , anchor_{nullptr} {
+    Q_ASSERT(parent);
+
+    setupUi();
+
+    parent->installEventFilter(this);
+    connect(&JwriteProfiler, &Profiler::on_window_roll, this, &PerformanceHud::reload_stats);
+
+    update_geometry();
+}
+
+PerformanceHud::~PerformanceHud() {}
+
+QSize PerformanceHud::minimumSizeHint() const {
+    const auto margins = contentsMargins();
+    const auto margin_size =
+        QSize(margins.left() + margins.right(), margins.top() + margins.bottom());
+    const auto fm        = fontMetrics();
+    const int  padding_x = 10;
+    const int  padding_y = 4;
+    int        width     = 0;
+    for (const auto &line : lines_) {
+        width = qMax(width, fm.horizontalAdvance(line.text));
+    }
+    const int height = fm.height() * lines_.size();
+    return QSize(width + padding_x * 2, height + padding_y * 2) + margin_size;
+}
+
+QSize PerformanceHud::sizeHint() const {
+    return minimumSizeHint();
+}
+
+void PerformanceHud::setupUi() {
+    auto font = this->font();
+    font.setPointSize(8);
+    font.setStyleHint(QFont::Monospace);
+    setFont(font);
+
+    setContentsMargins(4, 4, 4, 4);
+    setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+
+    auto pal = palette();
+    pal.setColor(QPalette::BrightText, QColor(220, 60, 60));
+    setPalette(pal);
+
+    for (const auto target : {
+             ProfileTarget::FrameRenderCost,
+             ProfileTarget::TextEngineRenderCost,
+             ProfileTarget::InputMethodEditorResponse,
+             ProfileTarget::GeneralTextEdit,
+         }) {
+        lines_.append(StatLine{target, QString{}, false});
+    }
+}
+
+bool PerformanceHud::eventFilter(QObject *watched, QEvent *event) {
+    switch (event->type()) {
+        case QEvent::Show:
+            [[fallthrough]];
+        case QEvent::Hide:
+            [[fallthrough]];
+        case QEvent::Move:
+            [[fallthrough]];
+        case QEvent::Resize: {
+            update_geometry();
+        } break;
+        default: {
+        } break;
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+void PerformanceHud::showEvent(QShowEvent *event) {
+    QWidget::showEvent(event);
+    reload_stats();
+}
+
+void PerformanceHud::paintEvent(QPaintEvent *event) {
+    if (size().isEmpty()) { return; }
+
+    QPainter    p(this);
+    const auto &pal = palette();
+
+    p.setRenderHint(QPainter::Antialiasing);
+    p.setRenderHint(QPainter::TextAntialiasing);
+
+    const auto bb     = contentsRect();
+    const int  radius = 4;
+
+    p.setBrush(pal.window());
+    p.setPen(pal.base().color());
+    p.drawRoundedRect(bb, radius, radius);
+
+    const auto fm         = fontMetrics();
+    const int  padding_x  = 10;
+    const int  padding_y  = 4;
+    const auto foreground = pal.windowText().color();
+    const auto warning    = pal.brightText().color();
+
+    //! NOTE: highlight the targets whose tail latency is over the frame budget
+
+    QRect line_bb(
+        bb.left() + padding_x, bb.top() + padding_y, bb.width() - padding_x * 2, fm.height());
+    for (const auto &line : lines_) {
+        p.setPen(line.over_budget ? warning : foreground);
+        p.drawText(line_bb, Qt::AlignLeft | Qt::AlignVCenter, line.text);
+        line_bb.translate(0, fm.height());
+    }
+}
+
+} // namespace jwrite::ui
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <jwrite/ProfileUtils.h>
+#include <QWidget>
+
+namespace jwrite::ui {
+
+/*!
+ * \brief floating overlay reporting the frame time percentiles of the recent profiler window
+ */
+class PerformanceHud : public QWidget {
+    Q_OBJECT
+
+public:
+    //! in units of microsecond
+    constexpr static int FRAME_BUDGET = 16'000;
+
+    void set_anchor(QWidget *anchor);
+    void update_geometry();
+    void reload_stats();
+
+public:
+    explicit PerformanceHud(QWidget *parent);
+    ~PerformanceHud() override;
+
+public:
+    QSize minimumSizeHint() const override;
+    QSize sizeHint() const override;
+
+protected:
+    void setupUi();
+
+    bool eventFilter(QObject *watched, QEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    struct StatLine {
+        ProfileTarget target;
+        QString       text;
+        bool          over_budget;
+    };
+
+    QWidget        *anchor_;
+    QList<StatLine> lines_;
+};
+
+} // namespace jwrite::ui
@@ -938,6 +938,32 @@ QWidget *SettingsDialog::createBackupPanel() {
             "启用后，将根据历史编辑动作识别当前文档关键编辑节点，并生成独立的备份记录")
         .with_source(AppConfig::Option::KeyVersionRecognition)
         .complete()
+        .with_toggle("自动保存", "启用后，将在编辑停顿、编辑量或时长达到设定值时在后台保存")
+        .with_source(AppConfig::Option::Autosave)
+        .complete()
+        .with_double_spin("停顿保存", "编辑停顿达到指定时长后自动保存，设为 0 时禁用")
+        .with_bounds(0.0, 600.0)
+        .with_step(1.0)
+        .with_suffix("s")
+        .with_source(AppConfig::ValOption::AutosaveIdleDelay)
+        .complete()
+        .with_double_spin("最长保存间隔", "未保存的内容最多保留的时长，设为 0 时禁用")
+        .with_bounds(0.0, 3600.0)
+        .with_step(10.0)
+        .with_suffix("s")
+        .with_source(AppConfig::ValOption::AutosaveMaxInterval)
+        .complete()
+        .with_spin("定量保存", "未保存的编辑量达到指定字符数时立即保存，设为 0 时禁用")
+        .with_bounds(0, 10000)
+        .with_step(100)
+        .with_source(AppConfig::ValOption::AutosaveChangeThreshold)
+        .complete()
+        .with_combo("章节压缩", "压缩此后保存的章节文件，已有章节在下次修改保存时转换")
+        .with_item("不压缩", "none")
+        .with_item("标准压缩", "deflate")
+        .with_item("字典压缩", "dictionary")
+        .with_source(AppConfig::ValOption::ChapterCompression)
+        .complete()
         .build();
 
     layout->addSpacing(32);
@@ -1209,6 +1235,12 @@ QWidget *SettingsDialog::createDeepCustomizePanel() {
         .with_suffix("px")
         .with_source(AppConfig::ValOption::ToolbarIconSize)
         .complete()
+        .with_spin("章节缓存上限", "指定已打开章节内容的内存缓存上限\n未保存的章节不受该上限约束")
+        .with_bounds(8, 1024)
+        .with_step(8)
+        .with_suffix("MiB")
+        .with_source(AppConfig::ValOption::ChapterCacheSize)
+        .complete()
         .build();
 
     layout->addSpacing(32);
@@ -0,0 +1,140 @@
+#include <jwrite/BookContainer.h>
+#include <QTemporaryDir>
+#include <QDir>
+#include <gtest/gtest.h>
+
+using jwrite::BookContainer;
+
+static QByteArray read_file(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) { return {}; }
+    return file.readAll();
+}
+
+static void write_file(const QString &path, const QByteArray &data) {
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write(data);
+}
+
+TEST(BookContainer, KeepsCommittedStateOnly) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const auto path = dir.filePath("book.jwbook");
+
+    {
+        BookContainer container;
+        ASSERT_TRUE(container.open(path));
+        ASSERT_TRUE(container.write_chapter(1, "第一章", 3));
+        ASSERT_TRUE(container.write_chapter(2, "chapter two"));
+        ASSERT_TRUE(container.commit());
+        //! never committed
+        ASSERT_TRUE(container.write_chapter(1, "lost"));
+    }
+
+    BookContainer container;
+    ASSERT_TRUE(container.open(path));
+    EXPECT_EQ(container.chapters(), QList<int>({1, 2}));
+    EXPECT_EQ(container.read_chapter(1), "第一章");
+    EXPECT_EQ(container.word_count(1), 3);
+    EXPECT_EQ(container.word_count(2), BookContainer::UNKNOWN_WORD_COUNT);
+    EXPECT_FALSE(container.read_chapter(3).has_value());
+    EXPECT_EQ(container.garbage_size(), 0);
+
+    ASSERT_TRUE(container.write_chapter(2, "chapter 2"));
+    container.remove(1);
+    ASSERT_TRUE(container.commit());
+    EXPECT_GT(container.garbage_size(), 0);
+
+    const auto size = container.file_size();
+    ASSERT_TRUE(container.compact());
+    EXPECT_EQ(container.garbage_size(), 0);
+    EXPECT_LT(container.file_size(), size);
+    EXPECT_EQ(container.chapters(), QList<int>({2}));
+    EXPECT_EQ(container.read_chapter(2), "chapter 2");
+}
+
+TEST(BookContainer, ImportsAndExportsLosslessly) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    QDir root(dir.path());
+    ASSERT_TRUE(root.mkdir("src"));
+    const auto src = root.filePath("src");
+    const auto toc = QByteArray(R"({"next_id":5,"volumes":[{"vid":0,"title":"v","chapters":[)"
+                                R"({"cid":1,"title":"a","word_count":{"count":2}},)"
+                                R"({"cid":2,"title":"b"}]}]})");
+    write_file(QDir(src).filePath("TOC"), toc);
+    write_file(QDir(src).filePath("1"), "你好\r\n");
+
+    const auto path = root.filePath("book.jwbook");
+    ASSERT_TRUE(BookContainer::import_from(src, path));
+
+    BookContainer container;
+    ASSERT_TRUE(container.open(path));
+    EXPECT_EQ(container.read_toc(), toc);
+    EXPECT_EQ(container.chapters(), QList<int>({1}));
+    EXPECT_EQ(container.word_count(1), 2);
+    container.close();
+
+    const auto dst = root.filePath("dst");
+    ASSERT_TRUE(BookContainer::export_to(path, dst));
+    EXPECT_EQ(read_file(QDir(dst).filePath("TOC")), toc);
+    EXPECT_EQ(read_file(QDir(dst).filePath("1")), "你好\r\n");
+    EXPECT_FALSE(QFile::exists(QDir(dst).filePath("2")));
+
+    //! legacy toc without the id counter
+    write_file(QDir(src).filePath("TOC"), R"([{"vid":0,"title":"v","chapters":[{"cid":1}]}])");
+    ASSERT_TRUE(BookContainer::import_from(src, path));
+    ASSERT_TRUE(container.open(path));
+    EXPECT_EQ(container.chapters(), QList<int>({1}));
+}
+
+TEST(BookContainer, FallsBackToPreviousCommit) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const auto path = dir.filePath("book.jwbook");
+
+    const auto commit_twice = [&] {
+        BookContainer container;
+        ASSERT_TRUE(container.open(path));
+        ASSERT_TRUE(container.write_chapter(1, "first"));
+        ASSERT_TRUE(container.commit());
+        ASSERT_TRUE(container.write_chapter(1, "second"));
+        ASSERT_TRUE(container.commit());
+    };
+
+    //! a torn header of the latest commit, which lands in the first slot
+    commit_twice();
+    {
+        QFile file(path);
+        ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+        file.seek(16);
+        file.write("\xff");
+    }
+    {
+        BookContainer container;
+        ASSERT_TRUE(container.open(path));
+        EXPECT_EQ(container.read_chapter(1), "first");
+        //! the broken slot is reused by the next commit
+        ASSERT_TRUE(container.write_chapter(2, "third"));
+        ASSERT_TRUE(container.commit());
+    }
+    {
+        BookContainer container;
+        ASSERT_TRUE(container.open(path));
+        EXPECT_EQ(container.read_chapter(1), "first");
+        EXPECT_EQ(container.read_chapter(2), "third");
+    }
+
+    //! the index of the latest commit never reached the disk
+    QFile::remove(path);
+    commit_twice();
+    {
+        QFile file(path);
+        ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+        ASSERT_TRUE(file.resize(file.size() - 1));
+    }
+    BookContainer container;
+    ASSERT_TRUE(container.open(path));
+    EXPECT_EQ(container.read_chapter(1), "first");
+}
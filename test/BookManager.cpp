@@ -0,0 +1,154 @@
+#include "MockBookManager.h"
+#include <jwrite/BookManager.h>
+#include <jwrite/WordCounter.h>
+#include <gtest/gtest.h>
+#include <atomic>
+
+using jwrite::ChapterReadAhead;
+using jwrite::LossenWordCounter;
+
+class CountingWordCounter : public LossenWordCounter {
+public:
+    int count_all(const QString &text) override {
+        ++recounts;
+        return LossenWordCounter::count_all(text);
+    }
+
+    int recounts = 0;
+};
+
+TEST(BookManager, ReadsChaptersAhead) {
+    MockBookManager bm;
+    const int       vid = bm.add_volume(0, "volume");
+    for (int i = 0; i < 8; ++i) {
+        const int cid = bm.add_chapter(vid, i, QString("chapter %1").arg(i));
+        bm.sync_chapter_content(cid, QString("content %1").arg(i));
+    }
+    const auto chapters = bm.get_all_chapters();
+    bm.broken           = chapters[2];
+
+    ChapterReadAhead reader(&bm, chapters, 3);
+    EXPECT_EQ(bm.async_fetches, 3);
+
+    for (const int cid : chapters) { EXPECT_EQ(reader.take(cid), bm.contents.value(cid)); }
+    EXPECT_EQ(bm.async_fetches, chapters.size());
+
+    //! 7 fetched by the default async implementation, and the broken one falls back
+    EXPECT_EQ(bm.sync_fetches, chapters.size());
+
+    //! out of order
+    ChapterReadAhead other(&bm, chapters, 2);
+    EXPECT_EQ(other.take(chapters[4]), bm.contents.value(chapters[4]));
+    EXPECT_EQ(other.take(chapters[0]), bm.contents.value(chapters[0]));
+
+    //! through a loader, the book manager is never touched
+    const auto       contents = bm.contents;
+    std::atomic_int  loads    = 0;
+    ChapterReadAhead loaded(
+        [&contents, &loads](int cid) -> std::optional<QString> {
+            ++loads;
+            return {contents.value(cid)};
+        },
+        chapters,
+        1);
+    bm.sync_fetches  = 0;
+    bm.async_fetches = 0;
+    for (const int cid : chapters) { EXPECT_EQ(loaded.take(cid), contents.value(cid)); }
+    EXPECT_EQ(loads, chapters.size());
+    EXPECT_EQ(bm.sync_fetches + bm.async_fetches, 0);
+}
+
+TEST(BookManager, KeepsTocIndexInSync) {
+    MockBookManager bm;
+    const int       v1 = bm.add_volume(0, "v1");
+    const int       v2 = bm.add_volume(1, "v2");
+    const int       c1 = bm.add_chapter(v1, 0, "c1");
+    const int       c2 = bm.add_chapter(v2, 0, "c2");
+    const int       c3 = bm.add_chapter(v1, 1, "c3");
+    EXPECT_EQ(bm.get_all_chapters(), QList<int>({c1, c3, c2}));
+    EXPECT_EQ(bm.get_volume_of_chapter(c2), v2);
+    EXPECT_EQ(bm.get_volume_of_chapter(v1), -1);
+    EXPECT_FALSE(bm.has_chapter(v1));
+
+    ASSERT_TRUE(bm.remove_chapter(c1));
+    EXPECT_FALSE(bm.has_chapter(c1));
+    EXPECT_EQ(bm.get_volume_of_chapter(c1), -1);
+    EXPECT_EQ(bm.get_chapters_of_volume(v1), QList<int>({c3}));
+    EXPECT_EQ(bm.get_all_chapters(), QList<int>({c3, c2}));
+
+    EXPECT_EQ(bm.remove_volume(v2), 2);
+    EXPECT_FALSE(bm.has_chapter(c2));
+    EXPECT_EQ(bm.get_all_chapters(), QList<int>({c3}));
+
+    //! ids are never reused, even those loaded from the storage
+    const int c4 = bm.add_chapter(v1, 1, "c4");
+    EXPECT_GT(c4, c3);
+    ASSERT_TRUE(bm.add_chapter_as(v1, 2, 100, "c5"));
+    EXPECT_EQ(bm.add_volume(1, "v3"), 101);
+
+    //! nor across the sessions, once the counter is restored with the toc
+    ASSERT_TRUE(bm.remove_chapter(100));
+    MockBookManager reloaded;
+    ASSERT_TRUE(reloaded.add_volume_as(0, v1, "v1"));
+    ASSERT_TRUE(reloaded.add_chapter_as(v1, 0, c3, "c3"));
+    ASSERT_TRUE(reloaded.add_chapter_as(v1, 1, c4, "c4"));
+    EXPECT_LT(reloaded.next_toc_id(), bm.next_toc_id());
+    reloaded.restore_next_toc_id(bm.next_toc_id());
+    EXPECT_EQ(reloaded.add_chapter(v1, 2, "c6"), 102);
+}
+
+TEST(BookManager, BumpsTocRevisionOnChange) {
+    MockBookManager bm;
+    auto            revision = bm.toc_revision();
+    const auto      changed  = [&] {
+        const bool result = bm.toc_revision() != revision;
+        revision          = bm.toc_revision();
+        return result;
+    };
+
+    const int vid = bm.add_volume(0, "volume");
+    EXPECT_TRUE(changed());
+    const int cid = bm.add_chapter(vid, 0, "chapter");
+    EXPECT_TRUE(changed());
+    ASSERT_TRUE(bm.update_title(cid, "renamed"));
+    EXPECT_TRUE(changed());
+
+    //! the content is not part of the toc
+    bm.fetch_chapter_content(cid);
+    bm.get_all_chapters();
+    EXPECT_FALSE(changed());
+
+    bm.restore_word_count_record(cid, {.counter = "counter", .count = 1, .hash = "hash"});
+    EXPECT_TRUE(changed());
+    ASSERT_TRUE(bm.remove_chapter(cid));
+    EXPECT_TRUE(changed());
+    EXPECT_EQ(bm.remove_volume(vid), 1);
+    EXPECT_TRUE(changed());
+}
+
+TEST(BookManager, RecountsOnlyOnIndexMiss) {
+    MockBookManager     bm;
+    CountingWordCounter counter;
+    bm.set_word_counter(&counter);
+
+    const int vid = bm.add_volume(0, "volume");
+    const int cid = bm.add_chapter(vid, 0, "chapter");
+
+    //! the count known by the editor is taken as is
+    ASSERT_TRUE(bm.sync_chapter_content(cid, "abc", 3));
+    EXPECT_EQ(counter.recounts, 0);
+    EXPECT_EQ(bm.find_chapter_word_count(cid), 3);
+
+    //! a sync without the count has to recount, but only once for the same content
+    ASSERT_TRUE(bm.sync_chapter_content(cid, "abcd"));
+    EXPECT_EQ(counter.recounts, 1);
+    EXPECT_EQ(bm.find_chapter_word_count(cid), 4);
+    ASSERT_TRUE(bm.sync_chapter_content(cid, "abcd"));
+    EXPECT_EQ(counter.recounts, 1);
+
+    //! an unchanged count from the editor leaves the index untouched
+    const auto revision = bm.toc_revision();
+    ASSERT_TRUE(bm.sync_chapter_content(cid, "abcd", 4));
+    EXPECT_EQ(bm.toc_revision(), revision);
+    EXPECT_EQ(counter.recounts, 1);
+}
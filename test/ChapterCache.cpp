@@ -0,0 +1,106 @@
+#include <jwrite/ChapterCache.h>
+#include <gtest/gtest.h>
+
+using jwrite::ChapterCache;
+
+//! 4 chars, i.e. 8 bytes
+static const QString TEXT = "abcd";
+
+TEST(ChapterCache, EvictsLeastRecentlyUsedCleanChapters) {
+    ChapterCache cache(24);
+    cache.insert({"book", 1}, TEXT);
+    cache.insert({"book", 2}, TEXT);
+    cache.insert({"book", 3}, TEXT);
+    EXPECT_EQ(cache.size(), 24);
+
+    ASSERT_TRUE(cache.get({"book", 1}).has_value());
+    cache.insert({"book", 4}, TEXT);
+    EXPECT_FALSE(cache.contains({"book", 2}));
+    EXPECT_TRUE(cache.contains({"book", 1}));
+    EXPECT_EQ(cache.size(), 24);
+
+    EXPECT_FALSE(cache.get({"book", 2}).has_value());
+    const auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.evictions, 1);
+}
+
+TEST(ChapterCache, PinsDirtyChaptersUntilSaved) {
+    ChapterCache cache(16);
+    const auto   v1 = cache.update({"book", 1}, TEXT);
+    const auto   v2 = cache.update({"book", 2}, TEXT);
+    cache.insert({"book", 3}, TEXT);
+    cache.insert({"book", 4}, TEXT);
+    //! dirty chapters exceed the budget, only the clean ones are evicted
+    EXPECT_TRUE(cache.contains({"book", 1}));
+    EXPECT_TRUE(cache.contains({"book", 2}));
+    EXPECT_FALSE(cache.contains({"book", 3}));
+
+    //! stale content from the storage never replaces the edits
+    cache.insert({"book", 1}, "old");
+    EXPECT_EQ(cache.get({"book", 1}), TEXT);
+
+    //! edited after the snapshot was taken
+    const auto v3 = cache.update({"book", 2}, "abcdef");
+    EXPECT_FALSE(cache.mark_clean({"book", 2}, v2));
+    EXPECT_TRUE(cache.is_dirty({"book", 2}));
+
+    EXPECT_TRUE(cache.mark_clean({"book", 1}, v1));
+    EXPECT_TRUE(cache.mark_clean({"book", 2}, v3));
+    EXPECT_LE(cache.size(), cache.budget());
+    EXPECT_EQ(cache.version({"book", 2}), 0);
+
+    cache.remove_book("book");
+    EXPECT_EQ(cache.count(), 0);
+    EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(ChapterCache, IgnoresUnchangedUpdates) {
+    ChapterCache cache(24);
+    const auto   version = cache.update({"book", 1}, TEXT);
+
+    //! the saving version stays valid
+    EXPECT_EQ(cache.update({"book", 1}, TEXT), version);
+    ASSERT_TRUE(cache.mark_clean({"book", 1}, version));
+
+    //! nothing to save
+    EXPECT_EQ(cache.update({"book", 1}, TEXT), 0);
+    EXPECT_FALSE(cache.is_dirty({"book", 1}));
+    cache.insert({"book", 2}, TEXT);
+    EXPECT_EQ(cache.update({"book", 2}, TEXT), 0);
+    EXPECT_FALSE(cache.is_dirty({"book", 2}));
+
+    //! saved again on demand
+    const auto pinned = cache.mark_dirty({"book", 2});
+    EXPECT_GT(pinned, version);
+    EXPECT_TRUE(cache.is_dirty({"book", 2}));
+    EXPECT_EQ(cache.mark_dirty({"book", 3}), 0);
+}
+
+TEST(ChapterCache, DropsStalePrefetchedChapters) {
+    ChapterCache cache(24);
+    cache.insert({"book", 1}, TEXT);
+    cache.insert({"book", 2}, TEXT);
+
+    //! placed behind the most recently used chapter
+    EXPECT_TRUE(cache.prefetch({"book", 3}, TEXT, cache.stamp()));
+    cache.insert({"book", 4}, TEXT);
+    EXPECT_TRUE(cache.contains({"book", 3}));
+    EXPECT_FALSE(cache.contains({"book", 1}));
+
+    //! never replaces the cached content
+    EXPECT_FALSE(cache.prefetch({"book", 4}, "stale", cache.stamp()));
+    EXPECT_EQ(cache.get({"book", 4}), TEXT);
+
+    //! the chapter is updated after the load was issued
+    const auto stamp   = cache.stamp();
+    const auto version = cache.update({"book", 5}, TEXT);
+    ASSERT_TRUE(cache.mark_clean({"book", 5}, version));
+    cache.insert({"book", 6}, TEXT);
+    cache.insert({"book", 7}, TEXT);
+    cache.insert({"book", 8}, TEXT);
+    ASSERT_FALSE(cache.contains({"book", 5}));
+    EXPECT_FALSE(cache.prefetch({"book", 5}, "stale", stamp));
+    EXPECT_TRUE(cache.prefetch({"book", 5}, TEXT, cache.stamp()));
+}
@@ -0,0 +1,111 @@
+#include "Helper.h"
+#include <jwrite/ChapterCodec.h>
+#include <QBuffer>
+#include <gtest/gtest.h>
+
+using jwrite::ChapterCodec;
+using jwrite::ChapterDecoder;
+
+TEST(ChapterCodec, RoundTripsAllMethods) {
+    const auto text       = gen_chapter_text(200);
+    const auto dictionary = ChapterCodec::train_dictionary({gen_chapter_text(300)});
+    ASSERT_FALSE(dictionary.isEmpty());
+    EXPECT_LE(dictionary.size(), ChapterCodec::MAX_DICTIONARY_SIZE);
+
+    const auto plain = ChapterCodec::encode(text, ChapterCodec::None);
+    EXPECT_EQ(plain, text.toUtf8());
+    EXPECT_EQ(ChapterCodec::decode(plain), text);
+
+    const auto deflated = ChapterCodec::encode(text, ChapterCodec::Deflate);
+    EXPECT_LT(deflated.size(), plain.size() / 2);
+    EXPECT_EQ(ChapterCodec::decode(deflated), text);
+
+    const auto primed = ChapterCodec::encode(text, ChapterCodec::Dictionary, dictionary);
+    EXPECT_LE(primed.size(), deflated.size());
+    EXPECT_EQ(ChapterCodec::decode(primed, dictionary), text);
+
+    //! the dictionary is required to decode
+    EXPECT_FALSE(ChapterCodec::decode(primed).has_value());
+    EXPECT_FALSE(ChapterCodec::decode(primed, "other").has_value());
+
+    //! truncated stream
+    EXPECT_FALSE(ChapterCodec::decode(deflated.left(deflated.size() - 4)).has_value());
+}
+
+TEST(ChapterCodec, DecodesIncrementally) {
+    const auto text = gen_chapter_text(2000);
+    const auto data = ChapterCodec::encode(text, ChapterCodec::Deflate);
+
+    //! byte by byte, multi-byte characters are split across the pieces
+    ChapterDecoder decoder;
+    QString        decoded{};
+    for (const char byte : data) {
+        ASSERT_TRUE(decoder.feed(QByteArrayView(&byte, 1)));
+        decoded += decoder.take();
+    }
+    ASSERT_TRUE(decoder.finish());
+    decoded += decoder.take();
+    EXPECT_EQ(decoded, text);
+
+    //! read from the device in several pieces
+    for (const auto method : {ChapterCodec::None, ChapterCodec::Deflate}) {
+        QBuffer buffer;
+        buffer.setData(ChapterCodec::encode(text, method));
+        ASSERT_TRUE(buffer.open(QIODevice::ReadOnly));
+        EXPECT_EQ(ChapterCodec::read(&buffer), text);
+    }
+
+    //! plain text shorter than the header
+    EXPECT_EQ(ChapterCodec::decode("JW"), "JW");
+    EXPECT_EQ(ChapterCodec::decode(QByteArray{}), QString{});
+}
+
+TEST(ChapterCodec, NormalizesLegacyLineBreaks) {
+    const auto text = gen_chapter_text(200);
+    auto       data = text.toUtf8();
+    data.replace("\n", "\r\n");
+    EXPECT_EQ(ChapterCodec::decode(data), text);
+
+    //! byte by byte, every pair is split across the pieces
+    ChapterDecoder decoder;
+    QString        decoded{};
+    for (const char byte : data) {
+        ASSERT_TRUE(decoder.feed(QByteArrayView(&byte, 1)));
+        decoded += decoder.take();
+    }
+    ASSERT_TRUE(decoder.finish());
+    decoded += decoder.take();
+    EXPECT_EQ(decoded, text);
+
+    //! a lone '\r' is kept, also at the very end
+    EXPECT_EQ(ChapterCodec::decode("a\rb\r\n\r"), "a\rb\n\r");
+    EXPECT_EQ(ChapterCodec::decode("\r"), "\r");
+    EXPECT_EQ(ChapterCodec::decode("\r\n"), "\n");
+
+    //! line breaks of the text in the current format are kept as is
+    const auto crlf = QString("甲\r\n乙");
+    EXPECT_EQ(ChapterCodec::decode(ChapterCodec::encode(crlf, ChapterCodec::Deflate)), crlf);
+}
+
+TEST(ChapterCodec, VerifiesChecksum) {
+    const auto text   = gen_chapter_text(200);
+    const auto stored = ChapterCodec::encode(text, ChapterCodec::Stored);
+    EXPECT_GT(stored.size(), text.toUtf8().size());
+    EXPECT_EQ(ChapterCodec::decode(stored), text);
+    EXPECT_EQ(ChapterCodec::method_from_name("none"), ChapterCodec::Stored);
+
+    //! a flipped byte in the text
+    auto corrupted                     = stored;
+    corrupted[corrupted.size() / 2]   ^= 0x20;
+    EXPECT_FALSE(ChapterCodec::decode(corrupted).has_value());
+
+    //! truncated and empty body
+    EXPECT_FALSE(ChapterCodec::decode(stored.left(stored.size() - 1)).has_value());
+    EXPECT_EQ(ChapterCodec::decode(ChapterCodec::encode(QString{}, ChapterCodec::Stored)), "");
+
+    //! a flipped byte in the recorded size
+    const auto deflated  = ChapterCodec::encode(text, ChapterCodec::Deflate);
+    auto       resized   = deflated;
+    resized[8]          ^= 0x01;
+    EXPECT_FALSE(ChapterCodec::decode(resized).has_value());
+}
@@ -0,0 +1,158 @@
+#include "MockBookManager.h"
+#include <jwrite/EditJournal.h>
+#include <QTemporaryDir>
+#include <gtest/gtest.h>
+
+using jwrite::EditJournal;
+using jwrite::TextEditAction;
+
+static TextEditAction make_action(TextEditAction::Type type, int block, int pos, QString text) {
+    TextEditAction action{};
+    action.type            = type;
+    action.loc.block_index = block;
+    action.loc.pos         = pos;
+    action.text            = std::move(text);
+    return action;
+}
+
+TEST(EditJournal, ReplaysToTheEditedText) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const auto path = dir.filePath("JOURNAL");
+
+    {
+        EditJournal journal;
+        ASSERT_TRUE(journal.open(path));
+        journal.append(1, make_action(TextEditAction::Insert, 0, 0, "hello\nworld"));
+        journal.append(1, make_action(TextEditAction::Insert, 1, 5, "!"));
+        journal.append(1, make_action(TextEditAction::Delete, 0, 2, "llo\nw"));
+        journal.append(2, make_action(TextEditAction::Insert, 0, 0, "其他章节"));
+    }
+
+    const auto entries = EditJournal::read(path);
+    ASSERT_EQ(entries.size(), 4);
+
+    QString text{};
+    for (const auto &entry : entries) {
+        if (entry.cid == 1) { ASSERT_TRUE(EditJournal::apply(text, entry)); }
+    }
+    EXPECT_EQ(text, "heorld!");
+    EXPECT_EQ(entries[3].text, "其他章节");
+
+    //! out of range entries never touch the text
+    EXPECT_FALSE(EditJournal::apply(text, entries[1]));
+    EXPECT_EQ(text, "heorld!");
+}
+
+TEST(EditJournal, DropsTornTailAndCheckpoints) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const auto path = dir.filePath("JOURNAL");
+
+    {
+        EditJournal journal;
+        ASSERT_TRUE(journal.open(path));
+        journal.append(1, make_action(TextEditAction::Insert, 0, 0, "abc"));
+        journal.append(1, make_action(TextEditAction::Insert, 0, 3, "def"));
+    }
+
+    {
+        QFile file(path);
+        ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+        file.resize(file.size() - 1);
+    }
+    EXPECT_EQ(EditJournal::read(path).size(), 1);
+
+    EditJournal journal;
+    ASSERT_TRUE(journal.open(path));
+    journal.append(1, make_action(TextEditAction::Insert, 0, 3, "xyz"));
+    const auto entries = EditJournal::read(path);
+    ASSERT_EQ(entries.size(), 2);
+    EXPECT_EQ(entries[1].text, "xyz");
+
+    //! records appended after the snapshot survive the checkpoint
+    const auto mark = journal.mark();
+    journal.append(1, make_action(TextEditAction::Delete, 0, 0, "a"));
+    ASSERT_TRUE(journal.checkpoint(mark));
+    EXPECT_EQ(journal.mark(), EditJournal::mark_of(path));
+    const auto rest = EditJournal::read(path);
+    ASSERT_EQ(rest.size(), 1);
+    EXPECT_EQ(rest[0].type, TextEditAction::Delete);
+
+    //! stale marks are no-ops
+    ASSERT_TRUE(journal.checkpoint(mark));
+    EXPECT_EQ(EditJournal::read(path).size(), 1);
+
+    ASSERT_TRUE(journal.checkpoint(journal.mark()));
+    EXPECT_EQ(journal.size(), 0);
+    EXPECT_TRUE(EditJournal::read(path).isEmpty());
+}
+
+TEST(EditJournal, SkipsPersistedEditsOnReplay) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const auto path = dir.filePath("JOURNAL");
+
+    MockBookManager bm(dir.path());
+    const int       vid = bm.add_volume(0, "volume");
+    const int       c1  = bm.add_chapter(vid, 0, "chapter 1");
+    const int       c2  = bm.add_chapter(vid, 1, "chapter 2");
+    bm.sync_chapter_content(c1, "hello");
+    bm.sync_chapter_content(c2, "");
+    bm.persist({c1, c2}, 0);
+
+    {
+        EditJournal journal;
+        ASSERT_TRUE(journal.open(path));
+        journal.append(c1, make_action(TextEditAction::Insert, 0, 5, " world"));
+        journal.append(c2, make_action(TextEditAction::Insert, 0, 0, "abc"));
+        bm.sync_chapter_content(c1, "hello world");
+        bm.sync_chapter_content(c2, "abc");
+
+        //! the batch is partially written and the checkpoint never happens
+        bm.persist({c1}, journal.mark());
+        bm.contents.clear();
+
+        journal.append(c1, make_action(TextEditAction::Insert, 0, 11, "!"));
+    }
+
+    EXPECT_EQ(EditJournal::replay(path, &bm), 2);
+    EXPECT_EQ(bm.contents.value(c1), "hello world!");
+    EXPECT_EQ(bm.contents.value(c2), "abc");
+
+    //! a crash right after the replayed chapters are written, still before the checkpoint
+    bm.persist({c1, c2}, EditJournal::mark_of(path));
+    EXPECT_EQ(EditJournal::replay(path, &bm), 0);
+    EXPECT_TRUE(bm.contents.isEmpty());
+    EXPECT_EQ(bm.fetch_chapter_content(c1), "hello world!");
+    EXPECT_EQ(bm.fetch_chapter_content(c2), "abc");
+}
+
+TEST(EditJournal, SkipsRestoredChaptersOnReplay) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const auto path = dir.filePath("JOURNAL");
+
+    MockBookManager bm(dir.path());
+    const int       vid = bm.add_volume(0, "volume");
+    const int       c1  = bm.add_chapter(vid, 0, "chapter 1");
+    const int       c2  = bm.add_chapter(vid, 1, "chapter 2");
+    bm.sync_chapter_content(c1, "hello");
+    bm.sync_chapter_content(c2, "");
+    bm.persist({c1, c2}, 0);
+
+    {
+        EditJournal journal;
+        ASSERT_TRUE(journal.open(path));
+        journal.append(c1, make_action(TextEditAction::Insert, 0, 5, " world"));
+        journal.append(c2, make_action(TextEditAction::Insert, 0, 0, "abc"));
+    }
+
+    //! the stored chapter is lost and restored from an older snapshot
+    bm.restored.insert(c1);
+    bm.sync_chapter_content(c1, "hel");
+
+    EXPECT_EQ(EditJournal::replay(path, &bm), 1);
+    EXPECT_EQ(bm.contents.value(c1), "hel");
+    EXPECT_EQ(bm.contents.value(c2), "abc");
+}
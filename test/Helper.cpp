@@ -1,5 +1,6 @@
 #include "Helper.h"
 #include <QRandomGenerator>
+#include <QStringList>
 
 int gen_random_int(int lo, int hi) {
     return QRandomGenerator::global()->bounded(lo, hi);
@@ -15,3 +16,12 @@ QString gen_random_str(int length) {
     }
     return str;
 }
+
+QString gen_chapter_text(int paragraphs, int edited) {
+    const auto  format = QString("　　第%1段，林小满推开木门，望着院子里的老槐树发呆。%2");
+    QStringList lines{};
+    for (int i = 0; i < paragraphs; ++i) {
+        lines.append(format.arg(i).arg(i == edited ? QString("（已修改）") : QString{}));
+    }
+    return lines.join('\n');
+}
@@ -6,6 +6,9 @@
 int     gen_random_int(int lo, int hi);
 QString gen_random_str(int length);
 
+//! chapter-like text of repeated paragraphs, the paragraph at index edited is slightly changed
+QString gen_chapter_text(int paragraphs, int edited = -1);
+
 struct TextViewEngine : public jwrite::TextViewEngine {
     TextViewEngine(int width)
         : jwrite::TextViewEngine(QFontMetrics(QApplication::font()), width) {
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <jwrite/BookManager.h>
+#include <jwrite/ChapterCodec.h>
+#include <QFile>
+#include <QMap>
+#include <QSet>
+#include <gtest/gtest.h>
+
+//! NOTE: synced contents are kept in memory, if a directory is given the chapters are also stored
+//! as files there on persist, and read from the files once dropped from memory
+class MockBookManager : public jwrite::InMemoryBookManager {
+public:
+    explicit MockBookManager(QString dir = QString{})
+        : dir_(std::move(dir)) {}
+
+    OptionalString fetch_chapter_content(int cid) override {
+        if (!has_chapter(cid)) { return std::nullopt; }
+        ++sync_fetches;
+        if (auto it = contents.constFind(cid); it != contents.cend() || dir_.isEmpty()) {
+            return {contents.value(cid)};
+        }
+        QFile file(path_of(cid));
+        if (!file.open(QIODevice::ReadOnly)) { return std::nullopt; }
+        return jwrite::ChapterCodec::read(&file);
+    }
+
+    QFuture<OptionalString> fetch_chapter_content_async(int cid) override {
+        ++async_fetches;
+        //! simulate a chapter which fails to load in the background
+        if (cid == broken) { return QtFuture::makeReadyFuture(OptionalString{}); }
+        return InMemoryBookManager::fetch_chapter_content_async(cid);
+    }
+
+    using InMemoryBookManager::sync_chapter_content;
+
+    bool sync_chapter_content(
+        int cid, const QString &text, std::optional<int> word_count) override {
+        if (!has_chapter(cid)) { return false; }
+        contents[cid] = text;
+        update_word_count_index(cid, text, word_count);
+        return true;
+    }
+
+    qint64 get_chapter_journal_mark(int cid) override {
+        if (dir_.isEmpty()) { return 0; }
+        return jwrite::ChapterCodec::journal_mark_of(path_of(cid));
+    }
+
+    bool is_chapter_restored(int cid) override {
+        return restored.contains(cid);
+    }
+
+    //! write the synced content of the chapters as the storage writer does
+    void persist(const QList<int> &cids, qint64 journal_mark) {
+        ASSERT_FALSE(dir_.isEmpty());
+        for (const int cid : cids) {
+            QFile file(path_of(cid));
+            ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+            const auto text = fetch_chapter_content(cid).value();
+            file.write(
+                jwrite::ChapterCodec::encode(text, jwrite::ChapterCodec::Stored, {}, journal_mark));
+            contents.remove(cid);
+        }
+    }
+
+    QString path_of(int cid) const {
+        return QString("%1/%2").arg(dir_).arg(cid);
+    }
+
+    QMap<int, QString> contents;
+    QSet<int>          restored;
+    int                broken        = -1;
+    int                sync_fetches  = 0;
+    int                async_fetches = 0;
+
+private:
+    QString dir_;
+};
@@ -0,0 +1,78 @@
+#include "Helper.h"
+#include <jwrite/SnapshotStore.h>
+#include <QTemporaryDir>
+#include <gtest/gtest.h>
+
+using jwrite::SnapshotStore;
+
+TEST(SnapshotStore, SplitsContentDefinedChunks) {
+    const auto data   = gen_chapter_text(500).toUtf8();
+    const auto bounds = SnapshotStore::split_chunks(data);
+    ASSERT_FALSE(bounds.isEmpty());
+    EXPECT_EQ(bounds.back(), data.size());
+    qsizetype start = 0;
+    for (const auto end : bounds) {
+        EXPECT_LE(end - start, SnapshotStore::MAX_CHUNK_SIZE);
+        if (end != data.size()) { EXPECT_GE(end - start, SnapshotStore::MIN_CHUNK_SIZE); }
+        start = end;
+    }
+}
+
+TEST(SnapshotStore, DeduplicatesAndRestoresVersions) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const auto path = dir.filePath("history");
+
+    const auto v1 = gen_chapter_text(500);
+    const auto v2 = gen_chapter_text(500, 250);
+
+    {
+        SnapshotStore store;
+        ASSERT_TRUE(store.open(path));
+        const auto id1 = store.record(1, v1, 1000);
+        ASSERT_TRUE(id1.has_value());
+        const auto size = store.stored_size();
+        const auto id2  = store.record(1, v2, 2000);
+        ASSERT_TRUE(id2.has_value());
+        //! only the chunks around the edit are stored again
+        EXPECT_LT(store.stored_size() - size, size / 4);
+        //! unchanged text never makes a new version
+        EXPECT_EQ(store.record(1, v2, 3000), id2);
+    }
+
+    SnapshotStore store;
+    ASSERT_TRUE(store.open(path));
+    const auto versions = store.versions(1);
+    ASSERT_EQ(versions.size(), 2);
+    EXPECT_EQ(versions[0].timestamp, 1000);
+    EXPECT_EQ(store.restore(versions[0].id), v1);
+    EXPECT_EQ(store.restore(versions[1].id), v2);
+    EXPECT_TRUE(store.versions(2).isEmpty());
+}
+
+TEST(SnapshotStore, PrunesByRetentionPolicy) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    SnapshotStore store;
+    ASSERT_TRUE(store.open(dir.filePath("history")));
+    store.set_retention_policy({.max_versions = 3, .max_age = 0});
+    for (int i = 0; i < 6; ++i) { store.record(1, gen_chapter_text(20 + i * 100), i); }
+    store.record(2, "other", 0);
+
+    const auto size = store.stored_size();
+    ASSERT_TRUE(store.prune(10));
+    const auto versions = store.versions(1);
+    ASSERT_EQ(versions.size(), 3);
+    EXPECT_EQ(versions[0].timestamp, 3);
+    EXPECT_EQ(store.restore(versions[2].id), gen_chapter_text(520));
+    EXPECT_LE(store.stored_size(), size);
+    EXPECT_EQ(store.versions(2).size(), 1);
+
+    //! the latest version is kept regardless of the age
+    const qint64 day = 24 * 60 * 60 * 1000;
+    store.set_retention_policy({.max_versions = 0, .max_age = 1});
+    ASSERT_TRUE(store.prune(10 * day));
+    EXPECT_EQ(store.versions(1).size(), 1);
+    EXPECT_EQ(store.restore(store.latest(1)->id), gen_chapter_text(520));
+}
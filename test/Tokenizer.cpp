@@ -0,0 +1,144 @@
+#include "Helper.h"
+#include <jwrite/Tokenizer.h>
+#include <cppjieba/MixSegment.hpp>
+#include <QCoreApplication>
+#include <QRandomGenerator>
+#include <QFile>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+using jwrite::BlockWordBoundaries;
+using jwrite::Tokenizer;
+
+static QString gen_random_corpus_str(int length) {
+    //! NOTE: dictionary words, ascii words & numbers, separators and a surrogate pair, so that
+    //! every path of the mixed segmentation is hit
+    static const QStringList pieces{
+        //! dictionary words
+        "我们", "在", "北京", "天安门", "研究生", "命", "的", "起源", "小明", "硕士",
+        "毕业于", "中国", "科学院", "计算所", "网易杭研", "大厦", "他", "来到了",
+        //! user dictionary words
+        "云计算", "区块链", "蓝翔",
+        //! ascii words & numbers
+        "abc", "Hello", "world2", "v1.2", "3.14", "2024", "x", "0",
+        //! separators & punctuations
+        " ", "\t", "，", "。", "！", "、", "-", "_", ".",
+        //! surrogate pair
+        "😀",
+    };
+    auto   *rng = QRandomGenerator::global();
+    QString str;
+    while (str.length() < length) {
+        const auto &piece = pieces.at(rng->bounded(pieces.size()));
+        if (rng->bounded(4) == 0 && !piece.front().isSurrogate()) {
+            //! break the dictionary words into single chars to feed the hmm model
+            str.append(piece.front());
+        } else {
+            str.append(piece);
+        }
+    }
+    return str;
+}
+
+class TokenizerTest : public testing::Test {
+protected:
+    void SetUp() override {
+        const auto dir            = QCoreApplication::applicationDirPath() + "/dicts";
+        const auto dict_path      = dir + "/jieba.dict.utf8";
+        const auto hmm_path       = dir + "/hmm_model.utf8";
+        const auto user_dict_path = dir + "/user.dict.utf8";
+        //! NOTE: the fixture dictionaries are copied next to the binary on build
+        ASSERT_TRUE(QFile::exists(dict_path) && QFile::exists(hmm_path))
+            << "dictionaries are unavailable under " << dir.toStdString();
+        if (!reference_) {
+            reference_ = std::make_unique<cppjieba::MixSegment>(
+                dict_path.toLocal8Bit().toStdString(),
+                hmm_path.toLocal8Bit().toStdString(),
+                user_dict_path.toLocal8Bit().toStdString());
+        }
+    }
+
+    static QStringList cut_by_reference(const QString &text) {
+        std::vector<std::string> words{};
+        reference_->Cut(text.toStdString(), words, true);
+        QStringList results{};
+        for (const auto &word : words) { results << QString::fromStdString(word); }
+        return results;
+    }
+
+    static QStringList cut_by_boundaries(const QString &text) {
+        QList<int> boundaries{};
+        Tokenizer::get_instance().cut_boundaries(text, boundaries);
+        QStringList results{};
+        for (int i = 1; i < boundaries.size(); ++i) {
+            results << text.mid(boundaries[i - 1], boundaries[i] - boundaries[i - 1]);
+        }
+        return results;
+    }
+
+    static std::unique_ptr<cppjieba::MixSegment> reference_;
+};
+
+std::unique_ptr<cppjieba::MixSegment> TokenizerTest::reference_;
+
+TEST_F(TokenizerTest, MatchesMixSegment) {
+    const QStringList corpus{
+        "我来到北京清华大学",
+        "他来到了网易杭研大厦",
+        "小明硕士毕业于中国科学院计算所，后在日本京都大学深造",
+        "南京市长江大桥",
+        "Hello world，这是一个test用例。版本v1.2发布于2024年",
+        "云计算和区块链是蓝翔的热门专业 abc123 3.14159",
+        "😀表情😀符号",
+        "  前后\t空白  ",
+    };
+    for (const auto &text : corpus) {
+        ASSERT_EQ(cut_by_boundaries(text), cut_by_reference(text)) << text.toStdString();
+    }
+
+    for (int i = 0; i < 512; ++i) {
+        const auto text = gen_random_corpus_str(gen_random_int(1, 128));
+        ASSERT_EQ(cut_by_boundaries(text), cut_by_reference(text)) << text.toStdString();
+    }
+}
+
+TEST_F(TokenizerTest, InvalidatesBlockBoundariesOnEdit) {
+    const auto &tokenizer = Tokenizer::get_instance();
+    auto        e         = TextViewEngine::get_single_line_engine();
+    auto        block     = e.current_block();
+
+    BlockWordBoundaries cache;
+    QList<int>          expected;
+
+    e.insert("我们在北京");
+    tokenizer.cut_boundaries(block->text(), expected);
+    const auto *cached = &cache.get(tokenizer, block);
+    ASSERT_EQ(*cached, expected);
+
+    //! the block is not segmented again until it is edited
+    EXPECT_EQ(&cache.get(tokenizer, block), cached);
+
+    for (int i = 0; i < 64; ++i) {
+        const int pos = gen_random_int(0, block->text_len() + 1);
+        e.reset_cursor_unsafe(0, pos, 0, pos);
+        e.insert(gen_random_corpus_str(gen_random_int(1, 8)));
+
+        tokenizer.cut_boundaries(block->text(), expected);
+        ASSERT_EQ(cache.get(tokenizer, block), expected);
+
+        const int probe = gen_random_int(0, block->text_len() + 1);
+        const int prev  = cache.find_prev(tokenizer, block, probe);
+        const int next  = cache.find_next(tokenizer, block, probe);
+        ASSERT_TRUE(expected.contains(prev));
+        ASSERT_TRUE(expected.contains(next));
+        ASSERT_LE(prev, probe);
+        ASSERT_GE(next, probe);
+    }
+
+    //! records are dropped on reset
+    cache.reset();
+    tokenizer.cut_boundaries(block->text(), expected);
+    EXPECT_EQ(cache.get(tokenizer, block), expected);
+}
@@ -0,0 +1,101 @@
+#include "Helper.h"
+#include <jwrite/WordCounter.h>
+#include <QRandomGenerator>
+#include <gtest/gtest.h>
+
+using jwrite::BlockWordCounter;
+using jwrite::FastStrictWordCounter;
+using jwrite::StrictWordCounter;
+
+static QString gen_random_mixed_str(int length) {
+    //! NOTE: biased towards the chars that drive the state machine of the strict counter
+    static const QString char_set = QStringLiteral(
+        "abcxoXBZ0123456789.-_,;!? \t\n"
+        "一中文字龥。，　０ａéДあア");
+    auto   *rng = QRandomGenerator::global();
+    QString str;
+    for (int i = 0; i < length; ++i) {
+        const int kind = rng->bounded(8);
+        if (kind == 0) {
+            //! any utf-16 unit, including lone surrogates
+            str.append(QChar(static_cast<char16_t>(rng->bounded(0x10000))));
+        } else if (kind < 3) {
+            //! long runs to hit the vectorized path
+            const QChar ch  = char_set.at(rng->bounded(char_set.length()));
+            const int   run = rng->bounded(1, 24);
+            for (int j = 0; j < run; ++j) { str.append(ch); }
+        } else {
+            str.append(char_set.at(rng->bounded(char_set.length())));
+        }
+    }
+    return str;
+}
+
+TEST(WordCounter, FastStrictMatchesOnEveryUnit) {
+    StrictWordCounter     ref;
+    FastStrictWordCounter fast;
+
+    const QStringList prefixes{"", " ", "0", "1", "a", "中", ",", "0x"};
+    const QStringList suffixes{"", "0", "a", "."};
+    for (int i = 0; i < 0x10000; ++i) {
+        const QChar ch(static_cast<char16_t>(i));
+        for (const auto &prefix : prefixes) {
+            for (const auto &suffix : suffixes) {
+                const auto text = prefix + ch + suffix;
+                ASSERT_EQ(ref.count_all(text), fast.count_all(text)) << "unit " << i;
+            }
+        }
+    }
+}
+
+TEST(WordCounter, FastStrictMatchesOnRandomText) {
+    StrictWordCounter     ref;
+    FastStrictWordCounter fast;
+
+    for (int i = 0; i < 4096; ++i) {
+        const auto text = gen_random_mixed_str(gen_random_int(0, 512));
+        ASSERT_EQ(ref.count_all(text), fast.count_all(text)) << text.toStdString();
+    }
+}
+
+TEST(WordCounter, PartialCountIsResumable) {
+    StrictWordCounter     ref;
+    FastStrictWordCounter fast;
+
+    for (int i = 0; i < 1024; ++i) {
+        const auto text     = gen_random_mixed_str(gen_random_int(0, 256));
+        const int  expected = ref.count_all(text);
+        StrictWordCounter *counters[]{&ref, &fast};
+        for (auto counter : counters) {
+            int state = 0;
+            int count = 0;
+            int pos   = 0;
+            while (pos < text.length()) {
+                const int len  = gen_random_int(1, text.length() - pos + 1);
+                count         += counter->count_partial(QStringView(text).mid(pos, len), state);
+                pos           += len;
+            }
+            count += counter->count_pending(state);
+            ASSERT_EQ(count, expected);
+        }
+    }
+}
+
+TEST(WordCounter, BlockCountMatchesJoinedText) {
+    auto e = TextViewEngine::get_single_line_engine();
+
+    FastStrictWordCounter counter;
+    BlockWordCounter      cache;
+
+    for (int i = 0; i < 256; ++i) {
+        if (i % 32 == 0) { e.gen_blocks(4); }
+        const int block_index = gen_random_int(0, e.active_blocks.size());
+        const int pos         = gen_random_int(0, e.active_blocks[block_index]->text_len() + 1);
+        e.reset_cursor_unsafe(block_index, pos, 0, pos);
+        e.insert(gen_random_mixed_str(gen_random_int(0, 16)).remove('\n'));
+
+        QStringList blocks;
+        for (auto block : e.active_blocks) { blocks << block->text().toString(); }
+        ASSERT_EQ(cache.count(&counter, e.active_blocks), counter.count_all(blocks.join('\n')));
+    }
+}
@@ -0,0 +1,74 @@
+#include <jwrite/WritingStats.h>
+#include <QTemporaryDir>
+#include <QDateTime>
+#include <gtest/gtest.h>
+
+using jwrite::WritingRecord;
+using jwrite::WritingStats;
+
+TEST(WritingStats, SplitsSessionsAndPersists) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const auto path = dir.filePath("STATS");
+
+    //! NOTE: recent enough to escape downsampling on reopen
+    const int64_t base = QDateTime::currentSecsSinceEpoch() / 3600 * 3600 - 24 * 3600;
+
+    {
+        WritingStats stats;
+        ASSERT_TRUE(stats.open(path));
+        stats.record(10, base);
+        stats.record(-3, base + 30);
+        stats.record(5, base + 90);
+        stats.record(7, base + WritingStats::SESSION_GAP + 200);
+        EXPECT_EQ(stats.current_session(), 1);
+    }
+
+    WritingStats stats;
+    ASSERT_TRUE(stats.open(path));
+
+    const auto sessions = stats.sessions(base, base + 3600);
+    ASSERT_EQ(sessions.size(), 2);
+    EXPECT_EQ(sessions[0].added, 15);
+    EXPECT_EQ(sessions[0].removed, 3);
+    EXPECT_EQ(sessions[1].net(), 7);
+
+    const auto hours = stats.query(WritingStats::Granularity::Hour, base, base + 3600);
+    ASSERT_EQ(hours.size(), 1);
+    EXPECT_EQ(hours[0].start, base);
+    EXPECT_EQ(hours[0].net(), 19);
+
+    //! resumed edits long after the last one start a new session
+    stats.record(1, base + 2 * 3600);
+    EXPECT_EQ(stats.current_session(), 2);
+}
+
+TEST(WritingStats, DownsampleKeepsSessionTotals) {
+    QList<WritingRecord> records{};
+    for (int i = 0; i < 180; ++i) {
+        records.append(WritingRecord{
+            .start   = 7200 + i * WritingStats::SAMPLE_SPAN,
+            .span    = WritingStats::SAMPLE_SPAN,
+            .session = i / 90,
+            .added   = 2,
+            .removed = 1,
+        });
+    }
+
+    const int64_t before = 7200 + 150 * WritingStats::SAMPLE_SPAN;
+    const auto    result = WritingStats::downsample(records, before);
+
+    //! (hour 2, session 0), (hour 3, session 0), (hour 3, session 1), (hour 4, session 1), then
+    //! 30 minute records
+    ASSERT_EQ(result.size(), 4 + 30);
+    EXPECT_EQ(result[0].span, WritingStats::DOWNSAMPLED_SPAN);
+    EXPECT_EQ(result[0].added, 120);
+    EXPECT_EQ(result[0].removed, 60);
+    EXPECT_EQ(result[1].added, 60);
+    EXPECT_EQ(result[2].session, 1);
+    EXPECT_EQ(result[2].added, 60);
+    EXPECT_EQ(result[3].start, 4 * 3600);
+    EXPECT_EQ(result[4].start, before);
+    EXPECT_EQ(result[4].span, WritingStats::SAMPLE_SPAN);
+    for (int i = 1; i < result.size(); ++i) { EXPECT_LE(result[i - 1].start, result[i].start); }
+}